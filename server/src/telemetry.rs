@@ -1,9 +1,10 @@
 use chrono::{DateTime, Utc};
 use serde::{de::Error as DeError, Deserialize, Serialize};
 use serde_json::Value;
-use std::collections::HashMap;
+use std::collections::{BTreeMap, HashMap};
 use std::net::SocketAddr;
 use std::sync::Arc;
+use std::time::{Duration, Instant};
 use tokio::net::UdpSocket;
 use tokio::sync::{broadcast, RwLock};
 use tracing::Instrument;
@@ -100,6 +101,223 @@ struct EnvironmentMessage {
     goal: Option<Goal>,
 }
 
+/// Streamed environment from the simulator, see sim/src/environment_codec.h:
+/// a 28 byte "SWEV" header followed by fixed 32 byte records, little-endian.
+const ENV_MAGIC: &[u8; 4] = b"SWEV";
+const ENV_VERSION: u8 = 2;
+const ENV_HEADER_SIZE: usize = 28;
+const ENV_RECORD_SIZE: usize = 32;
+const ENV_FULL: u8 = 1;
+/// a stream still missing chunks after this lost one
+const ENV_STREAM_TIMEOUT: Duration = Duration::from_secs(1);
+
+/// header every chunk of a stream carries
+#[derive(Debug, Clone, Copy, PartialEq)]
+struct EnvChunkHeader {
+    flags: u8,
+    chunk: u16,
+    chunks: u16,
+    revision: u32,
+    base: u32,
+    total: u32,
+    /// the sending simulator's command port, where a resend is asked for
+    reply_port: u16,
+}
+
+#[derive(Debug, Clone)]
+enum EnvRecord {
+    Obstacle(u32, ObstacleType),
+    Goal(Goal),
+}
+
+fn read_u16(data: &[u8], at: usize) -> u16 {
+    u16::from_le_bytes([data[at], data[at + 1]])
+}
+
+fn read_u32(data: &[u8], at: usize) -> u32 {
+    u32::from_le_bytes([data[at], data[at + 1], data[at + 2], data[at + 3]])
+}
+
+fn read_f32(data: &[u8], at: usize) -> f64 {
+    f32::from_bits(read_u32(data, at)) as f64
+}
+
+/// decode one environment chunk; None if it isn't one or is malformed.
+/// Records of shapes this server doesn't know are skipped.
+fn decode_env_chunk(data: &[u8]) -> Option<(EnvChunkHeader, Vec<EnvRecord>)> {
+    if data.len() < ENV_HEADER_SIZE || &data[..4] != ENV_MAGIC || data[4] != ENV_VERSION {
+        return None;
+    }
+    let header = EnvChunkHeader {
+        flags: data[5],
+        chunk: read_u16(data, 6),
+        chunks: read_u16(data, 8),
+        revision: read_u32(data, 12),
+        base: read_u32(data, 16),
+        total: read_u32(data, 20),
+        reply_port: read_u16(data, 24),
+    };
+    let count = read_u16(data, 10) as usize;
+    if header.chunk >= header.chunks || data.len() != ENV_HEADER_SIZE + count * ENV_RECORD_SIZE {
+        return None;
+    }
+
+    let mut records = Vec::with_capacity(count);
+    for r in (0..count).map(|i| ENV_HEADER_SIZE + i * ENV_RECORD_SIZE) {
+        let id = read_u32(data, r + 4);
+        let p: Vec<f64> = (0..6).map(|a| read_f32(data, r + 8 + 4 * a)).collect();
+        let record = match data[r] {
+            1 => EnvRecord::Obstacle(id, ObstacleType::Box { x: p[0], y: p[1], z: p[2], width: p[3], depth: p[4], height: p[5] }),
+            2 => EnvRecord::Obstacle(id, ObstacleType::Sphere { x: p[0], y: p[1], z: p[2], radius: p[3] }),
+            3 => EnvRecord::Obstacle(id, ObstacleType::Cylinder { x: p[0], y: p[1], z: p[2], radius: p[3], height: p[4] }),
+            4 => EnvRecord::Goal(Goal { x: p[0], y: p[1], z: p[2], radius: p[3] }),
+            _ => continue,
+        };
+        records.push(record);
+    }
+    Some((header, records))
+}
+
+/// a stream whose chunks are still arriving
+struct PendingStream {
+    header: EnvChunkHeader,
+    parts: Vec<Option<Vec<EnvRecord>>>,
+    received: usize,
+    started: Instant,
+    /// command port of the simulator sending it
+    reply_to: SocketAddr,
+}
+
+/// what taking one chunk did
+#[derive(Debug, Default, PartialEq)]
+struct EnvPushResult {
+    /// a stream completed and changed the map
+    applied: bool,
+    /// something was missed; ask this simulator for a full resend
+    resync: Option<SocketAddr>,
+}
+
+/// Puts environment streams back together. Full streams replace the map;
+/// deltas only apply on top of the revision they were made against.
+#[derive(Default)]
+struct EnvAssembler {
+    revision: Option<u32>,
+    obstacles: BTreeMap<u32, ObstacleType>,
+    goal: Option<Goal>,
+    pending: Option<PendingStream>,
+}
+
+impl EnvAssembler {
+    /// take one chunk that arrived from `src`
+    fn push(&mut self, header: EnvChunkHeader, records: Vec<EnvRecord>, src: SocketAddr, now: Instant) -> EnvPushResult {
+        let mut result = EnvPushResult::default();
+        let reply_to = SocketAddr::new(src.ip(), header.reply_port);
+
+        // an unfinished stream that was overtaken or went quiet lost a chunk
+        let same_stream = matches!(&self.pending, Some(p)
+            if p.header.revision == header.revision && p.header.flags == header.flags && p.header.chunks == header.chunks);
+        if !same_stream {
+            result.resync = self.pending.take().map(|p| p.reply_to);
+        } else if let Some(to) = self.expire(now) {
+            result.resync = Some(to);
+        }
+        let pending = self.pending.get_or_insert_with(|| PendingStream {
+            header,
+            parts: vec![None; header.chunks as usize],
+            received: 0,
+            started: now,
+            reply_to,
+        });
+        let part = &mut pending.parts[header.chunk as usize];
+        if part.is_some() {
+            return result;
+        }
+        *part = Some(records);
+        pending.received += 1;
+        if pending.received < pending.parts.len() {
+            return result;
+        }
+
+        let stream = self.pending.take().unwrap();
+        let full = stream.header.flags & ENV_FULL != 0;
+        if !full && self.revision != Some(stream.header.base) {
+            result.resync = Some(stream.reply_to);
+            return result;
+        }
+        if full {
+            self.obstacles.clear();
+            self.goal = None;
+        }
+        for record in stream.parts.into_iter().flatten().flatten() {
+            match record {
+                EnvRecord::Obstacle(id, obstacle) => {
+                    self.obstacles.insert(id, obstacle);
+                }
+                EnvRecord::Goal(goal) => self.goal = Some(goal),
+            }
+        }
+        self.revision = Some(stream.header.revision);
+        result.applied = true;
+        if self.obstacles.len() != stream.header.total as usize {
+            result.resync = Some(stream.reply_to);
+        }
+        result
+    }
+
+    /// when the unfinished stream, if any, counts as lost
+    fn deadline(&self) -> Option<Instant> {
+        self.pending.as_ref().map(|p| p.started + ENV_STREAM_TIMEOUT)
+    }
+
+    /// drop the unfinished stream once it is past its deadline, even if no
+    /// other chunk ever arrives; returns where to ask for a resend
+    fn expire(&mut self, now: Instant) -> Option<SocketAddr> {
+        match self.deadline() {
+            Some(deadline) if now >= deadline => self.pending.take().map(|p| p.reply_to),
+            _ => None,
+        }
+    }
+
+    fn obstacles(&self) -> Vec<ObstacleType> {
+        self.obstacles.values().cloned().collect()
+    }
+}
+
+/// store a new environment and broadcast it to WebSocket clients
+/// ask the simulator at `to` (its command port) for a full environment resend
+async fn request_environment(socket: &UdpSocket, to: SocketAddr, reason: &str) {
+    tracing::warn!("udp_recv: environment stream {}, asking {} for a full resend", reason, to);
+    if let Err(err) = socket.send_to(b"environment", to).await {
+        tracing::warn!("Failed to request environment from {}: {}", to, err);
+    }
+}
+
+async fn publish_environment(shared: &TelemetryShared, obstacles: Vec<ObstacleType>, goal: Option<Goal>) {
+    {
+        let mut guard = shared.obstacles.write().await;
+        *guard = obstacles.clone();
+    }
+    {
+        let mut guard = shared.goal.write().await;
+        *guard = goal.clone();
+    }
+    // broadcast environment update to WebSocket clients
+    if let Ok(msg) = serde_json::to_value(&serde_json::json!({
+        "type": "environment",
+        "payload": {
+            "obstacles": obstacles,
+            "goal": goal,
+        }
+    })) {
+        let _ = shared.env_tx.send(msg);
+    }
+    tracing::info!(
+        "udp_recv: updated environment from sim with {} obstacles and goal={:?}",
+        obstacles.len(),
+        goal
+    );
+}
+
 /// state of UAV swarm
 #[derive(Clone)]
 pub struct SwarmState {
@@ -205,16 +423,31 @@ pub async fn run_udp_listener(bind_addr: SocketAddr, shared: TelemetryShared) {
     };
 
     tracing::info!("UDP telemetry listener bound at {}", bind_addr);
+    let mut assembler = EnvAssembler::default();
 
     loop {
         let mut buf = vec![0u8; 2048];
         let span = tracing::info_span!("udp_recv");
         let shared = shared.clone();
         let socket = &socket;
+        let assembler = &mut assembler;
         let addr = bind_addr;
 
+        // an unfinished environment stream is given up on at its deadline, not
+        // only when the next chunk happens to show it was overtaken
+        let deadline = assembler.deadline();
+
         let fut = async move {
-            let (len, src) = match socket.recv_from(&mut buf).await {
+            let received = tokio::select! {
+                res = socket.recv_from(&mut buf) => res,
+                _ = tokio::time::sleep_until(deadline.unwrap_or_else(Instant::now).into()), if deadline.is_some() => {
+                    if let Some(to) = assembler.expire(Instant::now()) {
+                        request_environment(socket, to, "timed out").await;
+                    }
+                    return;
+                }
+            };
+            let (len, src) = match received {
                 Ok(res) => res,
                 Err(err) => {
                     tracing::warn!("Error receiving UDP packet: {}", err);
@@ -225,32 +458,26 @@ pub async fn run_udp_listener(bind_addr: SocketAddr, shared: TelemetryShared) {
             let data = &buf[..len];
             tracing::info!("udp_recv: received {} bytes from {}", len, src);
 
-            // first, try to decode an environment / obstacles update from the simulator
+            // environment streamed in chunks by the simulator
+            if data.starts_with(ENV_MAGIC) {
+                let Some((header, records)) = decode_env_chunk(data) else {
+                    tracing::warn!("udp_recv: malformed environment chunk from {}", src);
+                    return;
+                };
+                let result = assembler.push(header, records, src, Instant::now());
+                if result.applied {
+                    publish_environment(&shared, assembler.obstacles(), assembler.goal.clone()).await;
+                }
+                if let Some(to) = result.resync {
+                    request_environment(socket, to, "incomplete").await;
+                }
+                return;
+            }
+
+            // older simulators send the whole environment as one JSON message
             if let Ok(env) = serde_json::from_slice::<EnvironmentMessage>(data) {
                 if env.msg_type == "environment" {
-                    {
-                        let mut guard = shared.obstacles.write().await;
-                        *guard = env.obstacles.clone();
-                    }
-                    {
-                        let mut guard = shared.goal.write().await;
-                        *guard = env.goal.clone();
-                    }
-                    // broadcast environment update to WebSocket clients
-                    if let Ok(msg) = serde_json::to_value(&serde_json::json!({
-                        "type": "environment",
-                        "payload": {
-                            "obstacles": env.obstacles,
-                            "goal": env.goal,
-                        }
-                    })) {
-                        let _ = shared.env_tx.send(msg);
-                    }
-                    tracing::info!(
-                        "udp_recv: updated environment from sim with {} obstacles and goal={:?}",
-                        env.obstacles.len(),
-                        env.goal
-                    );
+                    publish_environment(&shared, env.obstacles, env.goal).await;
                     // this packet was an environment update; no telemetry frame inside
                     return;
                 }
@@ -0,0 +1,273 @@
+#include "batch_runner.h"
+#include "simulator.h"
+#include "uav.h"
+#include "thread_pool.h"
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <random>
+
+namespace
+{
+	const double CONTACT_DISTANCE = 1.0;	// m; UAVs closer than this count as touching
+
+	// what one swarm did in one run
+	struct SwarmMetrics
+	{
+		bool reached_goal = false;
+		double time_to_goal = -1.0;			// simulated seconds, -1 if it never arrived
+		double goal_distance = -1.0;		// leader's distance from the goal at the end, -1 without a leader
+		double min_separation = std::numeric_limits<double>::infinity();
+		uint64_t contact_ticks = 0;			// UAV pairs under CONTACT_DISTANCE, summed over ticks
+		uint64_t obstacle_ticks = 0;		// UAVs inside a blocked cell, summed over ticks
+		uint64_t collision_ticks = 0;		// UAVs inside an obstacle's actual shape, summed over ticks
+		double min_clearance = std::numeric_limits<double>::infinity();	// closest any UAV came to an obstacle surface
+		double formation_error_sum = 0.0;
+		uint64_t formation_samples = 0;
+		double formation_error_max = 0.0;
+	};
+
+	struct RunParams
+	{
+		uint32_t seed;
+		double cohesion;
+		double separation;
+		double alignment;
+		int obstacles;
+	};
+
+	struct RunResult
+	{
+		RunParams params;
+		uint64_t ticks = 0;
+		double wall_ms = 0.0;
+		std::vector<SwarmMetrics> swarms;
+	};
+
+	bool parse_number(const char *text, const char *end, double &out)
+	{
+		auto [last, err] = std::from_chars(text, end, out);
+		return err == std::errc() && last == end;
+	}
+
+	bool parse_range(const char *value, BatchRange &out)
+	{
+		const char *end = value + std::strlen(value);
+		const char *colon = std::strchr(value, ':');
+		if (!colon)
+		{
+			if (!parse_number(value, end, out.lo))
+				return false;
+			out.hi = out.lo;
+			return true;
+		}
+		return parse_number(value, colon, out.lo) && parse_number(colon + 1, end, out.hi) && out.lo <= out.hi;
+	}
+
+	double draw(std::mt19937 &rng, const BatchRange &range)
+	{
+		if (range.lo == range.hi)
+			return range.lo;
+		return std::uniform_real_distribution<double>(range.lo, range.hi)(rng);
+	}
+
+	double distance(const std::array<double, 3> &a, const std::array<double, 3> &b)
+	{
+		double dx = a[0] - b[0], dy = a[1] - b[1], dz = a[2] - b[2];
+		return std::sqrt(dx * dx + dy * dy + dz * dz);
+	}
+
+	// folds one tick of one swarm into its metrics
+	void measure(std::vector<UAV> &uavs, const Environment &env, bool reached_goal, SwarmMetrics &m)
+	{
+		for (size_t i = 0; i < uavs.size(); i++)
+		{
+			for (size_t j = i + 1; j < uavs.size(); j++)
+			{
+				double d = distance(uavs[i].get_pos(), uavs[j].get_pos());
+				m.min_separation = std::min(m.min_separation, d);
+				if (d < CONTACT_DISTANCE)
+					m.contact_ticks++;
+			}
+			std::array<int, 3> cell = env.toGrid(uavs[i].get_pos());
+			if (env.isBlocked(cell[0], cell[1], cell[2]))
+				m.obstacle_ticks++;
+			double clearance = env.getObstacles().distance(uavs[i].get_pos());
+			m.min_clearance = std::min(m.min_clearance, clearance);
+			if (clearance < 0.0)
+				m.collision_ticks++;
+		}
+
+		// followers are parked around the goal once it is reached, out of formation on purpose
+		if (reached_goal)
+			return;
+		const UAV *leader = nullptr;
+		for (const auto &uav : uavs)
+			if (uav.get_slot() == 0)
+				leader = &uav;
+		if (!leader)
+			return;
+		for (const auto &uav : uavs)
+		{
+			if (&uav == leader || uav.is_manual())
+				continue;
+			double err = distance(uav.get_pos(), uav.get_formation_target(leader->get_pos(), leader->get_vel()));
+			m.formation_error_sum += err;
+			m.formation_error_max = std::max(m.formation_error_max, err);
+			m.formation_samples++;
+		}
+	}
+
+	RunResult run_one(const BatchConfig &config, int run, const SwarmTuning &base)
+	{
+		RunResult result;
+		RunParams &p = result.params;
+		p.seed = config.seed + run;
+
+		// parameters come from the run's own seed, so a run repeats whatever thread it lands on
+		std::mt19937 rng(p.seed);
+		p.cohesion = draw(rng, config.cohesion);
+		p.separation = draw(rng, config.separation);
+		p.alignment = draw(rng, config.alignment);
+		p.obstacles = (int)std::lround(draw(rng, config.obstacles));
+
+		SimConfig sim_config;
+		sim_config.obstacles = p.obstacles;
+		sim_config.headless = true;
+		SwarmTuning tuning = base;
+		tuning.cohesion = p.cohesion;
+		tuning.separation = p.separation;
+		tuning.alignment = p.alignment;
+		tuning.swarm_size = config.uavs;
+		sim_config.tuning = tuning;
+
+		auto start = std::chrono::steady_clock::now();
+		UAVSimulator sim(config.uavs, config.swarms, p.seed, sim_config);
+		int swarm_count = sim.get_swarm_count();
+		result.swarms.resize(swarm_count);
+
+		int arrived = 0;
+		while (result.ticks < config.max_ticks && arrived < swarm_count)
+		{
+			sim.step();
+			result.ticks++;
+			for (int n = 0; n < swarm_count; n++)
+			{
+				SwarmMetrics &m = result.swarms[n];
+				bool reached = sim.get_reached_goal(n);
+				if (reached && !m.reached_goal)
+				{
+					m.reached_goal = true;
+					m.time_to_goal = result.ticks * UAVDT;
+					arrived++;
+				}
+				measure(sim.get_swarm(n), sim.get_environment(), reached, m);
+			}
+		}
+		for (int n = 0; n < swarm_count; n++)
+		{
+			for (const auto &uav : sim.get_swarm(n))
+				if (uav.get_slot() == 0)
+					result.swarms[n].goal_distance = distance(uav.get_pos(), sim.get_goal(n));
+		}
+		result.wall_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		return result;
+	}
+
+	void write_rows(std::FILE *out, int run, const RunResult &r)
+	{
+		for (size_t n = 0; n < r.swarms.size(); n++)
+		{
+			const SwarmMetrics &m = r.swarms[n];
+			double mean_error = m.formation_samples ? m.formation_error_sum / m.formation_samples : 0.0;
+			double min_sep = std::isinf(m.min_separation) ? -1.0 : m.min_separation;
+			// negative clearance is a real reading, so no obstacles leaves the field empty
+			char clearance[32] = "";
+			if (!std::isinf(m.min_clearance))
+				std::snprintf(clearance, sizeof(clearance), "%.3f", m.min_clearance);
+			std::fprintf(out, "%d,%u,%zu,%g,%g,%g,%d,%d,%.2f,%.2f,%llu,%.3f,%llu,%llu,%llu,%s,%.3f,%.3f,%.1f\n",
+						 run, r.params.seed, n, r.params.cohesion, r.params.separation, r.params.alignment,
+						 r.params.obstacles, m.reached_goal ? 1 : 0, m.time_to_goal, m.goal_distance, (unsigned long long)r.ticks,
+						 min_sep, (unsigned long long)m.contact_ticks, (unsigned long long)m.obstacle_ticks,
+						 (unsigned long long)m.collision_ticks, clearance, mean_error, m.formation_error_max, r.wall_ms);
+		}
+	}
+}
+
+bool parse_batch_option(const char *flag, const char *value, BatchConfig &config)
+{
+	BatchRange number{0.0, 0.0};
+	bool numeric = parse_range(value, number) && number.lo == number.hi;
+
+	if (std::strcmp(flag, "--out") == 0)
+		config.out = value;
+	else if (std::strcmp(flag, "--cohesion") == 0)
+		return parse_range(value, config.cohesion);
+	else if (std::strcmp(flag, "--separation") == 0)
+		return parse_range(value, config.separation);
+	else if (std::strcmp(flag, "--alignment") == 0)
+		return parse_range(value, config.alignment);
+	else if (std::strcmp(flag, "--obstacles") == 0)
+		return parse_range(value, config.obstacles) && config.obstacles.lo >= 0;
+	else if (!numeric || number.lo < 0)
+		return false;
+	else if (std::strcmp(flag, "--runs") == 0)
+		config.runs = (int)number.lo;
+	else if (std::strcmp(flag, "--threads") == 0)
+		config.threads = (int)number.lo;
+	else if (std::strcmp(flag, "--seed") == 0)
+		config.seed = (uint32_t)number.lo;
+	else if (std::strcmp(flag, "--ticks") == 0)
+		config.max_ticks = (uint64_t)number.lo;
+	else if (std::strcmp(flag, "--swarms") == 0)
+		config.swarms = std::max(1, (int)number.lo);
+	else if (std::strcmp(flag, "--uavs") == 0)
+		config.uavs = std::clamp((int)number.lo, 1, SWARM_ID_STRIDE);
+	else
+		return false;
+	return true;
+}
+
+int run_batch(const BatchConfig &config)
+{
+	std::FILE *out = std::fopen(config.out.c_str(), "w");
+	if (!out)
+	{
+		std::printf("can't write %s\n", config.out.c_str());
+		return 1;
+	}
+	std::fprintf(out, "run,seed,swarm,cohesion,separation,alignment,obstacles,reached_goal,time_to_goal_s,goal_distance_m,ticks,"
+					  "min_separation_m,contact_ticks,obstacle_ticks,collision_ticks,min_clearance_m,formation_error_mean_m,formation_error_max_m,wall_ms\n");
+
+	// every run gets the tuning the UI would start with, except for the swept weights
+	SwarmTuning base = get_swarm_tuning();
+	ThreadPool pool(config.threads);
+	std::printf("Batch: %d runs of %d x %d UAVs on %d threads, up to %llu ticks each, to %s\n", config.runs,
+				config.swarms, config.uavs, pool.size(), (unsigned long long)config.max_ticks, config.out.c_str());
+
+	auto start = std::chrono::steady_clock::now();
+	std::vector<std::future<RunResult>> runs;
+	runs.reserve(config.runs);
+	for (int run = 0; run < config.runs; run++)
+		runs.push_back(pool.submit([&config, run, &base]()
+								   { return run_one(config, run, base); }));
+
+	// rows go out in run order as soon as every earlier run is done
+	int reached = 0, swarm_rows = 0;
+	for (int run = 0; run < config.runs; run++)
+	{
+		RunResult r = runs[run].get();
+		write_rows(out, run, r);
+		for (const auto &m : r.swarms)
+			reached += m.reached_goal;
+		swarm_rows += r.swarms.size();
+	}
+	std::fclose(out);
+
+	double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::printf("Batch done in %.1f s: %d of %d swarms reached their goal\n", secs, reached, swarm_rows);
+	return 0;
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+// a parameter drawn uniformly from [lo, hi] for every run; lo == hi fixes it
+struct BatchRange
+{
+	double lo;
+	double hi;
+};
+
+struct BatchConfig
+{
+	int runs = 100;
+	int threads = 0;				// 0: one per hardware thread
+	uint32_t seed = 1;				// run n uses seed + n, for its obstacle field and its parameters
+	uint64_t max_ticks = 2400;		// two simulated minutes at UAVDT
+	int swarms = 1;
+	int uavs = 9;					// per swarm
+	BatchRange cohesion{1.0, 1.0};
+	BatchRange separation{10.0, 10.0};
+	BatchRange alignment{1.0, 1.0};
+	BatchRange obstacles{65, 65};
+	std::string out = "batch.csv";
+};
+
+/**
+ * parse_batch_option - applies one `--flag value` pair to a batch config
+ * @flag: --runs, --threads, --seed, --ticks, --swarms, --uavs, --out, or a
+ *	range: --cohesion, --separation, --alignment, --obstacles
+ * @value: a number, or "lo:hi" for a range
+ * @config: updated on success
+ *
+ * Return: false for an unknown flag or a malformed value
+ */
+bool parse_batch_option(const char *flag, const char *value, BatchConfig &config);
+
+/**
+ * run_batch - Monte Carlo runs of headless simulators across every core
+ * @config: how many runs, and the ranges their parameters are drawn from
+ *
+ * Each run is its own UAVSimulator, stepped as fast as it goes on one pool
+ * worker with no UDP traffic, until every swarm reaches its goal or
+ * max_ticks pass. Writes one CSV row per swarm per run: the parameters
+ * drawn, time to goal and how far from it the leader ended up, the closest
+ * two UAVs came, ticks spent with UAVs under a meter apart, inside an
+ * obstacle cell or inside the obstacle itself, the closest any UAV came to
+ * an obstacle surface, and how far followers strayed from their formation
+ * slots. Rows are in run order whatever order the runs finish in. Started with `sim --batch [--flag value]...`.
+ *
+ * Return: process exit code
+ */
+int run_batch(const BatchConfig &config);
@@ -0,0 +1,271 @@
+#include "command_codec.h"
+#include "formation.h"
+#include <charconv>
+#include <cstring>
+#include <string_view>
+
+namespace
+{
+	// wire integers are little-endian whatever the host is
+	uint16_t read_u16(const unsigned char *p) { return p[0] | (p[1] << 8); }
+
+	uint32_t read_u32(const unsigned char *p)
+	{
+		return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+	}
+
+	double read_f64(const unsigned char *p)
+	{
+		uint64_t bits = (uint64_t)read_u32(p) | ((uint64_t)read_u32(p + 4) << 32);
+		double out;
+		memcpy(&out, &bits, sizeof(out));
+		return out;
+	}
+
+	void write_u16(unsigned char *p, uint16_t v)
+	{
+		p[0] = v;
+		p[1] = v >> 8;
+	}
+
+	void write_u32(unsigned char *p, uint32_t v)
+	{
+		for (int i = 0; i < 4; i++)
+			p[i] = v >> (8 * i);
+	}
+
+	void write_f64(unsigned char *p, double v)
+	{
+		uint64_t bits;
+		memcpy(&bits, &v, sizeof(bits));
+		write_u32(p, (uint32_t)bits);
+		write_u32(p + 4, (uint32_t)(bits >> 32));
+	}
+
+	// whitespace separated words of one text command
+	struct Words
+	{
+		const char *p;
+		const char *end;
+
+		bool next(std::string_view &out)
+		{
+			while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r' || *p == '\0'))
+				p++;
+			const char *start = p;
+			while (p < end && !(*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r' || *p == '\0'))
+				p++;
+			out = std::string_view(start, p - start);
+			return !out.empty();
+		}
+
+		template <typename T>
+		bool number(T &out)
+		{
+			std::string_view word;
+			if (!next(word))
+				return false;
+			auto [last, err] = std::from_chars(word.data(), word.data() + word.size(), out);
+			return err == std::errc() && last == word.data() + word.size();
+		}
+
+		bool done()
+		{
+			std::string_view word;
+			return !next(word);
+		}
+	};
+}
+
+/**
+ * is_command_datagram - tells binary command datagrams from text commands
+ * @data: datagram contents
+ * @len: datagram length
+ *
+ * Return: true if the datagram starts with the binary magic
+ */
+bool is_command_datagram(const char *data, size_t len)
+{
+	return len >= 4 && memcmp(data, COMMAND_MAGIC, 4) == 0;
+}
+
+/**
+ * parse_command_datagram - decodes a binary command datagram in place
+ * @data: datagram contents
+ * @len: datagram length
+ * @seq: the sender's sequence number
+ * @out: commands, in the order they are to run
+ * @count: how many of @out were filled
+ *
+ * Ops are passed through unchecked so the caller can report unknown ones.
+ *
+ * Return: false if the header is wrong or the length doesn't match the count
+ */
+bool parse_command_datagram(const char *data, size_t len, uint32_t &seq, SimCommand (&out)[COMMAND_MAX_BATCH], size_t &count)
+{
+	const unsigned char *p = reinterpret_cast<const unsigned char *>(data);
+	count = 0;
+	if (len < COMMAND_HEADER_SIZE || !is_command_datagram(data, len) || p[4] != COMMAND_VERSION)
+		return false;
+
+	size_t n = p[5];
+	if (n > COMMAND_MAX_BATCH || len != COMMAND_HEADER_SIZE + n * COMMAND_SIZE)
+		return false;
+	seq = read_u32(p + 8);
+
+	for (size_t i = 0; i < n; i++)
+	{
+		const unsigned char *c = p + COMMAND_HEADER_SIZE + i * COMMAND_SIZE;
+		SimCommand &cmd = out[i];
+		cmd.op = (CommandOp)c[0];
+		cmd.swarm = read_u16(c + 2);
+		cmd.uav = (int32_t)read_u32(c + 4);
+		for (int a = 0; a < 3; a++)
+			cmd.args[a] = read_f64(c + 8 + 8 * a);
+	}
+	count = n;
+	return true;
+}
+
+/**
+ * parse_text_command - reads one text command, with an optional "swarm <n>" prefix
+ * @text: command text (need not be NUL terminated); trailing whitespace and NULs are ignored
+ * @len: text length
+ * @out: filled on success
+ *
+ * Accepts "1"/"line", "2"/"vee", "3"/"circle", "move_leader <accelerate|decelerate|left|right>",
+ * "altitude_change <m>", "rtb", "goal <x> <y> <z>", "flight_mode <autonomous|controlled>",
+ * "resize <n>", "environment", "uav <id> velocity <vx> <vy> <vz>" and "uav <id> release".
+ *
+ * Return: false for anything else
+ */
+bool parse_text_command(const char *text, size_t len, SimCommand &out)
+{
+	Words w{text, text + len};
+	std::string_view word;
+
+	out = SimCommand{};
+	out.uav = COMMAND_ANY_UAV;
+	if (!w.next(word))
+		return false;
+	if (word == "swarm")
+	{
+		if (!w.number(out.swarm) || out.swarm < 0 || !w.next(word))
+			return false;
+	}
+
+	if (word == "1" || word == "line" || word == "2" || word == "vee" || word == "3" || word == "circle")
+	{
+		out.op = CommandOp::FORMATION;
+		if (word == "1" || word == "line")
+			out.args[0] = LINE;
+		else if (word == "2" || word == "vee")
+			out.args[0] = FLYING_V;
+		else
+			out.args[0] = CIRCLE;
+	}
+	else if (word == "move_leader")
+	{
+		out.op = CommandOp::MOVE_LEADER;
+		if (!w.next(word))
+			return false;
+		if (word == "accelerate")
+			out.args[0] = (double)LeaderMove::ACCELERATE;
+		else if (word == "decelerate")
+			out.args[0] = (double)LeaderMove::DECELERATE;
+		else if (word == "left")
+			out.args[0] = (double)LeaderMove::LEFT;
+		else if (word == "right")
+			out.args[0] = (double)LeaderMove::RIGHT;
+		else
+			return false;
+	}
+	else if (word == "altitude_change")
+	{
+		out.op = CommandOp::ALTITUDE_CHANGE;
+		if (!w.number(out.args[0]))
+			return false;
+	}
+	else if (word == "rtb")
+		out.op = CommandOp::RTB;
+	else if (word == "goal")
+	{
+		out.op = CommandOp::GOAL;
+		if (!w.number(out.args[0]) || !w.number(out.args[1]) || !w.number(out.args[2]))
+			return false;
+	}
+	else if (word == "flight_mode")
+	{
+		out.op = CommandOp::FLIGHT_MODE;
+		if (!w.next(word))
+			return false;
+		if (word == "autonomous")
+			out.args[0] = 1;
+		else if (word == "controlled")
+			out.args[0] = 0;
+		else
+			return false;
+	}
+	else if (word == "resize")
+	{
+		out.op = CommandOp::RESIZE;
+		if (!w.number(out.args[0]))
+			return false;
+	}
+	else if (word == "environment")
+		out.op = CommandOp::ENVIRONMENT;
+	else if (word == "uav")
+	{
+		if (!w.number(out.uav) || out.uav < 0 || !w.next(word))
+			return false;
+		if (word == "velocity")
+		{
+			out.op = CommandOp::SET_VELOCITY;
+			if (!w.number(out.args[0]) || !w.number(out.args[1]) || !w.number(out.args[2]))
+				return false;
+		}
+		else if (word == "release")
+			out.op = CommandOp::RELEASE;
+		else
+			return false;
+	}
+	else
+		return false;
+
+	return w.done();
+}
+
+/**
+ * format_command_datagram - encodes commands as one binary datagram
+ * @seq: sequence number, one more than the sender's previous datagram
+ * @cmds: commands to send
+ * @count: at most COMMAND_MAX_BATCH
+ * @buf: output
+ * @cap: size of @buf
+ *
+ * Return: bytes written, or 0 if they don't fit
+ */
+size_t format_command_datagram(uint32_t seq, const SimCommand *cmds, size_t count, char *buf, size_t cap)
+{
+	size_t len = COMMAND_HEADER_SIZE + count * COMMAND_SIZE;
+	if (count > COMMAND_MAX_BATCH || len > cap)
+		return 0;
+
+	unsigned char *p = reinterpret_cast<unsigned char *>(buf);
+	memset(p, 0, len);
+	memcpy(p, COMMAND_MAGIC, 4);
+	p[4] = COMMAND_VERSION;
+	p[5] = (unsigned char)count;
+	write_u32(p + 8, seq);
+
+	for (size_t i = 0; i < count; i++)
+	{
+		unsigned char *c = p + COMMAND_HEADER_SIZE + i * COMMAND_SIZE;
+		c[0] = (unsigned char)cmds[i].op;
+		write_u16(c + 2, (uint16_t)cmds[i].swarm);
+		write_u32(c + 4, (uint32_t)cmds[i].uav);
+		for (int a = 0; a < 3; a++)
+			write_f64(c + 8 + 8 * a, cmds[i].args[a]);
+	}
+	return len;
+}
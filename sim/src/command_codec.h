@@ -0,0 +1,65 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Simulator commands, binary and text
+ *
+ * A binary datagram is a 12 byte header followed by `count` fixed 32 byte
+ * commands, all little-endian:
+ *
+ *   header:  char magic[4] = "SWCM"; u8 version = 1; u8 count; u16 reserved; u32 seq
+ *   command: u8 op; u8 reserved; u16 swarm; i32 uav; f64 args[3]
+ *
+ * `seq` increases by one per datagram from each sender; the listener drops
+ * datagrams a little older than the newest one it has seen from that sender.
+ * A sender that restarts may begin again from any seq. `uav` is
+ * a UAV id, which then also picks the swarm, or COMMAND_ANY_UAV for the
+ * swarm's leader. The commands of one datagram run in order.
+ *
+ * Anything not starting with the magic is read as one text command, e.g.
+ * "swarm 1 goal 100 -100 60". Both forms decode into SimCommand.
+ */
+
+#define COMMAND_MAGIC "SWCM"
+#define COMMAND_VERSION 1
+#define COMMAND_HEADER_SIZE 12
+#define COMMAND_SIZE 32
+#define COMMAND_MAX_BATCH 64
+#define COMMAND_DATAGRAM_MAX (COMMAND_HEADER_SIZE + COMMAND_MAX_BATCH * COMMAND_SIZE)
+#define COMMAND_ANY_UAV (-1)
+
+enum class CommandOp : uint8_t
+{
+	FORMATION = 1,			// args[0]: formation
+	MOVE_LEADER = 2,		// args[0]: LeaderMove
+	ALTITUDE_CHANGE = 3,	// args[0]: meters, positive climbs
+	RTB = 4,
+	GOAL = 5,				// args: x, y, z; turns autopilot on
+	FLIGHT_MODE = 6,		// args[0]: 1 autonomous, 0 controlled
+	SET_VELOCITY = 7,		// args: vx, vy, vz; puts the UAV under manual control
+	RELEASE = 8,			// hands a manual UAV back to autonomy
+	RESIZE = 9,				// args[0]: UAVs in the swarm, leader included
+	ENVIRONMENT = 10,		// streams the whole environment to telemetry again
+};
+
+enum class LeaderMove : uint8_t
+{
+	ACCELERATE = 0,
+	DECELERATE,
+	LEFT,
+	RIGHT,
+};
+
+struct SimCommand
+{
+	CommandOp op;
+	int swarm;
+	int32_t uav;
+	double args[3];
+};
+
+bool is_command_datagram(const char *data, size_t len);
+bool parse_command_datagram(const char *data, size_t len, uint32_t &seq, SimCommand (&out)[COMMAND_MAX_BATCH], size_t &count);
+bool parse_text_command(const char *text, size_t len, SimCommand &out);
+size_t format_command_datagram(uint32_t seq, const SimCommand *cmds, size_t count, char *buf, size_t cap);
@@ -1,30 +1,8 @@
 #include "environment.h"
+#include "logger.h"
 
 using json = nlohmann::json;
 
-struct Cylinder
-{
-	double x, y, z, radius, height;
-
-	Cylinder(double x_, double y_, double z_,
-			 double rad_, double h_)
-		: x(x_), y(y_), z(z_), radius(rad_), height(h_) {}
-};
-struct Box
-{
-	double x, y, z, width, depth, height;
-
-	Box(double x_, double y_, double z_, double wid_, double dep_, double h_)
-		: x(x_), y(y_), z(z_), width(wid_), depth(dep_), height(h_) {}
-};
-struct Sphere
-{
-	double x, y, z, radius;
-
-	Sphere(double x_, double y_, double z_, double rad_)
-		: x(x_), y(y_), z(z_), radius(rad_) {}
-};
-
 void to_json(json &j, Cylinder const &c)
 {
 	j = {
@@ -77,10 +55,34 @@ bool Environment::inBounds(int i, int j, int k) const
  * @j: y-value
  * @k: z-value
  * @blocked: 1 if blocked, 0 otherwise
+ *
+ * Bumps the occupancy version when the cell actually changes so planner
+ * caches built on top of the grid know to refresh.
  */
 void Environment::setBlock(int i, int j, int k, bool blocked)
 {
-	occupancy[idx(i, j, k)] = blocked;
+	uint8_t &cell = occupancy[idx(i, j, k)];
+	if (cell != blocked)
+	{
+		cell = blocked;
+		padded[padIdx(i, j, k)] = blocked;
+		version++;
+	}
+}
+
+/**
+ * initPadded - builds the padded copy of an all-free grid
+ *
+ * Border cells stay blocked forever, so a search expanding any interior cell
+ * can read all 26 neighbors without bounds checks.
+ */
+void Environment::initPadded()
+{
+	padded.assign((nx + 2) * (ny + 2) * (nz + 2), 1);
+	for (int k = 0; k < nz; k++)
+		for (int j = 0; j < ny; j++)
+			for (int i = 0; i < nx; i++)
+				padded[padIdx(i, j, k)] = occupancy[idx(i, j, k)];
 }
 
 /**
@@ -133,6 +135,42 @@ std::array<double, 3> Environment::toWorld(int i, int j, int k) const
 	return {x, y, z};
 }
 
+/**
+ * segmentClear - checks a world-space segment against the obstacles
+ * @A: segment start in world space
+ * @B: segment end in world space
+ *
+ * The grid is a conservative filter: a segment crossing only free cells
+ * touches nothing. Only when it crosses a blocked cell are the exact shapes
+ * asked, so voxel rounding and box margins don't block lines that clear them.
+ *
+ * Return: true if the segment stays in bounds and touches no obstacle
+ */
+bool Environment::segmentClear(const std::array<double, 3> &A, const std::array<double, 3> &B) const
+{
+	bool flagged = false;
+	bool inside = walkSegment(A, B, [&](int i, int j, int k)
+							  {
+		if (!inBounds(i, j, k))
+			return false;
+		flagged = flagged || isBlocked(i, j, k);
+		return true; });
+	return inside && (!flagged || primitives.segmentClear(A, B));
+}
+
+/**
+ * cellSegmentClear - checks the segment between two cell centers against the grid
+ * @A: start cell
+ * @B: end cell
+ *
+ * Return: true if every cell the segment crosses is free and in bounds
+ */
+bool Environment::cellSegmentClear(const std::array<int, 3> &A, const std::array<int, 3> &B) const
+{
+	return walkCells(A, B, [this](int i, int j, int k)
+					 { return !isBlocked(i, j, k); });
+}
+
 /**
  * addBox - creates a box in grid space and sets it as blocked using world space coords
  * @x0: initial x corner
@@ -164,12 +202,23 @@ void Environment::addBox(double x0, double y0, double z0, double x1, double y1,
 
 	Box b{0.5 * (x0 + x1), 0.5 * (y0 + y1), 0.5 * (z0 + z1), fabs(x1 - x0), fabs(y1 - y0), fabs(z1 - z0)};
 	msg["obstacles"].push_back(b);
+	primitives.add(b);
+	obstacle_revisions.push_back(++revision);
+}
+
+// distance along one axis from p to the cell spanning [lo, lo + size], 0 inside it
+static inline double cellGap(double p, double lo, double size)
+{
+	return std::max({lo - p, 0.0, p - (lo + size)});
 }
 
 /**
  * addSphere - creates a sphere in grid space and sets it as blocked using world space coords
  * @center: center of sphere
  * @radius: radius of sphere
+ *
+ * Every cell the sphere reaches into is blocked, not just those whose center
+ * it covers, so a free cell is guaranteed to be clear of it.
  */
 void Environment::addSphere(const std::array<double, 3> &center, double radius)
 {
@@ -181,19 +230,19 @@ void Environment::addSphere(const std::array<double, 3> &center, double radius)
 	{
 		if (k < 0 || k >= nz)
 			continue;
+		double gz = cellGap(center[2], origin[2] + k * resolution, resolution);
 		for (int j = gc[1] - r; j <= gc[1] + r; ++j)
 		{
 			if (j < 0 || j >= ny)
 				continue;
+			double gy = cellGap(center[1], origin[1] + j * resolution, resolution);
 			for (int i = gc[0] - r; i <= gc[0] + r; ++i)
 			{
 				if (i < 0 || i >= nx)
 					continue;
-				auto wc = toWorld(i, j, k);
-				double dx = wc[0] - center[0];
-				double dy = wc[1] - center[1];
-				double dz = wc[2] - center[2];
-				if (dx * dx + dy * dy + dz * dz <= radius * radius)
+				// nearest point of the cell to the center
+				double gx = cellGap(center[0], origin[0] + i * resolution, resolution);
+				if (gx * gx + gy * gy + gz * gz <= radius * radius)
 					setBlock(i, j, k, true);
 			}
 		}
@@ -201,6 +250,8 @@ void Environment::addSphere(const std::array<double, 3> &center, double radius)
 
 	Sphere s{center[0], center[1], center[2], radius};
 	msg["obstacles"].push_back(s);
+	primitives.add(s);
+	obstacle_revisions.push_back(++revision);
 }
 
 /**
@@ -208,46 +259,36 @@ void Environment::addSphere(const std::array<double, 3> &center, double radius)
  * @center: center of cylinder
  * @radius: radius of cylinder
  * @height: height of cylinder
+ *
+ * Like addSphere, blocks every cell the cylinder reaches into.
  */
 void Environment::addCylinder(const std::array<double, 3> &center, double radius, double height)
 {
 	std::array<int, 3> gc = toGrid(center);
-
 	int r_cell = int(ceil(radius / resolution));
-	int h_cell = int(ceil(height / 2.0));
 
 	double r_sq = radius * radius;
 	double half_h = height / 2.0;
 
-	for (int k = gc[2] - h_cell; k <= gc[2] + h_cell; k++)
-	{
-		// allow k == 0 so the cylinder's base sits on the grid instead of floating
-		if (k < 0 || k >= nz)
-			continue;
-		// world Z-value of this layer's center
-		double wz = origin[2] + (k + 0.5) * resolution;
-		double dz = wz - center[2];
-		if (std::fabs(dz) > half_h)
-			continue;
+	// layers spanned by the cylinder from its base to its top
+	int k0 = toGrid({center[0], center[1], center[2] - half_h})[2];
+	int k1 = toGrid({center[0], center[1], center[2] + half_h})[2];
 
+	for (int k = std::max(0, k0); k <= std::min(nz - 1, k1); k++)
+	{
 		for (int j = gc[1] - r_cell; j <= gc[1] + r_cell; j++)
 		{
-			if (j < 0 || j > ny)
+			if (j < 0 || j >= ny)
 				continue;
-			// world Y-value of row's center
-			double wy = origin[1] + (j + 0.5) * resolution;
-			double dy = wy - center[1];
+			double gy = cellGap(center[1], origin[1] + j * resolution, resolution);
 
 			for (int i = gc[0] - r_cell; i <= gc[0] + r_cell; i++)
 			{
 				if (i < 0 || i >= nx)
 					continue;
-				// world X-value of column's center
-				double wx = origin[0] + (i + 0.5) * resolution;
-				double dx = wx - center[0];
-
-				// if x,y coords within radius and |dz| <= height / 2
-				if (dx * dx + dy * dy <= r_sq)
+				// the cell's nearest point to the axis is within the radius
+				double gx = cellGap(center[0], origin[0] + i * resolution, resolution);
+				if (gx * gx + gy * gy <= r_sq)
 					setBlock(i, j, k, true);
 			}
 		}
@@ -255,6 +296,8 @@ void Environment::addCylinder(const std::array<double, 3> &center, double radius
 
 	Cylinder c(center[0], center[1], center[2], radius, height);
 	msg["obstacles"].push_back(c);
+	primitives.add(c);
+	obstacle_revisions.push_back(++revision);
 }
 
 // helper to round to 2 decimal places to shrink JSON size
@@ -262,7 +305,7 @@ static inline double round2(double v) {
 	return std::round(v * 100.0) / 100.0;
 }
 
-void Environment::generate_random_obstacles(int count)
+void Environment::generate_random_obstacles(int count, uint32_t seed)
 {
 	if (count <= 0)
 		return;
@@ -270,9 +313,12 @@ void Environment::generate_random_obstacles(int count)
 	const double obstacle_scale = 2.0;
 	// reset JSON obstacle list; grid will be updated by addBox/addSphere/addCylinder
 	msg["obstacles"] = json::array();
+	primitives.clear();
+	obstacle_revisions.clear();
+	reset_revision = ++revision;
 
 	// RNG setup for random obstacle generation
-	std::mt19937 rng(std::random_device{}());
+	std::mt19937 rng(seed ? seed : std::random_device{}());
 
 	int max_ix = std::max(0, nx - 1);
 	int max_iy = std::max(0, ny - 1);
@@ -445,12 +491,14 @@ void Environment::generate_random_obstacles(int count)
 			addSphere(center, radius);
 		}
 	}
+	primitives.build();
 }
 
 void Environment::setGoal(const std::array<double, 3> &center, double radius)
 {
 	goal_set = true;
 	goal_data = {center[0], center[1], center[2], radius};
+	goal_revision = ++revision;
 	msg["goal"] = {
 		{"x", center[0]},
 		{"y", center[1]},
@@ -460,72 +508,154 @@ void Environment::setGoal(const std::array<double, 3> &center, double radius)
 }
 
 /**
- * environment_to_rust - sends environment json str to rust server
+ * restore - replaces the grid, obstacle list and goal with saved ones
+ * @cells: occupancy in getOccupancy's layout, same dimensions as this grid
+ * @message: obstacle list and goal, from dumpMessage
+ *
+ * The version moves on, so anything cached against the old grid is rebuilt.
+ *
+ * Return: false (and nothing changed) if the cell count or message is wrong
  */
-int Environment::environment_to_rust(int port)
+bool Environment::restore(const std::vector<uint8_t>& cells, const std::string& message)
 {
-	int socketfd;
-	ssize_t sendto_return = 0, json_size;
-	struct sockaddr_in addr;
-
-	std::string json_str = msg.dump();
-
-	std::cout << "DEBUG: environment_to_rust called with string length: " << json_str.length() << std::endl;
-	std::cout << "DEBUG: JSON content: '" << json_str << "'" << std::endl;
-
-	socketfd = socket(AF_INET, SOCK_DGRAM, 0);
-	if (socketfd < 0)
+	nlohmann::json restored = nlohmann::json::parse(message, nullptr, false);
+	if (cells.size() != occupancy.size() || restored.is_discarded() || !restored.contains("obstacles") ||
+		!restored["obstacles"].is_array())
+		return false;
+
+	// every entry has to be a shape we know, or ids would drift from the list
+	ObstacleStore shapes;
+	for (const json &o : restored["obstacles"])
 	{
-		std::cout << "DEBUG: failed to create UDP socket in json_to_rust" << std::endl;
-		return 0;
+		std::string type = o.is_object() ? o.value("type", "") : "";
+		double x = o.value("x", 0.0), y = o.value("y", 0.0), z = o.value("z", 0.0);
+		if (type == "box")
+			shapes.add(Box(x, y, z, o.value("width", 0.0), o.value("depth", 0.0), o.value("height", 0.0)));
+		else if (type == "sphere")
+			shapes.add(Sphere(x, y, z, o.value("radius", 0.0)));
+		else if (type == "cylinder")
+			shapes.add(Cylinder(x, y, z, o.value("radius", 0.0), o.value("height", 0.0)));
+		else
+			return false;
 	}
 
-	json_size = json_str.length();
-
-	const char *host_env = std::getenv("SKYWEAVE_UDP_HOST");
-	const char *host = host_env ? host_env : "127.0.0.1";
-
-	memset(&addr, 0, sizeof(addr));
-	addr.sin_family = AF_INET;
-	addr.sin_port = htons(port);
-
-	// Resolve hostname to IPv4 address (supports DNS names like *.fly.dev)
-	addrinfo hints;
-	memset(&hints, 0, sizeof(hints));
-	hints.ai_family = AF_INET;
-	hints.ai_socktype = SOCK_DGRAM;
+	occupancy = cells;
+	initPadded();
+	version++;
+
+	primitives = std::move(shapes);
+	primitives.build();
+	msg = std::move(restored);
+	reset_revision = goal_revision = ++revision;
+	obstacle_revisions.assign(msg["obstacles"].size(), revision);
+	const nlohmann::json &goal = msg["goal"];
+	goal_set = goal.is_object();
+	if (goal_set)
+		goal_data = {goal.value("x", 0.0), goal.value("y", 0.0), goal.value("z", 0.0), goal.value("radius", 0.0)};
+	return true;
+}
 
-	addrinfo *res = nullptr;
-	int gai_err = getaddrinfo(host, nullptr, &hints, &res);
-	if (gai_err != 0 || res == nullptr)
+/**
+ * changedRecords - obstacles and goal changed after a revision, as stream records
+ * @since: revision the receiver already has, 0 for everything
+ *
+ * Return: records in obstacle order, the goal last
+ */
+std::vector<EnvRecord> Environment::changedRecords(uint32_t since) const
+{
+	std::vector<EnvRecord> records;
+	const std::vector<Obstacle> &obstacles = primitives.all();
+	for (size_t n = 0; n < obstacles.size() && n < obstacle_revisions.size(); n++)
 	{
-		std::cout << "DEBUG: getaddrinfo failed for host " << host << ": " << gai_strerror(gai_err) << std::endl;
-		close(socketfd);
-		return 0;
+		if (obstacle_revisions[n] <= since)
+			continue;
+		EnvRecord rec{};
+		rec.id = n;
+		std::visit([&rec](const auto &shape)
+				   {
+			rec.params[0] = shape.x;
+			rec.params[1] = shape.y;
+			rec.params[2] = shape.z; }, obstacles[n]);
+		if (const Box *b = std::get_if<Box>(&obstacles[n]))
+		{
+			rec.shape = EnvShape::BOX;
+			rec.params[3] = b->width;
+			rec.params[4] = b->depth;
+			rec.params[5] = b->height;
+		}
+		else if (const Sphere *s = std::get_if<Sphere>(&obstacles[n]))
+		{
+			rec.shape = EnvShape::SPHERE;
+			rec.params[3] = s->radius;
+		}
+		else if (const Cylinder *c = std::get_if<Cylinder>(&obstacles[n]))
+		{
+			rec.shape = EnvShape::CYLINDER;
+			rec.params[3] = c->radius;
+			rec.params[4] = c->height;
+		}
+		records.push_back(rec);
 	}
 
-	auto *addr_in = reinterpret_cast<sockaddr_in *>(res->ai_addr);
-	addr.sin_addr = addr_in->sin_addr;
-	freeaddrinfo(res);
-
-	// send to Rust UDP listener
-	sendto_return = sendto(socketfd, json_str.c_str(), json_size, 0, (struct sockaddr *)&addr, sizeof(addr));
-	std::cout << "DEBUG: sendto returned " << sendto_return << " bytes" << std::endl;
-	if (sendto_return == -1)
-	{
-		std::ostringstream err;
-		err << "DEBUG: sendto in json_to_rust returned -1 errno=" << errno << " (" << strerror(errno) << ")";
-		std::cout << err.str() << std::endl;
-		close(socketfd);
-		return 0;
-	}
-	if (sendto_return != json_size)
+	if (goal_set && goal_revision > since)
 	{
-		std::cout << "DEBUG: sendto in json_to_rust sent size mismatch" << std::endl;
-		close(socketfd);
-		return 0;
+		EnvRecord rec{};
+		rec.shape = EnvShape::GOAL;
+		rec.id = ENV_GOAL_ID;
+		for (int a = 0; a < 4; a++)
+			rec.params[a] = goal_data[a];
+		records.push_back(rec);
 	}
+	return records;
+}
+
+/**
+ * streamAll - formats the whole environment as a chunked stream
+ * @reply_port: command port receivers ask for a resend on
+ *
+ * Only formats; the caller sends the chunks, after releasing whatever lock
+ * guards the environment. The receivers count as brought up to date.
+ *
+ * Return: the stream's datagrams, in order
+ */
+std::vector<std::string> Environment::streamAll(uint16_t reply_port)
+{
+	return formatStream(ENV_FULL, reply_port);
+}
 
-	close(socketfd);
-	return 1;
+/**
+ * streamChanges - formats only what changed since the last stream
+ * @reply_port: command port receivers ask for a resend on
+ *
+ * Falls back to the whole environment if nothing was streamed yet or the
+ * obstacle list was replaced since.
+ *
+ * Return: the stream's datagrams, empty if nothing changed
+ */
+std::vector<std::string> Environment::streamChanges(uint16_t reply_port)
+{
+	if (!sent || sent_revision < reset_revision)
+		return formatStream(ENV_FULL, reply_port);
+	if (sent_revision == revision)
+		return {};
+	return formatStream(0, reply_port);
+}
+
+/**
+ * formatStream - formats the environment as a chunked stream
+ * @flags: ENV_FULL for everything, 0 for changes since sent_revision
+ * @reply_port: command port receivers ask for a resend on
+ *
+ * Return: the stream's datagrams, in order
+ */
+std::vector<std::string> Environment::formatStream(uint8_t flags, uint16_t reply_port)
+{
+	uint32_t since = (flags & ENV_FULL) ? 0 : sent_revision;
+	std::vector<std::string> chunks = format_environment_stream(changedRecords(since), flags, revision, since,
+																msg["obstacles"].size(), reply_port);
+	LOG_DEBUG("formatStream: revision %u in %zu chunks", revision, chunks.size());
+
+	sent = true;
+	sent_revision = revision;
+	return chunks;
 }
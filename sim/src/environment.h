@@ -17,6 +17,9 @@
 #include <random>
 #include <cerrno>
 #include <sstream>
+#include <limits>
+#include "environment_codec.h"
+#include "obstacle_store.h"
 
 /**
  * Environment Class Concepts
@@ -39,6 +42,17 @@ private:
 	nlohmann::json msg;				// json to send to telemetry (to send to rust)
 	bool goal_set = false;
 	std::array<double, 4> goal_data{}; // x, y, z, radius
+	uint64_t version = 0;			// bumped whenever a cell's occupancy changes
+	std::vector<uint8_t> padded;	// occupancy again, wrapped in a one-cell blocked border
+	ObstacleStore primitives;		// exact shapes, in msg["obstacles"] order
+
+	// streamed to telemetry: what changed, by world revision
+	uint32_t revision = 0;					// bumped whenever an obstacle is added or the goal moves
+	std::vector<uint32_t> obstacle_revisions;	// revision each entry of msg["obstacles"] arrived in
+	uint32_t goal_revision = 0;
+	uint32_t reset_revision = 0;			// last time the obstacle list was replaced outright
+	uint32_t sent_revision = 0;				// revision the receivers were last brought to
+	bool sent = false;
 
 public:
 	Environment(int nx_, int ny_, int nz_, double res_) : nx(nx_),
@@ -51,6 +65,7 @@ public:
 		msg["type"] = "environment";
 		msg["obstacles"] = nlohmann::json::array();
 		msg["goal"] = nullptr;
+		initPadded();
 	}
 
 	// Getters
@@ -59,6 +74,14 @@ public:
 	int getNz() const { return nz; }
 	double getResolution() const { return resolution; }
 	std::array<double, 3> getOrigin() const { return origin; }
+	uint64_t getVersion() const { return version; }
+	const std::vector<uint8_t>& getOccupancy() const { return occupancy; }
+	const std::vector<uint8_t>& getPadded() const { return padded; }
+	std::string dumpMessage() const { return msg.dump(); }	// obstacle list and goal, as sent to telemetry
+	const ObstacleStore& getObstacles() const { return primitives; }	// exact distance, ray and segment queries
+
+	// padded layout: (nx + 2) x (ny + 2) x (nz + 2), cell (i, j, k) sits at (i + 1, j + 1, k + 1)
+	inline int padIdx(int i, int j, int k) const { return (((k + 1) * (ny + 2) + (j + 1)) * (nx + 2) + (i + 1)); }
 
 	bool inBounds(int i, int j, int k) const;
 	void setBlock(int i, int j, int k, bool blocked);
@@ -67,13 +90,212 @@ public:
 	std::array<int, 3> toGrid(const std::array<double, 3> &point) const;
 	std::array<double, 3> toWorld(int i, int j, int k) const;
 
+	// voxel traversal: visit(i, j, k) returns false to stop the walk early
+	template <typename Visitor>
+	bool walkSegment(const std::array<double, 3> &A, const std::array<double, 3> &B, Visitor visit) const;
+	template <typename Visitor>
+	bool walkCells(const std::array<int, 3> &A, const std::array<int, 3> &B, Visitor visit) const;
+	bool segmentClear(const std::array<double, 3> &A, const std::array<double, 3> &B) const;
+	bool cellSegmentClear(const std::array<int, 3> &A, const std::array<int, 3> &B) const;
+
 	void addBox(double x0, double y0, double z0, double x1, double y1, double z1);
 	void addSphere(const std::array<double, 3> &center, double radius);
 	void addCylinder(const std::array<double, 3> &center, double radius, double height);
-	void generate_random_obstacles(int count);
+	void generate_random_obstacles(int count, uint32_t seed = 0);	// seed 0: nondeterministic
 	void setGoal(const std::array<double, 3>& center, double radius);
-	int environment_to_rust(int port);
+	bool restore(const std::vector<uint8_t>& cells, const std::string& message);
+	std::vector<std::string> streamAll(uint16_t reply_port);
+	std::vector<std::string> streamChanges(uint16_t reply_port);
 
 private:
 	inline int idx(int i, int j, int k) const { return ((k * ny + j) * nx + i); }
+	void initPadded();
+	std::vector<EnvRecord> changedRecords(uint32_t since) const;
+	std::vector<std::string> formatStream(uint8_t flags, uint16_t reply_port);
 };
+
+/**
+ * walkSegment - Amanatides-Woo traversal of every cell a world-space segment crosses
+ * @A: segment start in world space
+ * @B: segment end in world space
+ * @visit: called with (i, j, k) per cell in order; return false to stop
+ *
+ * Cell indices advance by integer steps; only the per-axis boundary distances
+ * are floating point. When the segment crosses an edge or corner exactly,
+ * every cell touching that point is visited as well (supercover), so nothing
+ * the segment grazes is skipped.
+ *
+ * Return: false if the visitor stopped the walk, true otherwise
+ */
+template <typename Visitor>
+bool Environment::walkSegment(const std::array<double, 3> &A, const std::array<double, 3> &B, Visitor visit) const
+{
+	std::array<int, 3> cur = toGrid(A);
+	std::array<int, 3> end = toGrid(B);
+	std::array<int, 3> step;
+	std::array<double, 3> t_max, t_delta;
+	const double inf = std::numeric_limits<double>::infinity();
+	const double tie_eps = 1e-9;
+
+	int remaining = 0;
+	for (int a = 0; a < 3; a++)
+	{
+		double d = B[a] - A[a];
+		step[a] = (end[a] > cur[a]) - (end[a] < cur[a]);
+		remaining += std::abs(end[a] - cur[a]);
+		if (step[a] == 0)
+		{
+			t_max[a] = inf;
+			t_delta[a] = inf;
+			continue;
+		}
+		double boundary = origin[a] + (cur[a] + (step[a] > 0 ? 1 : 0)) * resolution;
+		t_max[a] = (boundary - A[a]) / d;
+		t_delta[a] = resolution / std::fabs(d);
+	}
+
+	if (!visit(cur[0], cur[1], cur[2]))
+		return false;
+
+	while (remaining > 0)
+	{
+		double t_next = inf;
+		for (int a = 0; a < 3; a++)
+			if (cur[a] != end[a])
+				t_next = std::min(t_next, t_max[a]);
+		std::array<int, 3> tied = {0, 0, 0};
+		int ties = 0;
+		for (int a = 0; a < 3; a++)
+		{
+			if (cur[a] != end[a] && t_max[a] - t_next <= tie_eps)
+			{
+				tied[a] = 1;
+				ties++;
+			}
+		}
+
+		// crossing an edge or corner: the side cells touch the segment too
+		if (ties > 1)
+		{
+			for (int mask = 1; mask < 7; mask++)
+			{
+				int bits = (mask & 1) + ((mask >> 1) & 1) + ((mask >> 2) & 1);
+				if (bits >= ties)
+					continue;
+				bool proper = true;
+				std::array<int, 3> side = cur;
+				for (int a = 0; a < 3; a++)
+				{
+					if (mask & (1 << a))
+					{
+						proper = proper && tied[a];
+						side[a] += step[a];
+					}
+				}
+				if (proper && !visit(side[0], side[1], side[2]))
+					return false;
+			}
+		}
+
+		for (int a = 0; a < 3; a++)
+		{
+			if (tied[a])
+			{
+				cur[a] += step[a];
+				t_max[a] += t_delta[a];
+				remaining--;
+			}
+		}
+		if (!visit(cur[0], cur[1], cur[2]))
+			return false;
+	}
+	return true;
+}
+
+/**
+ * walkCells - exact traversal of the segment between two cell centers
+ * @A: start cell
+ * @B: end cell
+ * @visit: called with (i, j, k) per cell in order; return false to stop
+ *
+ * Pure integer version of walkSegment: the next boundary along axis a is at
+ * t = (2 * steps_a + 1) / (2 * |d_a|), so axes are compared by cross-multiplying.
+ *
+ * Return: false if the visitor stopped the walk, true otherwise
+ */
+template <typename Visitor>
+bool Environment::walkCells(const std::array<int, 3> &A, const std::array<int, 3> &B, Visitor visit) const
+{
+	std::array<int, 3> cur = A;
+	std::array<int, 3> step, len, taken = {0, 0, 0};
+	for (int a = 0; a < 3; a++)
+	{
+		int d = B[a] - A[a];
+		step[a] = (d > 0) - (d < 0);
+		len[a] = std::abs(d);
+	}
+
+	if (!visit(cur[0], cur[1], cur[2]))
+		return false;
+
+	int remaining = len[0] + len[1] + len[2];
+	while (remaining > 0)
+	{
+		// find the axes whose next boundary comes first
+		int first = -1;
+		for (int a = 0; a < 3; a++)
+		{
+			if (taken[a] == len[a])
+				continue;
+			if (first < 0 || (long long)(2 * taken[a] + 1) * len[first] < (long long)(2 * taken[first] + 1) * len[a])
+				first = a;
+		}
+		std::array<int, 3> tied = {0, 0, 0};
+		int ties = 0;
+		for (int a = 0; a < 3; a++)
+		{
+			if (taken[a] == len[a])
+				continue;
+			if ((long long)(2 * taken[a] + 1) * len[first] == (long long)(2 * taken[first] + 1) * len[a])
+			{
+				tied[a] = 1;
+				ties++;
+			}
+		}
+
+		if (ties > 1)
+		{
+			for (int mask = 1; mask < 7; mask++)
+			{
+				int bits = (mask & 1) + ((mask >> 1) & 1) + ((mask >> 2) & 1);
+				if (bits >= ties)
+					continue;
+				bool proper = true;
+				std::array<int, 3> side = cur;
+				for (int a = 0; a < 3; a++)
+				{
+					if (mask & (1 << a))
+					{
+						proper = proper && tied[a];
+						side[a] += step[a];
+					}
+				}
+				if (proper && !visit(side[0], side[1], side[2]))
+					return false;
+			}
+		}
+
+		for (int a = 0; a < 3; a++)
+		{
+			if (tied[a])
+			{
+				cur[a] += step[a];
+				taken[a]++;
+				remaining--;
+			}
+		}
+		if (!visit(cur[0], cur[1], cur[2]))
+			return false;
+	}
+	return true;
+}
@@ -0,0 +1,81 @@
+#include "environment_codec.h"
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+	// wire integers are little-endian whatever the host is
+	void write_u16(unsigned char *p, uint16_t v)
+	{
+		p[0] = v;
+		p[1] = v >> 8;
+	}
+
+	void write_u32(unsigned char *p, uint32_t v)
+	{
+		for (int i = 0; i < 4; i++)
+			p[i] = v >> (8 * i);
+	}
+
+	void write_f32(unsigned char *p, float v)
+	{
+		uint32_t bits;
+		memcpy(&bits, &v, sizeof(bits));
+		write_u32(p, bits);
+	}
+}
+
+/**
+ * format_environment_stream - splits records into environment chunks
+ * @records: obstacles (and goal) to send
+ * @flags: ENV_FULL for the whole world, 0 for changes since @base
+ * @revision: world revision the stream brings the receiver to
+ * @base: revision the changes apply on top of; ignored with ENV_FULL
+ * @total: obstacle count at @revision
+ * @reply_port: command port a receiver asks for a full resend on
+ *
+ * An empty full stream is still one chunk, so a receiver learns the world is empty.
+ *
+ * Return: one datagram per chunk, in order
+ */
+std::vector<std::string> format_environment_stream(const std::vector<EnvRecord> &records, uint8_t flags,
+												   uint32_t revision, uint32_t base, uint32_t total,
+												   uint16_t reply_port)
+{
+	size_t chunks = (records.size() + ENV_CHUNK_RECORDS - 1) / ENV_CHUNK_RECORDS;
+	if (chunks == 0)
+		chunks = 1;
+
+	std::vector<std::string> out;
+	out.reserve(chunks);
+	for (size_t c = 0; c < chunks; c++)
+	{
+		size_t first = c * ENV_CHUNK_RECORDS;
+		size_t count = std::min<size_t>(ENV_CHUNK_RECORDS, records.size() - std::min(first, records.size()));
+		std::string datagram(ENV_HEADER_SIZE + count * ENV_RECORD_SIZE, '\0');
+		unsigned char *p = reinterpret_cast<unsigned char *>(datagram.data());
+
+		memcpy(p, ENV_MAGIC, 4);
+		p[4] = ENV_VERSION;
+		p[5] = flags;
+		write_u16(p + 6, (uint16_t)c);
+		write_u16(p + 8, (uint16_t)chunks);
+		write_u16(p + 10, (uint16_t)count);
+		write_u32(p + 12, revision);
+		write_u32(p + 16, (flags & ENV_FULL) ? 0 : base);
+		write_u32(p + 20, total);
+		write_u16(p + 24, reply_port);
+
+		for (size_t i = 0; i < count; i++)
+		{
+			const EnvRecord &rec = records[first + i];
+			unsigned char *r = p + ENV_HEADER_SIZE + i * ENV_RECORD_SIZE;
+			r[0] = (unsigned char)rec.shape;
+			write_u32(r + 4, rec.id);
+			for (int a = 0; a < 6; a++)
+				write_f32(r + 8 + 4 * a, rec.params[a]);
+		}
+		out.push_back(std::move(datagram));
+	}
+	return out;
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Streamed environment messages
+ *
+ * The obstacle list goes out as a stream of small datagrams instead of one
+ * JSON document. Each datagram is a 28 byte header followed by `count`
+ * fixed 32 byte records, all little-endian:
+ *
+ *   header: char magic[4] = "SWEV"; u8 version = 2; u8 flags; u16 chunk;
+ *           u16 chunks; u16 count; u32 revision; u32 base; u32 total;
+ *           u16 reply_port; u16 reserved
+ *   record: u8 shape; u8 reserved[3]; u32 id; f32 params[6]
+ *
+ * Every chunk of a stream carries the same header apart from `chunk` and
+ * `count`. A stream brings the receiver to world `revision`. With
+ * ENV_FULL set it replaces everything the receiver had; otherwise it holds
+ * only the obstacles (and goal) changed since revision `base`, and a receiver
+ * that isn't at `base` has missed something and should ask for a full resend
+ * with the "environment" command. `total` is the obstacle count once the
+ * stream is applied, so a receiver can check it has them all. That command
+ * goes to `reply_port` on the sending host, the command port of whichever
+ * simulator (or partition rank) sent the stream.
+ *
+ * Params per shape, in meters: box x, y, z (center), width, depth, height;
+ * sphere x, y, z, radius; cylinder x, y, z (center), radius, height; goal
+ * x, y, z, radius. Obstacle ids are their index in the environment's list.
+ */
+
+#define ENV_MAGIC "SWEV"
+#define ENV_VERSION 2
+#define ENV_HEADER_SIZE 28
+#define ENV_RECORD_SIZE 32
+#define ENV_DATAGRAM_MAX 1200	// clears the 1280 byte IPv6 minimum MTU with room for IP and UDP headers
+#define ENV_CHUNK_RECORDS ((ENV_DATAGRAM_MAX - ENV_HEADER_SIZE) / ENV_RECORD_SIZE)
+#define ENV_GOAL_ID 0xffffffffu
+
+enum EnvFlags : uint8_t
+{
+	ENV_FULL = 1,				// replaces the receiver's obstacles rather than adding to them
+};
+
+enum class EnvShape : uint8_t
+{
+	BOX = 1,
+	SPHERE = 2,
+	CYLINDER = 3,
+	GOAL = 4,
+};
+
+struct EnvRecord
+{
+	EnvShape shape;
+	uint32_t id;				// obstacle index, ENV_GOAL_ID for the goal
+	float params[6];
+};
+
+std::vector<std::string> format_environment_stream(const std::vector<EnvRecord> &records, uint8_t flags,
+												   uint32_t revision, uint32_t base, uint32_t total,
+												   uint16_t reply_port);
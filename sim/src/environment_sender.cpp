@@ -0,0 +1,163 @@
+#include "environment_sender.h"
+#include "logger.h"
+#include <sys/socket.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <cstdlib>
+
+/**
+ * EnvironmentSender - opens the socket and starts the sender thread
+ * @port_: UDP port on SKYWEAVE_UDP_HOST (default 127.0.0.1)
+ * @full_stream_: formats a full stream when a requested resend is due; runs
+ *	on the sender thread, so it takes its own locks
+ */
+EnvironmentSender::EnvironmentSender(int port_, std::function<std::vector<std::string>()> full_stream_)
+	: port(port_), full_stream(std::move(full_stream_))
+{
+	socketfd = socket(AF_INET, SOCK_DGRAM, 0);
+	if (socketfd < 0)
+		LOG_WARN("failed to create UDP socket for the environment stream");
+	worker = std::thread(&EnvironmentSender::sender_loop, this);
+}
+
+/**
+ * ~EnvironmentSender - stops the sender thread, dropping unsent streams
+ */
+EnvironmentSender::~EnvironmentSender()
+{
+	{
+		std::lock_guard<std::mutex> lock(queue_mutex);
+		stopping = true;
+	}
+	queue_cv.notify_all();
+	if (worker.joinable())
+		worker.join();
+	if (socketfd >= 0)
+		close(socketfd);
+}
+
+/**
+ * send - queues a formatted stream
+ * @chunks: the stream's datagrams, in order; an empty stream is ignored
+ */
+void EnvironmentSender::send(std::vector<std::string> chunks)
+{
+	if (chunks.empty())
+		return;
+	{
+		std::lock_guard<std::mutex> lock(queue_mutex);
+		streams.push_back(std::move(chunks));
+	}
+	queue_cv.notify_one();
+}
+
+/**
+ * request_full - asks for a full stream, merged with any request still waiting
+ */
+void EnvironmentSender::request_full()
+{
+	{
+		std::lock_guard<std::mutex> lock(queue_mutex);
+		full_requested = true;
+	}
+	queue_cv.notify_one();
+}
+
+/**
+ * sender_loop - sends queued streams in order, and requested full streams once due
+ */
+void EnvironmentSender::sender_loop()
+{
+	while (true)
+	{
+		std::unique_lock<std::mutex> lock(queue_mutex);
+		queue_cv.wait(lock, [this]()
+					  { return stopping || !streams.empty() || full_requested; });
+		if (stopping)
+			return;
+
+		if (!streams.empty())
+		{
+			std::vector<std::string> chunks = std::move(streams.front());
+			streams.pop_front();
+			lock.unlock();
+			transmit(chunks);
+			continue;
+		}
+
+		// only a resend is waiting; hold it until the interval since the last one is up
+		auto due = last_full + ENV_RESEND_INTERVAL;
+		if (std::chrono::steady_clock::now() < due)
+		{
+			queue_cv.wait_until(lock, due, [this]()
+								{ return stopping || !streams.empty(); });
+			continue;
+		}
+		full_requested = false;
+		last_full = std::chrono::steady_clock::now();
+		lock.unlock();
+		transmit(full_stream());
+	}
+}
+
+/**
+ * resolve - looks the telemetry host up, once it has succeeded
+ *
+ * Return: true if addr holds the host's address
+ */
+bool EnvironmentSender::resolve()
+{
+	if (resolved)
+		return true;
+
+	const char *host_env = std::getenv("SKYWEAVE_UDP_HOST");
+	const char *host = host_env ? host_env : "127.0.0.1";
+
+	// Resolve hostname to IPv4 address (supports DNS names like *.fly.dev)
+	addrinfo hints;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_DGRAM;
+
+	addrinfo *res = nullptr;
+	int gai_err = getaddrinfo(host, nullptr, &hints, &res);
+	if (gai_err != 0 || res == nullptr)
+	{
+		LOG_WARN("getaddrinfo failed for host %s: %s", host, gai_strerror(gai_err));
+		return false;
+	}
+
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(port);
+	addr.sin_addr = reinterpret_cast<sockaddr_in *>(res->ai_addr)->sin_addr;
+	freeaddrinfo(res);
+	resolved = true;
+	return true;
+}
+
+/**
+ * transmit - sends one stream, one chunk per datagram
+ * @chunks: the stream's datagrams, in order
+ */
+void EnvironmentSender::transmit(const std::vector<std::string> &chunks)
+{
+	if (socketfd < 0 || !resolve())
+		return;
+
+	for (const std::string &chunk : chunks)
+	{
+		ssize_t sendto_return = sendto(socketfd, chunk.data(), chunk.size(), 0, (struct sockaddr *)&addr, sizeof(addr));
+		if (sendto_return == -1)
+		{
+			LOG_WARN("sendto in EnvironmentSender returned -1 errno=%d (%s)", errno, strerror(errno));
+			return;
+		}
+		if (sendto_return != (ssize_t)chunk.size())
+		{
+			LOG_WARN("sendto in EnvironmentSender sent size mismatch");
+			return;
+		}
+	}
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <chrono>
+#include <netinet/in.h>
+
+constexpr std::chrono::seconds ENV_RESEND_INTERVAL{1};	// at most one requested full stream this often
+
+/**
+ * EnvironmentSender - sends environment streams to telemetry off the caller's thread
+ *
+ * Streams are formatted by the caller, under whatever lock guards the
+ * environment, and handed over here; the DNS lookup and the sendto calls
+ * happen on the sender's own thread. The host is resolved once and kept.
+ * Requests for a full resend are coalesced: however many arrive, at most one
+ * full stream goes out per ENV_RESEND_INTERVAL, formatted by @full_stream
+ * when its turn comes.
+ */
+class EnvironmentSender
+{
+private:
+	int port;
+	std::function<std::vector<std::string>()> full_stream;
+	int socketfd = -1;
+	sockaddr_in addr{};
+	bool resolved = false;
+
+	std::thread worker;
+	std::mutex queue_mutex;
+	std::condition_variable queue_cv;
+	std::deque<std::vector<std::string>> streams;
+	bool full_requested = false;
+	bool stopping = false;
+	std::chrono::steady_clock::time_point last_full{};
+
+public:
+	// constructor
+	EnvironmentSender(int port_, std::function<std::vector<std::string>()> full_stream_);
+
+	// destructor
+	~EnvironmentSender();
+
+	EnvironmentSender(const EnvironmentSender &) = delete;
+	EnvironmentSender &operator=(const EnvironmentSender &) = delete;
+
+	// methods
+	void send(std::vector<std::string> chunks);
+	void request_full();
+
+private:
+	void sender_loop();
+	bool resolve();
+	void transmit(const std::vector<std::string> &chunks);
+};
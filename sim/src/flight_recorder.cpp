@@ -0,0 +1,299 @@
+#include "flight_recorder.h"
+#include "telemetry_codec.h"
+#include "logger.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netdb.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <cerrno>
+#include <cstdio>
+#include <ctime>
+
+/**
+ * open - creates (or truncates) a log and maps its first segment
+ * @path: file to write
+ * @dt: simulated seconds per tick, kept in the header for replay
+ *
+ * Return: false if the file can't be created or mapped
+ */
+bool FlightRecorder::open(const std::string &path, double dt)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if (map)
+		return false;
+	if (segment_bytes < 4096 || segment_bytes % 4096 != 0)
+	{
+		LOG_ERROR("FlightRecorder: segment size %zu is not a multiple of the page size", segment_bytes);
+		return false;
+	}
+
+	fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
+	{
+		LOG_ERROR("FlightRecorder: can't create %s: %s", path.c_str(), strerror(errno));
+		return false;
+	}
+	if (!map_segment(0))
+	{
+		::close(fd);
+		fd = -1;
+		return false;
+	}
+
+	FlightLogHeader header{};
+	memcpy(header.magic, FLIGHT_MAGIC, 4);
+	header.version = FLIGHT_VERSION;
+	header.segment_bytes = segment_bytes;
+	header.dt = dt;
+	memcpy(map, &header, sizeof(header));
+	used = sizeof(header);
+	bytes_written = used;
+
+	LOG_INFO("FlightRecorder: recording to %s", path.c_str());
+	return true;
+}
+
+/**
+ * close - unmaps the current segment and trims the file to what was written
+ */
+void FlightRecorder::close()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if (map)
+	{
+		munmap(map, segment_bytes);
+		map = nullptr;
+	}
+	if (fd >= 0)
+	{
+		if (ftruncate(fd, segment * segment_bytes + used) != 0)
+			LOG_WARN("FlightRecorder: trimming the log failed: %s", strerror(errno));
+		::close(fd);
+		fd = -1;
+	}
+}
+
+/**
+ * map_segment - grows the file by a segment and maps it in place of the current one
+ * @index: segment to map
+ *
+ * The segment's blocks are allocated up front, so a full disk shows up here
+ * rather than as a SIGBUS in the middle of a tick.
+ *
+ * Return: false if the file couldn't grow or be mapped; the recorder stops
+ */
+bool FlightRecorder::map_segment(size_t index)
+{
+	if (map)
+	{
+		munmap(map, segment_bytes);
+		map = nullptr;
+	}
+
+	off_t offset = (off_t)index * segment_bytes;
+	int err = posix_fallocate(fd, offset, segment_bytes);
+	if (err != 0)
+	{
+		LOG_ERROR("FlightRecorder: can't allocate segment %zu: %s", index, strerror(err));
+		return false;
+	}
+
+	void *mapped = mmap(nullptr, segment_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, offset);
+	if (mapped == MAP_FAILED)
+	{
+		LOG_ERROR("FlightRecorder: can't map segment %zu: %s", index, strerror(errno));
+		return false;
+	}
+	map = static_cast<char *>(mapped);
+	segment = index;
+	used = 0;
+	return true;
+}
+
+/**
+ * record_command - logs a command as it is handled
+ * @tick: tick it arrived during
+ * @cmd: decoded command
+ *
+ * Return: false if it wasn't recorded
+ */
+bool FlightRecorder::record_command(uint64_t tick, const SimCommand &cmd)
+{
+	return append(FLIGHT_COMMAND, tick, sizeof(cmd), [&](char *out)
+				  { memcpy(out, &cmd, sizeof(cmd)); });
+}
+
+/**
+ * record_tuning - logs the swarm tuning in effect from a tick on
+ * @tick: first tick it applies to
+ * @tuning: new tuning
+ *
+ * Return: false if it wasn't recorded
+ */
+bool FlightRecorder::record_tuning(uint64_t tick, const SwarmTuning &tuning)
+{
+	return append(FLIGHT_TUNING, tick, sizeof(tuning), [&](char *out)
+				  { memcpy(out, &tuning, sizeof(tuning)); });
+}
+
+FlightLog::~FlightLog()
+{
+	if (data)
+		munmap(const_cast<char *>(data), length);
+	if (fd >= 0)
+		close(fd);
+}
+
+/**
+ * open - maps a log and indexes its entries
+ * @path: file written by FlightRecorder
+ *
+ * A run that crashed mid-write reads up to its last complete entry.
+ *
+ * Return: false if the file is missing or isn't a flight log
+ */
+bool FlightLog::open(const std::string &path)
+{
+	fd = ::open(path.c_str(), O_RDONLY);
+	struct stat st;
+	if (fd < 0 || fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(FlightLogHeader))
+	{
+		LOG_ERROR("FlightLog: can't read %s", path.c_str());
+		return false;
+	}
+	length = st.st_size;
+	void *mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (mapped == MAP_FAILED)
+	{
+		LOG_ERROR("FlightLog: can't map %s: %s", path.c_str(), strerror(errno));
+		return false;
+	}
+	data = static_cast<const char *>(mapped);
+	madvise(mapped, length, MADV_SEQUENTIAL);
+
+	memcpy(&header, data, sizeof(header));
+	if (memcmp(header.magic, FLIGHT_MAGIC, 4) != 0 || header.version != FLIGHT_VERSION ||
+		header.segment_bytes < sizeof(FlightLogHeader) + sizeof(FlightEntry))
+	{
+		LOG_ERROR("FlightLog: %s is not a flight log", path.c_str());
+		return false;
+	}
+
+	// walk the headers only; a zero type sends us to the next segment
+	size_t at = sizeof(header);
+	while (at + sizeof(FlightEntry) <= length)
+	{
+		size_t segment_end = (at / header.segment_bytes + 1) * header.segment_bytes;
+		const FlightEntry *e = reinterpret_cast<const FlightEntry *>(data + at);
+		size_t total = sizeof(FlightEntry) + (((size_t)e->size + 7) & ~(size_t)7);
+		if (e->type == FLIGHT_END || at + total > segment_end)
+		{
+			at = segment_end;
+			continue;
+		}
+		if (at + total > length)
+			break;
+		if (e->type == FLIGHT_TICK)
+			ticks.push_back(entries.size());
+		entries.push_back(at);
+		at += total;
+	}
+	return true;
+}
+
+/**
+ * seek - finds where a tick starts
+ * @tick: tick to look for
+ *
+ * Return: index into the tick list of the first tick at or after @tick
+ */
+size_t FlightLog::seek(uint64_t tick) const
+{
+	auto it = std::lower_bound(ticks.begin(), ticks.end(), tick, [this](size_t e, uint64_t t)
+							   { return entry(e).tick < t; });
+	return it - ticks.begin();
+}
+
+int run_flight_replay(const char *path, double speed, uint64_t from_tick, int port)
+{
+	FlightLog log;
+	if (!log.open(path))
+		return 1;
+	if (log.tick_count() == 0)
+	{
+		std::printf("%s holds no ticks\n", path);
+		return 1;
+	}
+
+	int socketfd = socket(AF_INET, SOCK_DGRAM, 0);
+	const char *host_env = std::getenv("SKYWEAVE_UDP_HOST");
+	const char *host = host_env ? host_env : "127.0.0.1";
+	addrinfo hints;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_DGRAM;
+	addrinfo *res = nullptr;
+	if (socketfd < 0 || getaddrinfo(host, nullptr, &hints, &res) != 0 || res == nullptr)
+	{
+		std::printf("can't reach telemetry host %s\n", host);
+		return 1;
+	}
+	sockaddr_in addr = *reinterpret_cast<sockaddr_in *>(res->ai_addr);
+	addr.sin_port = htons(port);
+	freeaddrinfo(res);
+
+	size_t first = log.seek(from_tick);
+	std::printf("Replaying %s: ticks %zu of %zu from tick %llu at %gx to %s:%d\n", path, log.tick_count() - first,
+				log.tick_count(), (unsigned long long)from_tick, speed, host, port);
+
+	using clock = std::chrono::steady_clock;
+	auto start = clock::now();
+	uint64_t start_tick = log.entry(log.tick_entry(std::min(first, log.tick_count() - 1))).tick;
+	uint64_t frames = 0;
+	char buf[512];
+
+	for (size_t n = first; n < log.tick_count(); n++)
+	{
+		size_t e = log.tick_entry(n);
+		const FlightEntry &entry = log.entry(e);
+		FlightTick tick;
+		memcpy(&tick, log.payload(e), sizeof(tick));
+		if (sizeof(tick) + (size_t)tick.count * sizeof(FlightUAV) > entry.size)
+			break;
+
+		// keep to the recorded tick rate, scaled
+		if (speed > 0)
+			std::this_thread::sleep_until(start + std::chrono::duration_cast<clock::duration>(
+													  std::chrono::duration<double>((entry.tick - start_tick) * log.get_dt() / speed)));
+
+		TelemetryRecord rec{};
+		time_t wall = tick.wall_ns / 1000000000;
+		struct tm tm;
+		gmtime_r(&wall, &tm);
+		rec.timestamp_len = strftime(rec.timestamp, sizeof(rec.timestamp), "%Y-%m-%dT%H:%M:%SZ", &tm);
+
+		const char *uavs = log.payload(e) + sizeof(tick);
+		for (uint32_t i = 0; i < tick.count; i++)
+		{
+			FlightUAV uav;
+			memcpy(&uav, uavs + i * sizeof(FlightUAV), sizeof(uav));
+			rec.id = uav.id;
+			memcpy(rec.pos, uav.pos, sizeof(rec.pos));
+			memcpy(rec.vel, uav.vel, sizeof(rec.vel));
+			size_t len = format_telemetry_frame(rec, buf, sizeof(buf));
+			if (len && sendto(socketfd, buf, len, 0, (struct sockaddr *)&addr, sizeof(addr)) == (ssize_t)len)
+				frames++;
+		}
+	}
+
+	double secs = std::chrono::duration<double>(clock::now() - start).count();
+	std::printf("Replayed %llu frames in %.2f s\n", (unsigned long long)frames, secs);
+	close(socketfd);
+	return 0;
+}
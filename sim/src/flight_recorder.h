@@ -0,0 +1,190 @@
+#pragma once
+#include "command_codec.h"
+#include "swarm_tuning.h"
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <type_traits>
+
+/**
+ * Flight recorder
+ *
+ * An append-only log of every tick's UAV state, plus the commands and tuning
+ * changes that steered them. The file grows in preallocated segments of
+ * segment_bytes, each mapped into memory while it is written, so recording
+ * a tick is a memcpy into the page cache rather than a write() call.
+ *
+ * The file starts with a FlightLogHeader. Entries are a FlightEntry followed
+ * by `size` payload bytes, padded to 8 bytes, and never straddle a segment;
+ * a zero type marks the unused end of a segment. Everything is in host byte
+ * order, like the partition wire format.
+ */
+
+#define FLIGHT_MAGIC "SWFR"
+#define FLIGHT_VERSION 1
+#define FLIGHT_SEGMENT_BYTES (64u << 20)
+
+enum FlightEntryType : uint32_t
+{
+	FLIGHT_END = 0,			// rest of the segment is unused
+	FLIGHT_TICK = 1,		// FlightTick, then FlightUAV[count]
+	FLIGHT_COMMAND = 2,		// SimCommand
+	FLIGHT_TUNING = 3,		// SwarmTuning
+};
+
+struct FlightLogHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint64_t segment_bytes;
+	double dt;					// simulated seconds per tick
+	uint64_t reserved;
+};
+
+struct FlightEntry
+{
+	uint32_t type;
+	uint32_t size;				// payload bytes, before padding
+	uint64_t tick;
+};
+
+struct FlightTick
+{
+	int64_t wall_ns;			// system clock when the tick was recorded
+	uint32_t count;
+	uint32_t reserved;
+};
+
+struct FlightUAV
+{
+	int32_t id;
+	uint32_t manual;
+	double pos[3];
+	double vel[3];
+};
+
+static_assert(std::is_trivially_copyable<SimCommand>::value, "commands are logged as raw bytes");
+static_assert(std::is_trivially_copyable<SwarmTuning>::value, "tuning is logged as raw bytes");
+
+class FlightRecorder
+{
+private:
+	std::mutex mutex;					// the tick and the command listener both append
+	int fd = -1;
+	size_t segment_bytes;
+	size_t segment = 0;					// index of the mapped segment
+	char *map = nullptr;				// the mapped segment
+	size_t used = 0;					// bytes used in the mapped segment
+	uint64_t bytes_written = 0;
+
+public:
+	// constructor
+	explicit FlightRecorder(size_t segment_bytes_ = FLIGHT_SEGMENT_BYTES) : segment_bytes(segment_bytes_) {}
+
+	// destructor
+	~FlightRecorder() { close(); }
+
+	FlightRecorder(const FlightRecorder &) = delete;
+	FlightRecorder &operator=(const FlightRecorder &) = delete;
+
+	// getters
+	uint64_t get_bytes_written() const { return bytes_written; }
+
+	// methods
+	bool open(const std::string &path, double dt);
+	void close();
+	template <typename Fill>
+	bool append(FlightEntryType type, uint64_t tick, size_t size, Fill fill);
+	bool record_command(uint64_t tick, const SimCommand &cmd);
+	bool record_tuning(uint64_t tick, const SwarmTuning &tuning);
+
+private:
+	bool map_segment(size_t index);
+};
+
+/**
+ * append - adds one entry, letting the caller write its payload in place
+ * @type: entry type
+ * @tick: tick the entry belongs to
+ * @size: payload bytes
+ * @fill: called with a char * to @size bytes of mapped, zeroed memory
+ *
+ * Return: false if the recorder is closed or the entry can't fit in a segment
+ */
+template <typename Fill>
+bool FlightRecorder::append(FlightEntryType type, uint64_t tick, size_t size, Fill fill)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	size_t total = sizeof(FlightEntry) + ((size + 7) & ~(size_t)7);
+	if (!map || total > segment_bytes - sizeof(FlightLogHeader))
+		return false;
+	if (used + total > segment_bytes && !map_segment(segment + 1))
+		return false;
+
+	FlightEntry *entry = reinterpret_cast<FlightEntry *>(map + used);
+	fill(map + used + sizeof(FlightEntry));
+	entry->size = size;
+	entry->tick = tick;
+	// the type goes in last, so a reader of a crashed run never sees half an entry
+	__atomic_store_n(&entry->type, (uint32_t)type, __ATOMIC_RELEASE);
+	used += total;
+	bytes_written += total;
+	return true;
+}
+
+/**
+ * FlightLog - read-only view of a recorded run
+ *
+ * Maps the whole file and indexes its entries once, so seeking to a tick is
+ * a binary search.
+ */
+class FlightLog
+{
+private:
+	int fd = -1;
+	const char *data = nullptr;
+	size_t length = 0;
+	FlightLogHeader header{};
+	std::vector<size_t> entries;		// offset of every entry, in order
+	std::vector<size_t> ticks;			// index into entries of every FLIGHT_TICK
+
+public:
+	// constructor
+	FlightLog() = default;
+
+	// destructor
+	~FlightLog();
+
+	FlightLog(const FlightLog &) = delete;
+	FlightLog &operator=(const FlightLog &) = delete;
+
+	// getters
+	double get_dt() const { return header.dt; }
+	size_t entry_count() const { return entries.size(); }
+	size_t tick_count() const { return ticks.size(); }
+	const FlightEntry &entry(size_t i) const { return *reinterpret_cast<const FlightEntry *>(data + entries[i]); }
+	const char *payload(size_t i) const { return data + entries[i] + sizeof(FlightEntry); }
+	size_t tick_entry(size_t n) const { return ticks[n]; }
+
+	// methods
+	bool open(const std::string &path);
+	size_t seek(uint64_t tick) const;
+};
+
+/**
+ * run_flight_replay - plays a recorded run to the telemetry port
+ * @path: log written by --record
+ * @speed: 1 for real time, 2 for twice as fast; 0 or less as fast as possible
+ * @from_tick: first tick to play
+ * @port: UDP port on SKYWEAVE_UDP_HOST (default 127.0.0.1) to send frames to
+ *
+ * Sends every UAV of every tick as the same JSON frame the simulator sends, so
+ * the telemetry server, the Rust bridge and the UI can't tell a replay from a
+ * live run. Started with `sim --replay <file> [speed] [from_tick]`.
+ *
+ * Return: process exit code
+ */
+int run_flight_replay(const char *path, double speed, uint64_t from_tick, int port);
@@ -0,0 +1,149 @@
+#pragma once
+#include "environment.h"
+#include <array>
+#include <cstdlib>
+#include <cstdint>
+
+#define ROOT2 1.414
+#define ROOT3 1.732
+
+// The 26 neighbor offsets of a cell, shared by every grid planner
+static constexpr std::array<std::array<int, 3>, 26> GRID_NBRS = {{
+	// Face neighbors (cost = 1.0)
+	{{1, 0, 0}}, {{-1, 0, 0}},
+	{{0, 1, 0}}, {{0 , -1, 0}},
+	{{0, 0, 1}}, {{0, 0, -1}},
+
+	// Edge neighbors (cost = sqrt(2) ≈ 1.414)
+	{{1, 1, 0}}, {{1, -1, 0}}, {{-1, 1, 0}}, {{-1, -1, 0}},
+	{{1, 0, 1}}, {{1, 0, -1}}, {{-1, 0, 1}}, {{-1, 0, -1}},
+	{{0, 1, 1}}, {{0, 1, -1}}, {{0, -1, 1}}, {{0, -1, -1}},
+
+	// Corner neighbors (cost = sqrt(3) ≈ 1.732)
+	{{1, 1, 1}}, {{1, 1, -1}}, {{1, -1, 1}}, {{1, -1, -1}},
+	{{-1, 1, 1}}, {{-1, 1, -1}}, {{-1, -1, 1}}, {{-1, -1, -1}}
+}};
+
+/**
+ * gridMoveCost - cost of a single 26-connected step
+ * @move: offset of the step
+ *
+ * Return: 1, ROOT2 or ROOT3 depending on how many axes the step moves along
+ */
+inline double gridMoveCost(const std::array<int, 3>& move) {
+	int nonZeros = (move[0] != 0) + (move[1] != 0) + (move[2] != 0); // adds up to 1, 2, or 3
+
+	if (nonZeros == 1)
+		return (1.0);
+	else if (nonZeros == 2)
+		return (ROOT2);
+	else
+		return (ROOT3);
+}
+
+/**
+ * gridStepClear - checks whether a 26-connected step is legal
+ * @env: environment to check against
+ * @i: x-value of the cell being left
+ * @j: y-value of the cell being left
+ * @k: z-value of the cell being left
+ * @move: offset of the step
+ *
+ * Diagonal steps may not cut through obstacle corners, so every face cell
+ * along a moving axis must be free as well as the destination.
+ *
+ * Return: true if the step can be taken, false otherwise
+ */
+inline bool gridStepClear(const Environment& env, int i, int j, int k, const std::array<int, 3>& move) {
+	if (env.isBlocked(i + move[0], j + move[1], k + move[2]))
+		return false;
+
+	int components = (move[0] != 0) + (move[1] != 0) + (move[2] != 0);
+	if (components >= 2) {
+		if (move[0] != 0 && env.isBlocked(i + move[0], j, k))
+			return false;
+		if (move[1] != 0 && env.isBlocked(i, j + move[1], k))
+			return false;
+		if (move[2] != 0 && env.isBlocked(i, j, k + move[2]))
+			return false;
+	}
+	return true;
+}
+
+/**
+ * Padded-grid moves
+ *
+ * On Environment's padded layout every neighbor of an interior cell exists, so
+ * a step is a flat offset and its legality is two table lookups: the
+ * destination byte, and the six face neighbors of the cell being left packed
+ * into a mask (bit f set when GRID_NBRS[f] is blocked) tested against the
+ * faces the step slides past.
+ */
+struct PaddedMoves {
+	std::array<int, 26> delta;			// flat offset of GRID_NBRS[m]
+	std::array<uint8_t, 26> required;	// face bits that must be free for GRID_NBRS[m]
+	std::array<uint8_t, 26> opposite;	// index of -GRID_NBRS[m]
+	std::array<double, 26> cost;		// gridMoveCost(GRID_NBRS[m])
+};
+
+/**
+ * makePaddedMoves - builds the move tables for a grid
+ * @nx: cells in X, without padding
+ * @ny: cells in Y, without padding
+ *
+ * Return: move tables for the (nx + 2) x (ny + 2) padded layout
+ */
+inline PaddedMoves makePaddedMoves(int nx, int ny) {
+	PaddedMoves m;
+	int px = nx + 2;
+	int py = ny + 2;
+	for (int a = 0; a < 26; a++) {
+		const std::array<int, 3>& d = GRID_NBRS[a];
+		m.delta[a] = (d[2] * py + d[1]) * px + d[0];
+		m.cost[a] = gridMoveCost(d);
+
+		// faces 0..5 are +x, -x, +y, -y, +z, -z
+		m.required[a] = 0;
+		for (int axis = 0; axis < 3; axis++) {
+			if (d[axis] > 0)
+				m.required[a] |= 1 << (2 * axis);
+			else if (d[axis] < 0)
+				m.required[a] |= 1 << (2 * axis + 1);
+		}
+		for (int b = 0; b < 26; b++)
+			if (GRID_NBRS[b][0] == -d[0] && GRID_NBRS[b][1] == -d[1] && GRID_NBRS[b][2] == -d[2])
+				m.opposite[a] = b;
+	}
+	return m;
+}
+
+/**
+ * faceBlockedMask - packs which face neighbors of a padded cell are blocked
+ * @blocked: predicate on padded indices, e.g. a read of the padded occupancy
+ * @m: move tables
+ * @p: padded index of an interior cell
+ *
+ * Return: bit f set when the neighbor along GRID_NBRS[f] is blocked
+ */
+template <class Blocked>
+inline uint8_t faceBlockedMask(const Blocked& blocked, const PaddedMoves& m, int p) {
+	uint8_t mask = 0;
+	for (int f = 0; f < 6; f++)
+		mask |= (blocked(p + m.delta[f]) ? 1 : 0) << f;
+	return mask;
+}
+
+/**
+ * paddedStepClear - gridStepClear on the padded layout
+ * @blocked: predicate on padded indices
+ * @m: move tables
+ * @p: padded index of the cell being left
+ * @faces: faceBlockedMask of p
+ * @move: index into GRID_NBRS
+ *
+ * Return: true if the step can be taken, false otherwise
+ */
+template <class Blocked>
+inline bool paddedStepClear(const Blocked& blocked, const PaddedMoves& m, int p, uint8_t faces, int move) {
+	return !blocked(p + m.delta[move]) && !(faces & m.required[move]);
+}
@@ -0,0 +1,188 @@
+#pragma once
+#include <vector>
+#include <queue>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+
+/**
+ * Open lists for the grid planners
+ *
+ * IndexedHeap is a D-ary min-heap over cell ids that remembers where each id
+ * sits, so an improved g-score lowers the existing entry (decrease-key)
+ * instead of pushing a duplicate. The heap therefore never holds more entries
+ * than there are open cells. A 4-ary layout keeps the tree shallow and the
+ * children of a slot on one cache line.
+ *
+ * LazyHeap is the previous std::priority_queue scheme behind the same
+ * interface: every improvement pushes a new entry and stale entries are
+ * skipped by the caller's closed check. It is kept for the planner benchmark.
+ */
+
+// operation counts for one search, see --bench-planner
+struct HeapStats {
+	uint64_t pushes = 0;		// new entries
+	uint64_t pops = 0;
+	uint64_t decrease_keys = 0;	// improvements applied in place
+	size_t peak_size = 0;		// most entries held at once
+	size_t bytes = 0;			// peak entry storage plus any index arrays
+};
+
+template <int D = 4>
+class IndexedHeap {
+private:
+	struct Item {
+		double key;
+		int id;
+	};
+	std::vector<Item> heap;
+	std::vector<int> pos;		// id -> slot in heap, -1 when absent
+	HeapStats stats;
+
+public:
+	/**
+	 * reset - empties the heap for a new search over ids in [0, n)
+	 * @n: number of ids
+	 *
+	 * Only the slots of ids still queued are cleared, so this is O(size).
+	 */
+	void reset(int n) {
+		if ((int)pos.size() != n) {
+			pos.assign(n, -1);
+		} else {
+			for (const Item& it : heap)
+				pos[it.id] = -1;
+		}
+		heap.clear();
+		stats = HeapStats();
+	}
+
+	bool empty() const { return heap.empty(); }
+	size_t size() const { return heap.size(); }
+	bool contains(int id) const { return pos[id] != -1; }
+	double topKey() const { return heap[0].key; }
+
+	/**
+	 * push - inserts an id, or lowers its key if it is already queued
+	 * @id: cell id
+	 * @key: priority, smaller pops first
+	 */
+	void push(int id, double key) {
+		int at = pos[id];
+		if (at != -1) {
+			if (key < heap[at].key) {
+				heap[at].key = key;
+				siftUp(at);
+				stats.decrease_keys++;
+			}
+			return;
+		}
+		heap.push_back({key, id});
+		pos[id] = heap.size() - 1;
+		siftUp(heap.size() - 1);
+		stats.pushes++;
+		if (heap.size() > stats.peak_size) {
+			stats.peak_size = heap.size();
+			stats.bytes = heap.capacity() * sizeof(Item) + pos.size() * sizeof(int);
+		}
+	}
+
+	/**
+	 * pop - removes the id with the smallest key
+	 *
+	 * Return: the removed id
+	 */
+	int pop() {
+		int top = heap[0].id;
+		pos[top] = -1;
+		Item last = heap.back();
+		heap.pop_back();
+		if (!heap.empty()) {
+			heap[0] = last;
+			pos[last.id] = 0;
+			siftDown(0);
+		}
+		stats.pops++;
+		return top;
+	}
+
+	const HeapStats& getStats() const { return stats; }
+
+private:
+	void siftUp(size_t at) {
+		Item it = heap[at];
+		while (at > 0) {
+			size_t up = (at - 1) / D;
+			if (heap[up].key <= it.key)
+				break;
+			heap[at] = heap[up];
+			pos[heap[at].id] = at;
+			at = up;
+		}
+		heap[at] = it;
+		pos[it.id] = at;
+	}
+
+	void siftDown(size_t at) {
+		Item it = heap[at];
+		size_t n = heap.size();
+		while (true) {
+			size_t first = at * D + 1;
+			if (first >= n)
+				break;
+			size_t best = first;
+			size_t last = std::min(first + D, n);
+			for (size_t c = first + 1; c < last; c++)
+				if (heap[c].key < heap[best].key)
+					best = c;
+			if (heap[best].key >= it.key)
+				break;
+			heap[at] = heap[best];
+			pos[heap[at].id] = at;
+			at = best;
+		}
+		heap[at] = it;
+		pos[it.id] = at;
+	}
+};
+
+class LazyHeap {
+private:
+	struct Item {
+		double key;
+		int id;
+	};
+	struct ItemCmp {
+		bool operator() (const Item& a, const Item& b) const { return a.key > b.key; }
+	};
+	std::priority_queue<Item, std::vector<Item>, ItemCmp> heap;
+	HeapStats stats;
+
+public:
+	void reset(int) {
+		heap = {};
+		stats = HeapStats();
+	}
+
+	bool empty() const { return heap.empty(); }
+	size_t size() const { return heap.size(); }
+
+	// always adds an entry; older entries for the same id go stale
+	void push(int id, double key) {
+		heap.push({key, id});
+		stats.pushes++;
+		if (heap.size() > stats.peak_size) {
+			stats.peak_size = heap.size();
+			stats.bytes = stats.peak_size * sizeof(Item);
+		}
+	}
+
+	int pop() {
+		int top = heap.top().id;
+		heap.pop();
+		stats.pops++;
+		return top;
+	}
+
+	const HeapStats& getStats() const { return stats; }
+};
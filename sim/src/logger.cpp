@@ -0,0 +1,163 @@
+#include "logger.h"
+#include <thread>
+#include <cstdio>
+#include <cstdarg>
+#include <cstdlib>
+#include <cstring>
+
+namespace
+{
+	constexpr size_t RING_SLOTS = 4096; // power of two
+	constexpr size_t LINE_BYTES = 256;
+
+	struct Slot
+	{
+		std::atomic<size_t> seq; // == position: free for it; == position + 1: holds its line
+		uint32_t len;
+		char text[LINE_BYTES];
+	};
+
+	/**
+	 * AsyncLog - bounded multi-producer ring drained by one writer thread
+	 *
+	 * Producers claim a position with a CAS on head and own that slot until
+	 * they publish its sequence number (Vyukov's bounded queue), so formatting
+	 * happens outside any lock and producers never wait on the writer.
+	 */
+	class AsyncLog
+	{
+	private:
+		Slot slots[RING_SLOTS];
+		alignas(64) std::atomic<size_t> head{0};
+		alignas(64) size_t tail = 0; // writer thread only
+		std::atomic<uint64_t> dropped{0};
+		std::atomic<bool> running{true};
+		std::thread writer;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	public:
+		AsyncLog()
+		{
+			for (size_t i = 0; i < RING_SLOTS; i++)
+				slots[i].seq.store(i, std::memory_order_relaxed);
+			writer = std::thread(&AsyncLog::writer_loop, this);
+		}
+
+		void write(int level, uint32_t suppressed, const char *fmt, va_list args)
+		{
+			size_t pos = head.load(std::memory_order_relaxed);
+			Slot *slot;
+			while (true)
+			{
+				slot = &slots[pos & (RING_SLOTS - 1)];
+				size_t seq = slot->seq.load(std::memory_order_acquire);
+				intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+				if (diff == 0)
+				{
+					if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+						break;
+				}
+				else if (diff < 0)
+				{
+					dropped.fetch_add(1, std::memory_order_relaxed); // ring full
+					return;
+				}
+				else
+					pos = head.load(std::memory_order_relaxed);
+			}
+
+			static const char tags[] = {'D', 'I', 'W', 'E'};
+			double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			int n = snprintf(slot->text, LINE_BYTES, "[%10.3f] %c ", elapsed, tags[level & 3]);
+			n += vsnprintf(slot->text + n, LINE_BYTES - n, fmt, args);
+			if (n > (int)LINE_BYTES - 1)
+				n = LINE_BYTES - 1;
+			if (suppressed)
+				n += snprintf(slot->text + n, LINE_BYTES - n, " (+%u suppressed)", suppressed);
+			if (n > (int)LINE_BYTES - 2)
+				n = LINE_BYTES - 2;
+			slot->text[n++] = '\n';
+			slot->len = n;
+			slot->seq.store(pos + 1, std::memory_order_release);
+		}
+
+		// writes every published line; returns how many
+		size_t drain()
+		{
+			size_t written = 0;
+			while (true)
+			{
+				Slot &slot = slots[tail & (RING_SLOTS - 1)];
+				if (slot.seq.load(std::memory_order_acquire) != tail + 1)
+					break;
+				fwrite(slot.text, 1, slot.len, stdout);
+				slot.seq.store(tail + RING_SLOTS, std::memory_order_release);
+				tail++;
+				written++;
+			}
+
+			uint64_t lost = dropped.exchange(0, std::memory_order_relaxed);
+			if (lost)
+				fprintf(stdout, "[log] %llu lines dropped, ring full\n", (unsigned long long)lost);
+			if (written || lost)
+				fflush(stdout);
+			return written;
+		}
+
+		void stop()
+		{
+			if (!running.exchange(false))
+				return;
+			if (writer.joinable())
+				writer.join();
+			drain();
+		}
+
+	private:
+		void writer_loop()
+		{
+			while (running.load(std::memory_order_relaxed))
+			{
+				if (drain() == 0)
+					std::this_thread::sleep_for(std::chrono::milliseconds(5));
+			}
+		}
+	};
+
+	// never destroyed: detached threads may still log while statics are torn down
+	AsyncLog &sink()
+	{
+		static AsyncLog *log = []()
+		{
+			AsyncLog *created = new AsyncLog();
+			std::atexit([]()
+						{ sink().stop(); });
+			return created;
+		}();
+		return *log;
+	}
+}
+
+/**
+ * log_write - formats one line into the ring; use the LOG_* macros instead
+ * @level: LOG_LEVEL_*
+ * @suppressed: lines this call site skipped since its last line
+ * @fmt: printf format
+ */
+void log_write(int level, uint32_t suppressed, const char *fmt, ...)
+{
+	va_list args;
+	va_start(args, fmt);
+	sink().write(level, suppressed, fmt, args);
+	va_end(args);
+}
+
+/**
+ * log_shutdown - stops the writer thread after writing out everything queued
+ *
+ * Runs at exit on its own; lines logged afterwards are discarded.
+ */
+void log_shutdown()
+{
+	sink().stop();
+}
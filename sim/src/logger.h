@@ -0,0 +1,81 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+/**
+ * Asynchronous logging
+ *
+ * LOG_DEBUG/INFO/WARN/ERROR take printf-style arguments. A call formats its
+ * line into a slot of a lock-free ring and returns; a background thread
+ * writes the ring to stdout. When the ring is full the line is dropped (and
+ * counted) rather than blocking the caller.
+ *
+ * Levels below SKYWEAVE_LOG_LEVEL compile to nothing, arguments included.
+ * Build with -DSKYWEAVE_LOG_LEVEL=0 to get debug output back.
+ *
+ * Every call site is rate limited on its own: past SKYWEAVE_LOG_SITE_RATE
+ * lines in a second, further lines from that site are skipped and the next
+ * line that gets through reports how many were.
+ */
+
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_INFO 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_ERROR 3
+
+#ifndef SKYWEAVE_LOG_LEVEL
+#define SKYWEAVE_LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+#ifndef SKYWEAVE_LOG_SITE_RATE
+#define SKYWEAVE_LOG_SITE_RATE 20 // lines per second per call site
+#endif
+
+// per-call-site budget, one per LOG_* expansion
+class LogSite
+{
+private:
+	std::atomic<int64_t> window{-1};	// second the count below belongs to
+	std::atomic<uint32_t> count{0};
+	std::atomic<uint32_t> suppressed{0};
+
+public:
+	bool allow(uint32_t per_second, uint32_t &suppressed_out)
+	{
+		int64_t now = std::chrono::duration_cast<std::chrono::seconds>(
+						  std::chrono::steady_clock::now().time_since_epoch())
+						  .count();
+		int64_t seen = window.load(std::memory_order_relaxed);
+		if (seen != now && window.compare_exchange_strong(seen, now, std::memory_order_relaxed))
+			count.store(0, std::memory_order_relaxed);
+
+		if (count.fetch_add(1, std::memory_order_relaxed) < per_second)
+		{
+			suppressed_out = suppressed.exchange(0, std::memory_order_relaxed);
+			return true;
+		}
+		suppressed.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+};
+
+void log_write(int level, uint32_t suppressed, const char *fmt, ...) __attribute__((format(printf, 3, 4)));
+void log_shutdown();
+
+#define LOG_AT(level, per_second, ...)                                        \
+	do                                                                        \
+	{                                                                         \
+		if constexpr ((level) >= SKYWEAVE_LOG_LEVEL)                          \
+		{                                                                     \
+			static LogSite log_site_;                                         \
+			uint32_t log_suppressed_;                                         \
+			if (log_site_.allow((per_second), log_suppressed_))               \
+				log_write((level), log_suppressed_, __VA_ARGS__);             \
+		}                                                                     \
+	} while (0)
+
+#define LOG_DEBUG(...) LOG_AT(LOG_LEVEL_DEBUG, SKYWEAVE_LOG_SITE_RATE, __VA_ARGS__)
+#define LOG_INFO(...) LOG_AT(LOG_LEVEL_INFO, SKYWEAVE_LOG_SITE_RATE, __VA_ARGS__)
+#define LOG_WARN(...) LOG_AT(LOG_LEVEL_WARN, SKYWEAVE_LOG_SITE_RATE, __VA_ARGS__)
+#define LOG_ERROR(...) LOG_AT(LOG_LEVEL_ERROR, SKYWEAVE_LOG_SITE_RATE, __VA_ARGS__)
@@ -2,11 +2,120 @@
 #include "simulator.h"
 #include "telemetry_server.h"
 #include "swarm_coordinator.h"
+#include "planner_bench.h"
+#include "flight_recorder.h"
+#include "batch_runner.h"
+#include <cstring>
+#include <csignal>
 
-int main()
+// set by SIGINT/SIGTERM so the run shuts down cleanly and closes its flight log
+static volatile std::sig_atomic_t stop_requested = 0;
+
+int main(int argc, char **argv)
 {
+	// offline open-list benchmark, no simulator or sockets
+	if (argc > 1 && std::strcmp(argv[1], "--bench-planner") == 0)
+	{
+		int queries = (argc > 2) ? std::atoi(argv[2]) : 50;
+		uint32_t seed = (argc > 3) ? std::strtoul(argv[3], nullptr, 10) : 1;
+		return run_planner_bench(queries, seed);
+	}
+
+	// headless Monte Carlo runs to a CSV, no sockets: --batch [--runs n] [--cohesion lo:hi] ...
+	if (argc > 1 && std::strcmp(argv[1], "--batch") == 0)
+	{
+		BatchConfig batch;
+		for (int i = 2; i < argc; i += 2)
+		{
+			if (i + 1 >= argc || !parse_batch_option(argv[i], argv[i + 1], batch))
+			{
+				std::printf("bad batch option %s\n", argv[i]);
+				return 1;
+			}
+		}
+		return run_batch(batch);
+	}
+
+	// play a recorded run to the telemetry port, no physics
+	if (argc > 2 && std::strcmp(argv[1], "--replay") == 0)
+	{
+		double speed = (argc > 3) ? std::atof(argv[3]) : 1.0;
+		uint64_t from_tick = (argc > 4) ? std::strtoull(argv[4], nullptr, 10) : 0;
+		return run_flight_replay(argv[2], speed, from_tick, RUST_UDP_PORT);
+	}
+
+	// independent swarms in one process: --swarms <n>
+	// one slab of a partitioned world: --rank <r> --ranks <n> [--partition-port <p>] [--halo <m>] [--peers <host0,host1,..>]
+	// record the run for --replay: --record <file>
+	// warm start from a snapshot: --restore <file>; save one every few seconds and at exit: --snapshot <file> [--snapshot-every <s>]
+	// path search: --planner theta|astar
+	int num_swarms = 1;
+	uint32_t seed = 0;
+	const char *record_path = nullptr;
+	const char *restore_path = nullptr;
+	const char *snapshot_path = nullptr;
+	int snapshot_every = 60;
+	PartitionConfig partition;
+	SimConfig config;
+	for (int i = 1; i + 1 < argc; i++)
+	{
+		if (std::strcmp(argv[i], "--swarms") == 0)
+			num_swarms = std::max(1, std::atoi(argv[i + 1]));
+		else if (std::strcmp(argv[i], "--record") == 0)
+			record_path = argv[i + 1];
+		else if (std::strcmp(argv[i], "--restore") == 0)
+			restore_path = argv[i + 1];
+		else if (std::strcmp(argv[i], "--snapshot") == 0)
+			snapshot_path = argv[i + 1];
+		else if (std::strcmp(argv[i], "--snapshot-every") == 0)
+			snapshot_every = std::max(1, std::atoi(argv[i + 1]));
+		else if (std::strcmp(argv[i], "--seed") == 0)
+			seed = std::strtoul(argv[i + 1], nullptr, 10);
+		else if (std::strcmp(argv[i], "--planner") == 0)
+		{
+			if (std::strcmp(argv[i + 1], "theta") == 0)
+				config.planner = PlannerMode::LAZY_THETA;
+			else if (std::strcmp(argv[i + 1], "astar") == 0)
+				config.planner = PlannerMode::ASTAR;
+			else
+			{
+				std::cout << "--planner must be theta or astar" << std::endl;
+				return 1;
+			}
+		}
+		else if (std::strcmp(argv[i], "--rank") == 0)
+			partition.rank = std::atoi(argv[i + 1]);
+		else if (std::strcmp(argv[i], "--ranks") == 0)
+			partition.ranks = std::atoi(argv[i + 1]);
+		else if (std::strcmp(argv[i], "--partition-port") == 0)
+			partition.base_port = std::atoi(argv[i + 1]);
+		else if (std::strcmp(argv[i], "--halo") == 0)
+			partition.halo = std::atof(argv[i + 1]);
+		else if (std::strcmp(argv[i], "--peers") == 0)
+		{
+			std::stringstream hosts(argv[i + 1]);
+			std::string host;
+			while (std::getline(hosts, host, ','))
+				partition.hosts.push_back(host);
+		}
+	}
+	if (partition.ranks < 1 || partition.rank < 0 || partition.rank >= partition.ranks)
+	{
+		std::cout << "--rank must be in [0, --ranks)" << std::endl;
+		return 1;
+	}
+	// every rank has to build the same obstacle field
+	if (partition.ranks > 1 && seed == 0)
+		seed = 1;
+
 	int num_uav = 9;
-	UAVSimulator sim(num_uav);
+	UAVSimulator sim(num_uav, num_swarms, seed, config);
+	if (restore_path && !sim.restore_snapshot(restore_path))
+		return 1;
+	if (partition.ranks > 1 && !sim.enable_partition(partition))
+		return 1;
+	if (record_path && !sim.enable_recorder(record_path))
+		return 1;
 	std::vector<UAV> &swarm = sim.get_swarm();
 
 	// start the simulator's command listener (for UI / Rust commands)
@@ -16,14 +125,25 @@ int main()
 
 	// std::cout << "Simulation running with " << num_uav << " UAVs in V formation." << std::endl;
 
+	std::signal(SIGINT, [](int)
+				{ stop_requested = 1; });
+	std::signal(SIGTERM, [](int)
+				{ stop_requested = 1; });
+
 	// program is now an indefinite loop - must be terminated manually
-	while (true)
+	for (int seconds = 1; !stop_requested; seconds++)
 	{
 		sim.print_swarm_status();
 		std::cout.flush();
 		std::this_thread::sleep_for(std::chrono::seconds(1));
+		if (snapshot_path && seconds % snapshot_every == 0)
+			sim.save_snapshot(snapshot_path);
 	}
 
+	// the last snapshot is where a warm start picks up
+	if (snapshot_path)
+		sim.save_snapshot(snapshot_path);
+
 	// here for.. just in case.
 	sim.stop_sim();
 	return 0;
@@ -0,0 +1,438 @@
+#include "obstacle_store.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+	const int LEAF_SIZE = 4;
+	const int MAX_DEPTH = 64;		// median splits stay far below this
+	const double PARALLEL_EPS = 1e-12;
+
+	using Vec = std::array<double, 3>;
+
+	double dot(const Vec &a, const Vec &b) { return a[0] * b[0] + a[1] * b[1] + a[2] * b[2]; }
+
+	/*
+	 * Signed distance from p to each shape's surface: positive outside,
+	 * negative inside, exact everywhere.
+	 */
+	double signedDistance(const Box &b, const Vec &p)
+	{
+		double q[3] = {std::fabs(p[0] - b.x) - 0.5 * b.width, std::fabs(p[1] - b.y) - 0.5 * b.depth,
+					   std::fabs(p[2] - b.z) - 0.5 * b.height};
+		double outside = std::hypot(std::max(q[0], 0.0), std::max(q[1], 0.0), std::max(q[2], 0.0));
+		double inside = std::min(std::max({q[0], q[1], q[2]}), 0.0);
+		return outside + inside;
+	}
+
+	double signedDistance(const Sphere &s, const Vec &p)
+	{
+		return std::hypot(p[0] - s.x, p[1] - s.y, p[2] - s.z) - s.radius;
+	}
+
+	double signedDistance(const Cylinder &c, const Vec &p)
+	{
+		double radial = std::hypot(p[0] - c.x, p[1] - c.y) - c.radius;
+		double axial = std::fabs(p[2] - c.z) - 0.5 * c.height;
+		return std::min(std::max(radial, axial), 0.0) + std::hypot(std::max(radial, 0.0), std::max(axial, 0.0));
+	}
+
+	// narrows [t0, t1] to where o + t * d lies between lo and hi along one axis
+	bool clipSlab(double o, double d, double lo, double hi, double &t0, double &t1)
+	{
+		if (std::fabs(d) < PARALLEL_EPS)
+			return o >= lo && o <= hi;
+		double ta = (lo - o) / d;
+		double tb = (hi - o) / d;
+		if (ta > tb)
+			std::swap(ta, tb);
+		t0 = std::max(t0, ta);
+		t1 = std::min(t1, tb);
+		return t0 <= t1;
+	}
+
+	// narrows [t0, t1] to the roots of a t^2 + 2 b t + c <= 0, the inside of a round surface
+	bool clipQuadric(double a, double b, double c, double &t0, double &t1)
+	{
+		if (a < PARALLEL_EPS)
+			return c <= 0.0;
+		double disc = b * b - a * c;
+		if (disc < 0.0)
+			return false;
+		double s = std::sqrt(disc);
+		t0 = std::max(t0, (-b - s) / a);
+		t1 = std::min(t1, (-b + s) / a);
+		return t0 <= t1;
+	}
+
+	/*
+	 * First t in [0, t_max] where o + t * d is inside each shape; d need not
+	 * be unit length. A start inside the shape enters at 0.
+	 */
+	bool enter(const Box &b, const Vec &o, const Vec &d, double t_max, double &t)
+	{
+		double t0 = 0.0, t1 = t_max;
+		if (!clipSlab(o[0], d[0], b.x - 0.5 * b.width, b.x + 0.5 * b.width, t0, t1) ||
+			!clipSlab(o[1], d[1], b.y - 0.5 * b.depth, b.y + 0.5 * b.depth, t0, t1) ||
+			!clipSlab(o[2], d[2], b.z - 0.5 * b.height, b.z + 0.5 * b.height, t0, t1))
+			return false;
+		t = t0;
+		return true;
+	}
+
+	bool enter(const Sphere &s, const Vec &o, const Vec &d, double t_max, double &t)
+	{
+		Vec oc = {o[0] - s.x, o[1] - s.y, o[2] - s.z};
+		double t0 = 0.0, t1 = t_max;
+		if (!clipQuadric(dot(d, d), dot(oc, d), dot(oc, oc) - s.radius * s.radius, t0, t1))
+			return false;
+		t = t0;
+		return true;
+	}
+
+	bool enter(const Cylinder &c, const Vec &o, const Vec &d, double t_max, double &t)
+	{
+		double ox = o[0] - c.x, oy = o[1] - c.y;
+		double t0 = 0.0, t1 = t_max;
+		if (!clipSlab(o[2], d[2], c.z - 0.5 * c.height, c.z + 0.5 * c.height, t0, t1) ||
+			!clipQuadric(d[0] * d[0] + d[1] * d[1], ox * d[0] + oy * d[1], ox * ox + oy * oy - c.radius * c.radius, t0, t1))
+			return false;
+		t = t0;
+		return true;
+	}
+
+	void extent(const Box &b, Vec &lo, Vec &hi)
+	{
+		lo = {b.x - 0.5 * b.width, b.y - 0.5 * b.depth, b.z - 0.5 * b.height};
+		hi = {b.x + 0.5 * b.width, b.y + 0.5 * b.depth, b.z + 0.5 * b.height};
+	}
+
+	void extent(const Sphere &s, Vec &lo, Vec &hi)
+	{
+		lo = {s.x - s.radius, s.y - s.radius, s.z - s.radius};
+		hi = {s.x + s.radius, s.y + s.radius, s.z + s.radius};
+	}
+
+	void extent(const Cylinder &c, Vec &lo, Vec &hi)
+	{
+		lo = {c.x - c.radius, c.y - c.radius, c.z - 0.5 * c.height};
+		hi = {c.x + c.radius, c.y + c.radius, c.z + 0.5 * c.height};
+	}
+
+	double signedDistance(const Obstacle &o, const Vec &p)
+	{
+		return std::visit([&](const auto &shape)
+						  { return signedDistance(shape, p); }, o);
+	}
+
+	bool enter(const Obstacle &o, const Vec &origin, const Vec &d, double t_max, double &t)
+	{
+		return std::visit([&](const auto &shape)
+						  { return enter(shape, origin, d, t_max, t); }, o);
+	}
+
+	// distance from p to a box, 0 inside: a lower bound for anything the box holds
+	double boundsDistance(const Vec &lo, const Vec &hi, const Vec &p)
+	{
+		double sq = 0.0;
+		for (int a = 0; a < 3; a++)
+		{
+			double out = std::max({lo[a] - p[a], 0.0, p[a] - hi[a]});
+			sq += out * out;
+		}
+		return std::sqrt(sq);
+	}
+
+	bool boundsEnter(const Vec &lo, const Vec &hi, const Vec &o, const Vec &d, double t_max, double &t)
+	{
+		double t0 = 0.0, t1 = t_max;
+		for (int a = 0; a < 3; a++)
+			if (!clipSlab(o[a], d[a], lo[a], hi[a], t0, t1))
+				return false;
+		t = t0;
+		return true;
+	}
+}
+
+/**
+ * add - appends an obstacle
+ * @obstacle: shape in world space
+ *
+ * Queries see it straight away, checked on its own until the next build.
+ *
+ * Return: the obstacle's id
+ */
+int ObstacleStore::add(const Obstacle &obstacle)
+{
+	Bounds b;
+	std::visit([&](const auto &shape)
+			   { extent(shape, b.lo, b.hi); }, obstacle);
+	obstacles.push_back(obstacle);
+	bounds.push_back(b);
+	return obstacles.size() - 1;
+}
+
+/**
+ * clear - drops every obstacle and the tree
+ */
+void ObstacleStore::clear()
+{
+	obstacles.clear();
+	bounds.clear();
+	order.clear();
+	nodes.clear();
+	built = 0;
+}
+
+/**
+ * build - rebuilds the bounding volume hierarchy over every obstacle
+ *
+ * Median split along the widest spread of centers, so the tree stays
+ * balanced however the obstacles are placed. Call after adding a batch.
+ */
+void ObstacleStore::build()
+{
+	order.resize(obstacles.size());
+	for (size_t n = 0; n < order.size(); n++)
+		order[n] = n;
+	nodes.clear();
+	built = obstacles.size();
+	if (obstacles.empty())
+		return;
+	nodes.reserve(2 * obstacles.size() / LEAF_SIZE + 1);
+	nodes.resize(1);
+	buildNode(0, 0, obstacles.size());
+}
+
+/**
+ * buildNode - fills in one node and, unless it is small enough, its subtree
+ * @node: index into nodes, already allocated
+ * @first: first entry of order the node covers
+ * @count: entries it covers
+ */
+void ObstacleStore::buildNode(int node, int first, int count)
+{
+	Bounds box = bounds[order[first]];
+	Vec clo = box.lo, chi = box.lo;	// spread of the centers, times two
+	for (int n = first; n < first + count; n++)
+	{
+		const Bounds &b = bounds[order[n]];
+		for (int a = 0; a < 3; a++)
+		{
+			box.lo[a] = std::min(box.lo[a], b.lo[a]);
+			box.hi[a] = std::max(box.hi[a], b.hi[a]);
+			clo[a] = std::min(clo[a], b.lo[a] + b.hi[a]);
+			chi[a] = std::max(chi[a], b.lo[a] + b.hi[a]);
+		}
+	}
+	nodes[node].bounds = box;
+	if (count <= LEAF_SIZE)
+	{
+		nodes[node].first = first;
+		nodes[node].count = count;
+		return;
+	}
+
+	int axis = 0;
+	for (int a = 1; a < 3; a++)
+		if (chi[a] - clo[a] > chi[axis] - clo[axis])
+			axis = a;
+	int mid = first + count / 2;
+	std::nth_element(order.begin() + first, order.begin() + mid, order.begin() + first + count, [&](int l, int r)
+					 { return bounds[l].lo[axis] + bounds[l].hi[axis] < bounds[r].lo[axis] + bounds[r].hi[axis]; });
+
+	int child = nodes.size();
+	nodes.resize(child + 2);
+	nodes[node].first = child;
+	nodes[node].count = 0;
+	buildNode(child, first, mid - first);
+	buildNode(child + 1, mid, first + count - mid);
+}
+
+/**
+ * visitNear - calls visit(id) on every obstacle that could be within limit of p
+ * @p: query point
+ * @limit: distance bound; visit may lower it to prune harder
+ * @visit: returns false to stop
+ *
+ * Nearer subtrees go first, so limit tightens quickly. Bounds never prune
+ * below zero, so every obstacle containing p is still visited.
+ */
+template <typename Visitor>
+void ObstacleStore::visitNear(const Vec &p, double &limit, Visitor visit) const
+{
+	int stack[MAX_DEPTH + 1];
+	int top = 0;
+	if (!nodes.empty())
+		stack[top++] = 0;
+	while (top > 0)
+	{
+		const Node &node = nodes[stack[--top]];
+		if (boundsDistance(node.bounds.lo, node.bounds.hi, p) > std::max(limit, 0.0))
+			continue;
+		if (node.count > 0)
+		{
+			for (int n = node.first; n < node.first + node.count; n++)
+				if (!visit(order[n]))
+					return;
+			continue;
+		}
+		const Bounds &l = nodes[node.first].bounds, &r = nodes[node.first + 1].bounds;
+		bool left_first = boundsDistance(l.lo, l.hi, p) <= boundsDistance(r.lo, r.hi, p);
+		stack[top++] = node.first + (left_first ? 1 : 0);
+		stack[top++] = node.first + (left_first ? 0 : 1);
+	}
+	for (size_t id = built; id < obstacles.size(); id++)
+		if (!visit(id))
+			return;
+}
+
+/**
+ * visitRay - calls visit(id) on every obstacle whose bounds o + t * d enters by t = limit
+ * @o: ray origin
+ * @d: ray direction, any length
+ * @limit: largest t of interest; visit may lower it to prune harder
+ * @visit: returns false to stop
+ */
+template <typename Visitor>
+void ObstacleStore::visitRay(const Vec &o, const Vec &d, double &limit, Visitor visit) const
+{
+	int stack[MAX_DEPTH + 1];
+	int top = 0;
+	double t;
+	if (!nodes.empty())
+		stack[top++] = 0;
+	while (top > 0)
+	{
+		const Node &node = nodes[stack[--top]];
+		if (!boundsEnter(node.bounds.lo, node.bounds.hi, o, d, limit, t))
+			continue;
+		if (node.count > 0)
+		{
+			for (int n = node.first; n < node.first + node.count; n++)
+				if (!visit(order[n]))
+					return;
+			continue;
+		}
+		// the child the ray reaches first is popped first
+		const Bounds &l = nodes[node.first].bounds, &r = nodes[node.first + 1].bounds;
+		double tl, tr;
+		bool hit_l = boundsEnter(l.lo, l.hi, o, d, limit, tl);
+		bool hit_r = boundsEnter(r.lo, r.hi, o, d, limit, tr);
+		bool left_first = hit_l && (!hit_r || tl <= tr);
+		if (hit_l && hit_r)
+		{
+			stack[top++] = node.first + (left_first ? 1 : 0);
+			stack[top++] = node.first + (left_first ? 0 : 1);
+		}
+		else if (hit_l || hit_r)
+			stack[top++] = node.first + (hit_l ? 0 : 1);
+	}
+	for (size_t id = built; id < obstacles.size(); id++)
+		if (!visit(id))
+			return;
+}
+
+/**
+ * distance - exact distance from a point to the nearest obstacle surface
+ * @p: point in world space
+ * @id: set to the nearest obstacle's id, -1 if there are none; may be null
+ *
+ * Return: meters, negative inside an obstacle (the deepest one if several
+ * overlap), infinity with no obstacles
+ */
+double ObstacleStore::distance(const Vec &p, int *id) const
+{
+	double best = std::numeric_limits<double>::infinity();
+	int best_id = -1;
+	visitNear(p, best, [&](int n)
+			  {
+		double d = signedDistance(obstacles[n], p);
+		if (d < best) {
+			best = d;
+			best_id = n;
+		}
+		return true; });
+	if (id)
+		*id = best_id;
+	return best;
+}
+
+/**
+ * overlaps - checks whether a ball touches any obstacle
+ * @p: ball center in world space
+ * @radius: ball radius, 0 for the point itself
+ *
+ * Stops at the first obstacle found, so it is cheaper than distance.
+ *
+ * Return: true if some obstacle is closer than radius
+ */
+bool ObstacleStore::overlaps(const Vec &p, double radius) const
+{
+	bool found = false;
+	visitNear(p, radius, [&](int n)
+			  {
+		found = signedDistance(obstacles[n], p) < radius;
+		return !found; });
+	return found;
+}
+
+/**
+ * raycast - finds the first obstacle along a ray
+ * @origin: ray start in world space
+ * @dir: ray direction, any nonzero length
+ * @max_distance: how far along the ray to look, in meters
+ * @hit: filled with the nearest hit on success
+ *
+ * Return: true if an obstacle is within max_distance
+ */
+bool ObstacleStore::raycast(const Vec &origin, const Vec &dir, double max_distance, ObstacleHit &hit) const
+{
+	double len = std::sqrt(dot(dir, dir));
+	if (len < PARALLEL_EPS)
+		return false;
+	Vec d = {dir[0] / len, dir[1] / len, dir[2] / len};
+
+	double limit = max_distance;
+	int best_id = -1;
+	visitRay(origin, d, limit, [&](int n)
+			 {
+		double t;
+		if (enter(obstacles[n], origin, d, limit, t) && (best_id < 0 || t < limit)) {
+			limit = t;
+			best_id = n;
+		}
+		return true; });
+	if (best_id < 0)
+		return false;
+
+	hit.id = best_id;
+	hit.distance = limit;
+	for (int a = 0; a < 3; a++)
+		hit.point[a] = origin[a] + d[a] * limit;
+	return true;
+}
+
+/**
+ * segmentClear - exact line of sight between two points
+ * @A: segment start in world space
+ * @B: segment end in world space
+ *
+ * Return: true if no obstacle touches the segment
+ */
+bool ObstacleStore::segmentClear(const Vec &A, const Vec &B) const
+{
+	Vec d = {B[0] - A[0], B[1] - A[1], B[2] - A[2]};
+	if (dot(d, d) < PARALLEL_EPS)
+		return !overlaps(A, 0.0);
+
+	bool clear = true;
+	double limit = 1.0;
+	visitRay(A, d, limit, [&](int n)
+			 {
+		double t;
+		clear = !enter(obstacles[n], A, d, 1.0, t);
+		return clear; });
+	return clear;
+}
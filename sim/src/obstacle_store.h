@@ -0,0 +1,92 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <variant>
+#include <vector>
+
+/**
+ * Obstacle primitives
+ *
+ * The occupancy grid only knows which cells an obstacle covers, rounded to
+ * the resolution. The store keeps the shapes themselves, in world space, so
+ * distances and ray hits can be answered exactly. Boxes are axis aligned and
+ * cylinders stand upright; both are given by their center.
+ */
+
+struct Cylinder
+{
+	double x, y, z, radius, height;
+
+	Cylinder(double x_, double y_, double z_,
+			 double rad_, double h_)
+		: x(x_), y(y_), z(z_), radius(rad_), height(h_) {}
+};
+struct Box
+{
+	double x, y, z, width, depth, height;
+
+	Box(double x_, double y_, double z_, double wid_, double dep_, double h_)
+		: x(x_), y(y_), z(z_), width(wid_), depth(dep_), height(h_) {}
+};
+struct Sphere
+{
+	double x, y, z, radius;
+
+	Sphere(double x_, double y_, double z_, double rad_)
+		: x(x_), y(y_), z(z_), radius(rad_) {}
+};
+
+using Obstacle = std::variant<Box, Sphere, Cylinder>;
+
+struct ObstacleHit
+{
+	int id = -1;					// index of the obstacle hit
+	double distance = 0.0;			// along the ray, 0 if it starts inside
+	std::array<double, 3> point{};
+};
+
+class ObstacleStore
+{
+public:
+	// ids are the order obstacles were added in, matching the environment's list
+	int add(const Obstacle &obstacle);
+	void clear();
+	void build();
+	size_t size() const { return obstacles.size(); }
+	const Obstacle &get(int id) const { return obstacles[id]; }
+	const std::vector<Obstacle> &all() const { return obstacles; }
+
+	double distance(const std::array<double, 3> &p, int *id = nullptr) const;
+	bool overlaps(const std::array<double, 3> &p, double radius) const;
+	bool raycast(const std::array<double, 3> &origin, const std::array<double, 3> &dir, double max_distance,
+				 ObstacleHit &hit) const;
+	bool segmentClear(const std::array<double, 3> &A, const std::array<double, 3> &B) const;
+
+private:
+	struct Bounds
+	{
+		std::array<double, 3> lo, hi;
+	};
+
+	// children of an inner node sit next to each other at `first`; a leaf holds order[first, first + count)
+	struct Node
+	{
+		Bounds bounds;
+		int first;
+		int count;					// 0 for an inner node
+	};
+
+	std::vector<Obstacle> obstacles;
+	std::vector<Bounds> bounds;		// per obstacle
+	std::vector<int> order;			// obstacle ids, grouped by leaf
+	std::vector<Node> nodes;		// nodes[0] is the root once built
+	size_t built = 0;				// obstacles covered by the tree; later ones are checked one by one
+
+	void buildNode(int node, int first, int count);
+	template <typename Visitor>
+	void visitNear(const std::array<double, 3> &p, double &limit, Visitor visit) const;
+	template <typename Visitor>
+	void visitRay(const std::array<double, 3> &o, const std::array<double, 3> &d, double &limit, Visitor visit) const;
+};
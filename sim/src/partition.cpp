@@ -0,0 +1,288 @@
+#include "partition.h"
+#include "logger.h"
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+
+namespace
+{
+	constexpr uint32_t PARTITION_MAGIC = 0x53575054; // "SWPT"
+	constexpr size_t MAX_DATAGRAM = 1400;			 // stays under a typical MTU
+
+	enum PacketType : uint16_t
+	{
+		GHOST = 1,
+		HANDOFF = 2,
+		ACK = 3,
+	};
+
+	struct PacketHeader
+	{
+		uint32_t magic;
+		uint16_t type;
+		uint16_t count;
+		int32_t from;
+		uint32_t reserved;
+	};
+
+	constexpr size_t RECORDS_PER_PACKET = (MAX_DATAGRAM - sizeof(PacketHeader)) / sizeof(PartitionRecord);
+}
+
+/**
+ * SpatialPartition - sets up the slab layout; call open() before exchanging
+ * @config_: this rank, the rank count and how to reach peers
+ * @world_min_x: west edge of the world in meters
+ * @world_max_x: east edge of the world in meters
+ */
+SpatialPartition::SpatialPartition(const PartitionConfig &config_, double world_min_x, double world_max_x)
+	: config(config_),
+	  min_x(world_min_x),
+	  slab_width((world_max_x - world_min_x) / std::max(1, config_.ranks)),
+	  ghost_out(config_.ranks),
+	  ack_out(config_.ranks)
+{
+}
+
+SpatialPartition::~SpatialPartition()
+{
+	if (socketfd > -1)
+	{
+		close(socketfd);
+		socketfd = -1;
+	}
+}
+
+/**
+ * open - binds this rank's port and resolves every peer
+ *
+ * Return: true on success, false if the socket or a peer address failed
+ */
+bool SpatialPartition::open()
+{
+	socketfd = socket(AF_INET, SOCK_DGRAM, 0);
+	if (socketfd < 0)
+	{
+		LOG_ERROR("Partition: socket failed: %s", strerror(errno));
+		return false;
+	}
+	fcntl(socketfd, F_SETFL, fcntl(socketfd, F_GETFL, 0) | O_NONBLOCK);
+
+	sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_ANY);
+	addr.sin_port = htons(config.base_port + config.rank);
+	if (bind(socketfd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+	{
+		LOG_ERROR("Partition: failed to bind port %d", config.base_port + config.rank);
+		return false;
+	}
+
+	peers.assign(config.ranks, sockaddr_in{});
+	for (int r = 0; r < config.ranks; r++)
+	{
+		std::string host = (r < (int)config.hosts.size()) ? config.hosts[r] : "127.0.0.1";
+
+		addrinfo hints;
+		memset(&hints, 0, sizeof(hints));
+		hints.ai_family = AF_INET;
+		hints.ai_socktype = SOCK_DGRAM;
+
+		addrinfo *res = nullptr;
+		int gai_err = getaddrinfo(host.c_str(), nullptr, &hints, &res);
+		if (gai_err != 0 || res == nullptr)
+		{
+			LOG_ERROR("Partition: getaddrinfo failed for rank %d host %s: %s", r, host.c_str(), gai_strerror(gai_err));
+			return false;
+		}
+		peers[r].sin_family = AF_INET;
+		peers[r].sin_addr = reinterpret_cast<sockaddr_in *>(res->ai_addr)->sin_addr;
+		peers[r].sin_port = htons(config.base_port + r);
+		freeaddrinfo(res);
+	}
+
+	LOG_INFO("Partition: rank %d of %d owns x in [%g, %g), port %d", config.rank, config.ranks,
+			 min_x + config.rank * slab_width, min_x + (config.rank + 1) * slab_width, config.base_port + config.rank);
+	return true;
+}
+
+/**
+ * owner_of - rank whose slab holds a position
+ * @pos: world position
+ *
+ * Return: owning rank; positions outside the world go to the nearest end slab
+ */
+int SpatialPartition::owner_of(const std::array<double, 3> &pos) const
+{
+	int r = (int)std::floor((pos[0] - min_x) / slab_width);
+	return std::clamp(r, 0, config.ranks - 1);
+}
+
+/**
+ * leaving_to - rank a locally owned UAV should be handed to
+ * @pos: the UAV's position
+ *
+ * A UAV must be handoff_margin past the edge before it changes owner, so one
+ * hovering on the line doesn't bounce between ranks every tick.
+ *
+ * Return: the new owner, or this rank if the UAV stays
+ */
+int SpatialPartition::leaving_to(const std::array<double, 3> &pos) const
+{
+	double west = min_x + config.rank * slab_width;
+	double east = west + slab_width;
+	if (config.rank > 0 && pos[0] < west - config.handoff_margin)
+		return owner_of(pos);
+	if (config.rank < config.ranks - 1 && pos[0] >= east + config.handoff_margin)
+		return owner_of(pos);
+	return config.rank;
+}
+
+/**
+ * halo_ranks - neighbor ranks that should see a UAV as a ghost
+ * @pos: the UAV's position
+ * @out: cleared, then filled with up to two ranks
+ */
+void SpatialPartition::halo_ranks(const std::array<double, 3> &pos, std::vector<int> &out) const
+{
+	out.clear();
+	double west = min_x + config.rank * slab_width;
+	double east = west + slab_width;
+	if (config.rank > 0 && pos[0] - west < config.halo)
+		out.push_back(config.rank - 1);
+	if (config.rank < config.ranks - 1 && east - pos[0] < config.halo)
+		out.push_back(config.rank + 1);
+}
+
+/**
+ * queue_ghost - queues a UAV's state for a neighbor; sent by the next flush()
+ * @rank: neighbor rank
+ * @rec: UAV state
+ */
+void SpatialPartition::queue_ghost(int rank, const PartitionRecord &rec)
+{
+	ghost_out[rank].push_back(rec);
+}
+
+/**
+ * hand_off - gives a UAV to another rank
+ * @rank: new owner
+ * @rec: UAV state; its hop count is filled in here
+ *
+ * The record is resent on every flush() until the new owner acknowledges it.
+ */
+void SpatialPartition::hand_off(int rank, PartitionRecord rec)
+{
+	rec.hops = ++hops[rec.id];
+	unacked[rec.id] = {rank, rec};
+	stats.handoffs_sent++;
+}
+
+/**
+ * flush - sends queued ghosts, acks and every unacknowledged handoff
+ */
+void SpatialPartition::flush()
+{
+	if (socketfd < 0)
+		return;
+
+	std::vector<std::vector<PartitionRecord>> handoffs(config.ranks);
+	for (const auto &[id, pending] : unacked)
+		handoffs[pending.first].push_back(pending.second);
+
+	for (int r = 0; r < config.ranks; r++)
+	{
+		if (r == config.rank)
+			continue;
+		send_records(r, ACK, ack_out[r]);
+		send_records(r, HANDOFF, handoffs[r]);
+		send_records(r, GHOST, ghost_out[r]);
+		stats.ghosts_sent += ghost_out[r].size();
+		ack_out[r].clear();
+		ghost_out[r].clear();
+	}
+	stats.handoff_sends += unacked.size();
+}
+
+/**
+ * send_records - packs records into as few datagrams as fit
+ * @rank: destination rank
+ * @type: packet type
+ * @records: records to send
+ */
+void SpatialPartition::send_records(int rank, uint16_t type, const std::vector<PartitionRecord> &records)
+{
+	char buffer[MAX_DATAGRAM];
+	for (size_t first = 0; first < records.size(); first += RECORDS_PER_PACKET)
+	{
+		size_t count = std::min(RECORDS_PER_PACKET, records.size() - first);
+		PacketHeader header{PARTITION_MAGIC, type, (uint16_t)count, config.rank, 0};
+		memcpy(buffer, &header, sizeof(header));
+		memcpy(buffer + sizeof(header), records.data() + first, count * sizeof(PartitionRecord));
+
+		size_t size = sizeof(header) + count * sizeof(PartitionRecord);
+		if (sendto(socketfd, buffer, size, 0, (struct sockaddr *)&peers[rank], sizeof(peers[rank])) != (ssize_t)size)
+			LOG_WARN("Partition: sendto rank %d failed: %s", rank, strerror(errno));
+	}
+}
+
+/**
+ * poll - drains every datagram waiting on the socket
+ * @on_ghost: called per ghost record from a neighbor
+ * @on_handoff: called once per UAV handed to this rank; duplicates are filtered
+ */
+void SpatialPartition::poll(const std::function<void(const PartitionRecord &)> &on_ghost,
+							const std::function<void(const PartitionRecord &)> &on_handoff)
+{
+	if (socketfd < 0)
+		return;
+
+	char buffer[MAX_DATAGRAM];
+	while (true)
+	{
+		ssize_t received = recvfrom(socketfd, buffer, sizeof(buffer), 0, nullptr, nullptr);
+		if (received < 0)
+			break;
+		if (received < (ssize_t)sizeof(PacketHeader))
+			continue;
+
+		PacketHeader header;
+		memcpy(&header, buffer, sizeof(header));
+		if (header.magic != PARTITION_MAGIC || header.from < 0 || header.from >= config.ranks ||
+			sizeof(header) + header.count * sizeof(PartitionRecord) > (size_t)received)
+			continue;
+
+		for (int n = 0; n < header.count; n++)
+		{
+			PartitionRecord rec;
+			memcpy(&rec, buffer + sizeof(header) + n * sizeof(PartitionRecord), sizeof(rec));
+
+			if (header.type == GHOST)
+			{
+				stats.ghosts_received++;
+				on_ghost(rec);
+			}
+			else if (header.type == HANDOFF)
+			{
+				// always ack, so a lost ack doesn't keep the sender resending forever
+				ack_out[header.from].push_back(rec);
+				if (rec.hops <= hops[rec.id])
+					continue; // duplicate or overtaken by a later handoff
+				hops[rec.id] = rec.hops;
+				stats.handoffs_received++;
+				on_handoff(rec);
+			}
+			else if (header.type == ACK)
+			{
+				auto pending = unacked.find(rec.id);
+				if (pending != unacked.end() && pending->second.second.hops == rec.hops)
+					unacked.erase(pending);
+			}
+		}
+	}
+}
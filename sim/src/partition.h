@@ -0,0 +1,101 @@
+#pragma once
+#include <vector>
+#include <array>
+#include <string>
+#include <unordered_map>
+#include <functional>
+#include <cstdint>
+#include <netinet/in.h>
+
+/**
+ * Spatial partitioning across sim processes
+ *
+ * The world is cut into equal slabs along X, one per rank. A rank simulates
+ * only the UAVs inside its slab. Every tick it sends the state of UAVs within
+ * `halo` meters of a slab edge to the rank across that edge (ghosts), and
+ * hands UAVs that crossed an edge to their new owner. Handoffs are resent
+ * until the receiver acknowledges them; a per-UAV hop count discards
+ * duplicates and stale resends.
+ *
+ * Peers talk plain UDP on base_port + rank. Records are sent in host byte
+ * order, so all ranks must share an architecture.
+ */
+
+struct PartitionConfig
+{
+	int rank = 0;
+	int ranks = 1;
+	int base_port = 7100;				// rank r listens on base_port + r
+	double halo = 100.0;				// meters on each side of a slab edge mirrored to the neighbor
+	double handoff_margin = 5.0;		// how far past an edge a UAV goes before it changes owner
+	std::vector<std::string> hosts;		// one per rank; empty means every rank is on 127.0.0.1
+};
+
+// one UAV on the wire; goal and flags only matter for leaders
+struct PartitionRecord
+{
+	int32_t id;
+	uint32_t hops;						// handoffs so far, orders a UAV's handoffs across ranks
+	uint32_t flags;
+	uint32_t reserved;
+	double pos[3];
+	double vel[3];
+	double goal[3];
+};
+
+class SpatialPartition
+{
+public:
+	static constexpr uint32_t FLAG_AUTOPILOT = 1u << 0;
+	static constexpr uint32_t FLAG_REACHED_GOAL = 1u << 1;
+
+	struct Stats
+	{
+		uint64_t ghosts_sent = 0;
+		uint64_t ghosts_received = 0;
+		uint64_t handoffs_sent = 0;
+		uint64_t handoffs_received = 0;
+		uint64_t handoff_sends = 0;		// handoff records put on the wire, resends included
+	};
+
+private:
+	PartitionConfig config;
+	double min_x, slab_width;
+	int socketfd = -1;
+	std::vector<sockaddr_in> peers;								// indexed by rank
+	std::vector<std::vector<PartitionRecord>> ghost_out;		// queued per rank, sent by flush()
+	std::unordered_map<int32_t, std::pair<int, PartitionRecord>> unacked;	// id -> (rank, handoff)
+	std::vector<std::vector<PartitionRecord>> ack_out;			// handoff acks queued per rank
+	std::unordered_map<int32_t, uint32_t> hops;					// highest hop count seen per UAV
+	Stats stats;
+
+public:
+	// constructor
+	SpatialPartition(const PartitionConfig &config_, double world_min_x, double world_max_x);
+
+	// destructor
+	~SpatialPartition();
+
+	SpatialPartition(const SpatialPartition &) = delete;
+	SpatialPartition &operator=(const SpatialPartition &) = delete;
+
+	// getters
+	const PartitionConfig &get_config() const { return config; }
+	const Stats &get_stats() const { return stats; }
+	int get_rank() const { return config.rank; }
+
+	// methods
+	bool open();
+	int owner_of(const std::array<double, 3> &pos) const;
+	int leaving_to(const std::array<double, 3> &pos) const;
+	void halo_ranks(const std::array<double, 3> &pos, std::vector<int> &out) const;
+
+	void queue_ghost(int rank, const PartitionRecord &rec);
+	void hand_off(int rank, PartitionRecord rec);
+	void flush();
+	void poll(const std::function<void(const PartitionRecord &)> &on_ghost,
+			  const std::function<void(const PartitionRecord &)> &on_handoff);
+
+private:
+	void send_records(int rank, uint16_t type, const std::vector<PartitionRecord> &records);
+};
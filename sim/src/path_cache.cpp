@@ -0,0 +1,138 @@
+#include "path_cache.h"
+#include "pathfinder.h"
+#include <algorithm>
+
+/**
+ * makeKey - packs a (start, goal, mode) triple into one hash key
+ * @start: flattened start cell
+ * @goal: flattened goal cell
+ * @mode: planner mode
+ *
+ * Return: 31 bits of start, 31 of goal, 2 of mode (room for four modes)
+ */
+uint64_t PathCache::makeKey(int start, int goal, PlannerMode mode) {
+	return ((uint64_t)(uint32_t)start << 33) | ((uint64_t)(uint32_t)goal << 2) | (uint64_t)mode;
+}
+
+/**
+ * erase - removes one entry and its index slot
+ * @it: entry to remove
+ */
+void PathCache::erase(std::list<Entry>::iterator it) {
+	index.erase(makeKey(it->start, it->goal, it->mode));
+	entries.erase(it);
+}
+
+/**
+ * trim - evicts least recently used entries down to capacity
+ */
+void PathCache::trim() {
+	while (entries.size() > capacity)
+		erase(std::prev(entries.end()));
+}
+
+/**
+ * lookup - finds a cached path for a query
+ * @start: flattened start cell
+ * @goal: flattened goal cell
+ * @mode: planner mode
+ * @version: current environment occupancy version
+ * @cells: out, the cached path (possibly the tail of a longer one)
+ *
+ * An exact (start, goal, mode) entry is tried first. Otherwise any current
+ * entry to the same goal in the same mode that passes through the start cell
+ * lends its suffix, which is then cached under the new key as well.
+ * Entries planned against an older occupancy version are dropped on sight.
+ *
+ * Return: true on a hit
+ */
+bool PathCache::lookup(int start, int goal, PlannerMode mode, uint64_t version, std::vector<int>& cells) {
+	std::lock_guard<std::mutex> lock(mtx);
+
+	auto found = index.find(makeKey(start, goal, mode));
+	if (found != index.end()) {
+		auto it = found->second;
+		if (it->version == version) {
+			entries.splice(entries.begin(), entries, it);
+			cells = it->cells;
+			hits++;
+			return true;
+		}
+		erase(it);
+	}
+
+	for (auto it = entries.begin(); it != entries.end(); ) {
+		if (it->version != version) {
+			auto stale = it++;
+			erase(stale);
+			continue;
+		}
+		if (it->goal == goal && it->mode == mode && !it->cells.empty()) {
+			auto on = std::find(it->cells.begin(), it->cells.end(), start);
+			if (on != it->cells.end()) {
+				cells.assign(on, it->cells.end());
+				entries.splice(entries.begin(), entries, it);
+
+				entries.push_front({start, goal, mode, version, cells});
+				index[makeKey(start, goal, mode)] = entries.begin();
+				trim();
+				suffix_hits++;
+				return true;
+			}
+		}
+		++it;
+	}
+
+	misses++;
+	return false;
+}
+
+/**
+ * insert - caches the result of a fresh search
+ * @start: flattened start cell
+ * @goal: flattened goal cell
+ * @mode: planner mode
+ * @version: environment occupancy version the search ran against
+ * @cells: raw path, empty if the goal was unreachable
+ */
+void PathCache::insert(int start, int goal, PlannerMode mode, uint64_t version, const std::vector<int>& cells) {
+	std::lock_guard<std::mutex> lock(mtx);
+	if (capacity == 0)
+		return;
+
+	uint64_t key = makeKey(start, goal, mode);
+	auto found = index.find(key);
+	if (found != index.end())
+		entries.erase(found->second);
+
+	entries.push_front({start, goal, mode, version, cells});
+	index[key] = entries.begin();
+	trim();
+}
+
+/**
+ * clear - drops every entry
+ */
+void PathCache::clear() {
+	std::lock_guard<std::mutex> lock(mtx);
+	entries.clear();
+	index.clear();
+}
+
+/**
+ * size - number of entries, stale ones included until they are next seen
+ */
+size_t PathCache::size() const {
+	std::lock_guard<std::mutex> lock(mtx);
+	return entries.size();
+}
+
+/**
+ * setCapacity - resizes the cache, evicting the oldest entries if needed
+ * @capacity_: maximum number of entries, 0 disables caching
+ */
+void PathCache::setCapacity(size_t capacity_) {
+	std::lock_guard<std::mutex> lock(mtx);
+	capacity = capacity_;
+	trim();
+}
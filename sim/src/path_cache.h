@@ -0,0 +1,65 @@
+#pragma once
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+
+enum class PlannerMode;		// defined in pathfinder.h
+
+/**
+ * PathCache Concepts
+ *
+ * Small LRU of raw planner results (flattened cells, before smoothing) keyed
+ * on the quantized start cell, goal cell and planner mode. Every entry is
+ * tagged with the environment's occupancy version at the time it was planned;
+ * an entry whose version no longer matches is dropped when it is next seen.
+ *
+ * A query whose start cell lies on a cached path to the same goal reuses the
+ * tail of that path: any suffix of a shortest path is itself a shortest path.
+ * Queries that found no path are cached too, so repeated unreachable goals
+ * are also answered without a search.
+ */
+
+class PathCache {
+private:
+	struct Entry {
+		int start;				// flattened start cell
+		int goal;				// flattened goal cell
+		PlannerMode mode;
+		uint64_t version;		// environment occupancy version when planned
+		std::vector<int> cells;
+	};
+
+	size_t capacity;
+	std::list<Entry> entries;	// most recently used first
+	std::unordered_map<uint64_t, std::list<Entry>::iterator> index;
+	mutable std::mutex mtx;		// batch workers share one cache
+
+	// bumped under mtx, but read by stats printers without it
+	std::atomic<uint64_t> hits{0};
+	std::atomic<uint64_t> suffix_hits{0};
+	std::atomic<uint64_t> misses{0};
+
+public:
+	PathCache(size_t capacity_ = 64) : capacity(capacity_) {}
+
+	bool lookup(int start, int goal, PlannerMode mode, uint64_t version, std::vector<int>& cells);
+	void insert(int start, int goal, PlannerMode mode, uint64_t version, const std::vector<int>& cells);
+	void clear();
+
+	// getters
+	size_t size() const;
+	uint64_t getHits() const { return hits; }
+	uint64_t getSuffixHits() const { return suffix_hits; }
+	uint64_t getMisses() const { return misses; }
+
+	// setter
+	void setCapacity(size_t capacity_);
+
+private:
+	static uint64_t makeKey(int start, int goal, PlannerMode mode);
+	void erase(std::list<Entry>::iterator it);
+	void trim();
+};
@@ -1,12 +1,13 @@
 #include "pathfinder.h"
+#include "logger.h"
 
-void Pathfinder::print_idx_path(std::vector<int> pts) {
+void Pathfinder::print_idx_path(std::vector<int> pts) const {
 	std::vector<std::array<double, 3>> path = flatArrayToWorldArray(pts);
 	int path_size = path.size();
-	std::cout << "\nPrinting the leader's A* Raw Path." << std::endl;
+	LOG_DEBUG("Printing the leader's A* Raw Path.");
 
 	for (int i = 0; i < path_size; i++) {
-		std::cout << i << ": ( " << path[i][0] << ", " << path[i][1] << ", " << path[i][2] << " )"<< std::endl;
+		LOG_AT(LOG_LEVEL_DEBUG, 10000, "%d: ( %g, %g, %g )", i, path[i][0], path[i][1], path[i][2]);
 	}
 };
 
@@ -14,37 +15,32 @@ void Pathfinder::print_idx_path(std::vector<int> pts) {
  * print_path - prints the path
  * @path: path to be printed
  */
-void Pathfinder::print_xyz_path(std::vector<std::array<double, 3>> path) {
-	std::cout << "\nPrinting the leader's A* Smooth Path." << std::endl;
+void Pathfinder::print_xyz_path(std::vector<std::array<double, 3>> path) const {
+	LOG_DEBUG("Printing the leader's A* Smooth Path.");
 	int path_size = path.size();
 
 	for (int i = 0; i < path_size; i++) {
-		std::cout << i << ": ( " << path[i][0] << ", " << path[i][1] << ", " << path[i][2] << " )"<< std::endl;
+		LOG_AT(LOG_LEVEL_DEBUG, 10000, "%d: ( %g, %g, %g )", i, path[i][0], path[i][1], path[i][2]);
 	}
 }
 
 /**
- * toIJK - converts flattened index back into I,J,K
- * @idx: flattened index
+ * heuristic - euclidean heuristic in space
  */
-inline std::array<int, 3> Pathfinder::toIJK(int idx) const {
-	int i = idx % nx;
-	int temp = idx / nx;
-	int j = temp % ny;
-	int k = temp / ny;
-	return {i, j, k};
+double Pathfinder::heuristic(int idx_a, int idx_b) const {
+	return ijkDistance(toIJK(idx_a), toIJK(idx_b));
 }
 
 /**
- * heuristic - euclidean heuristic in space
+ * padToIJK - converts a padded-grid index to unpadded I,J,K
+ * @p: index into Environment::getPadded()
  */
-double Pathfinder::heuristic(int idx_a, int idx_b) const {
-	std::array<int, 3> A = toIJK(idx_a);
-	std::array<int, 3> B = toIJK(idx_b);
-	double dx = A[0] - B[0];
-	double dy = A[1] - B[1];
-	double dz = A[2] - B[2];
-	return std::sqrt(dx * dx + dy * dy + dz * dz);
+std::array<int, 3> Pathfinder::padToIJK(int p) const {
+	int i = p % px;
+	int temp = p / px;
+	int j = temp % py;
+	int k = temp / py;
+	return {i - 1, j - 1, k - 1};
 }
 
 /**
@@ -53,7 +49,7 @@ double Pathfinder::heuristic(int idx_a, int idx_b) const {
  *
  * Return: array of world points
  */
-std::vector<std::array<double, 3>> Pathfinder::flatArrayToWorldArray(const std::vector<int>& flat) {
+std::vector<std::array<double, 3>> Pathfinder::flatArrayToWorldArray(const std::vector<int>& flat) const {
 	std::vector<std::array<double, 3>> world;
 	int flat_size = flat.size();
 	world.reserve(flat_size);
@@ -65,227 +61,528 @@ std::vector<std::array<double, 3>> Pathfinder::flatArrayToWorldArray(const std::
 	return world;
 }
 
-double Pathfinder::getMoveCost(const std::array<int, 3>& move) const {
-	int dx = abs(move[0]);
-	int dy = abs(move[1]);
-	int dz = abs(move[2]);
-	int nonZeros = (dx > 0) + (dy > 0) + (dz > 0); // adds up to 1, 2, or 3
-
-	if (nonZeros == 1)
-		return (1.0);
-	else if (nonZeros == 2)
-		return (ROOT2);
-	else
-		return (ROOT3);
-}
-
 // Returns true if the straight-line segment between A and B is free of obstacles.
 bool Pathfinder::isLineClear(const std::array<double, 3>& A, const std::array<double, 3>& B) const {
-	double dx = B[0] - A[0];
-	double dy = B[1] - A[1];
-	double dz = B[2] - A[2];
-	double length = std::sqrt(dx * dx + dy * dy + dz * dz);
-
-	if (length < 1e-6)
-		return true;
-
-	// step at half a grid cell for conservative checking
-	double step = res * 0.5;
-	int steps = static_cast<int>(std::ceil(length / step));
-	double inv_steps = (steps > 0) ? 1.0 / steps : 1.0;
-
-	for (int s = 0; s <= steps; ++s) {
-		double t = s * inv_steps;
-		std::array<double, 3> p = {A[0] + t * dx, A[1] + t * dy, A[2] + t * dz};
-		auto g = env.toGrid(p);
-		if (!env.inBounds(g[0], g[1], g[2]) || env.isBlocked(g[0], g[1], g[2])) {
-			return false;
-		}
-	}
-	return true;
+	return env.segmentClear(A, B);
 }
 
 /**
- * findPath - finds a path from start to finish in world coords
+ * cellLineClear - exact line of sight between two cell centers
+ * @ws: workspace whose free-cell overlay applies
+ * @idx_a: flattened start cell
+ * @idx_b: flattened end cell
+ *
+ * Return: true if no cell crossed by the segment is blocked
  */
-std::vector<int> Pathfinder::rawAStar (
-	std::array<double, 3> worldStart,
-	std::array<double, 3> worldGoal) {
+bool Pathfinder::cellLineClear(const SearchWorkspace& ws, int idx_a, int idx_b) const {
+	return cellLineClear(ws, toIJK(idx_a), toIJK(idx_b));
+}
 
-	// DEBUG 
-	// std::cout << "\nStarting Raw A*" << std::endl;																// DEBUG
-	// std::cout << "Starting at: " << worldStart[0] <<", " << worldStart[1] <<", "<< worldStart[2] << std::endl;	// DEBUG
-	// std::cout << "Ending at  : " << worldGoal[0]  <<", " << worldGoal[1]  <<", "<< worldGoal[2]  << std::endl;	// DEBUG
+bool Pathfinder::cellLineClear(const SearchWorkspace& ws, const std::array<int, 3>& a, const std::array<int, 3>& b) const {
+	if (ws.overlay.empty())
+		return env.cellSegmentClear(a, b);
+
+	const uint8_t* occ = env.getPadded().data();
+	return env.walkCells(a, b, [&](int i, int j, int k) {
+		return env.inBounds(i, j, k) && !ws.blocked(occ, env.padIdx(i, j, k));
+	});
+}
+
+/**
+ * resolveEndpoints - converts world start/goal to flattened cells ready for search
+ * @worldStart: start in world space
+ * @worldGoal: goal in world space
+ * @start: out, flattened start cell
+ * @goal: out, flattened goal cell
+ * @overlay: out, padded cells the query should treat as free
+ *
+ * A blocked start or goal gets a free bubble (the cell and its 26 neighbors)
+ * so the search is not trapped. The bubble only lives in the query's overlay;
+ * the shared grid is never written, so concurrent and cached plans stay valid.
+ *
+ * Return: false if either endpoint is outside the environment
+ */
+bool Pathfinder::resolveEndpoints(
+	const std::array<double, 3>& worldStart,
+	const std::array<double, 3>& worldGoal,
+	int& start, int& goal, std::vector<int>& overlay) const {
 
 	// convert to grid indices
 	std::array<int, 3> gs = env.toGrid(worldStart); // gs: global start in grid coords
 	std::array<int, 3> gg = env.toGrid(worldGoal); 	// gg: global goal  in grid coords
-	int start = toIdx(gs[0], gs[1], gs[2]);			// flattened index of start in env
-	int goal  = toIdx(gg[0], gg[1], gg[2]);			// flattened index of goal  in env
-
-	// Guard against invalid or blocked start/goal cells. If either is blocked, carve a small free bubble.
-	auto ensure_free = [this](int i, int j, int k) {
-		if (!env.inBounds(i, j, k))
-			return false;
-		// clear the cell and its immediate neighbors to avoid trapping the search
+
+	overlay.clear();
+	auto free_bubble = [&](int i, int j, int k) {
+		// the cell and its immediate neighbors, so the search is not trapped
 		for (int dk = -1; dk <= 1; ++dk)
 			for (int dj = -1; dj <= 1; ++dj)
 				for (int di = -1; di <= 1; ++di) {
 					int ni = i + di, nj = j + dj, nk = k + dk;
-					if (env.inBounds(ni, nj, nk))
-						env.setBlock(ni, nj, nk, false);
+					if (env.inBounds(ni, nj, nk) && env.isBlocked(ni, nj, nk))
+						overlay.push_back(env.padIdx(ni, nj, nk));
 				}
-		return true;
 	};
 
 	if (!env.inBounds(gs[0], gs[1], gs[2]) || !env.inBounds(gg[0], gg[1], gg[2])) {
-		std::cout << "A* failed: start or goal outside environment bounds." << std::endl;
-		return {};
+		LOG_WARN("A* failed: start or goal outside environment bounds.");
+		return false;
 	}
 
 	if (env.isBlocked(gs[0], gs[1], gs[2])) {
-		ensure_free(gs[0], gs[1], gs[2]);
+		free_bubble(gs[0], gs[1], gs[2]);
 	}
 	if (env.isBlocked(gg[0], gg[1], gg[2])) {
-		ensure_free(gg[0], gg[1], gg[2]);
+		free_bubble(gg[0], gg[1], gg[2]);
 	}
 
-	// DEBUG SECTION
-	// std::cout << "Grid bounds check - start in bounds: " << env.inBounds(gs[0], gs[1], gs[2]) << std::endl;
-	// std::cout << "Grid bounds check - goal in bounds: " << env.inBounds(gg[0], gg[1], gg[2]) << std::endl;
-	// std::cout << "Grid start: (" << gs[0] << ", " << gs[1] << ", " << gs[2] << ")" << std::endl;	// DEBUG
-	// std::cout << "Grid goal: (" << gg[0] << ", " << gg[1] << ", " << gg[2] << ")" << std::endl;		// DEBUG
-	// std::cout << "Flat start idx: " << start << ", goal idx: " << goal << std::endl;				// DEBUG
-	// std::cout << "Start blocked: " << env.isBlocked(gs[0], gs[1], gs[2]) << std::endl;
-	// std::cout << "Goal blocked: " << env.isBlocked(gg[0], gg[1], gg[2]) << std::endl;
+	start = toIdx(gs[0], gs[1], gs[2]);			// flattened index of start in env
+	goal  = toIdx(gg[0], gg[1], gg[2]);			// flattened index of goal  in env
+	return true;
+}
 
-	std::array<int, 3> start_verify = toIJK(start);
-	std::array<int, 3> goal_verify = toIJK(goal);
-	// std::cout << "Start verification: (" << start_verify[0] << ", " << start_verify[1] << ", " << start_verify[2] << ")" << std::endl;
-	// std::cout << "Goal verification: (" << goal_verify[0] << ", " << goal_verify[1] << ", " << goal_verify[2] << ")" << std::endl;
+/**
+ * SearchWorkspace::begin - readies the buffers for a new search
+ * @total: number of cells in the grid
+ */
+void SearchWorkspace::begin(int total) {
+	if ((int)gscore.size() != total) {
+		gscore.assign(total, 0.0);
+		parent.assign(total, -1);
+		touched.assign(total, 0);
+		closed.assign(total, 0);
+		freed.assign(total, 0);
+		generation = 0;
+	}
+	generation++;
+	if (generation == 0) {		// stamps wrapped around: clear for real once
+		std::fill(touched.begin(), touched.end(), 0);
+		std::fill(closed.begin(), closed.end(), 0);
+		std::fill(freed.begin(), freed.end(), 0);
+		generation = 1;
+	}
+	for (int p : overlay)
+		freed[p] = generation;
+	open.reset(total);
+	expanded = 0;
+}
 
-	// std::cout << "Grid dimensions: nx=" << nx << ", ny=" << ny << ", nz=" << nz << std::endl;
+/**
+ * SearchWorkspace::reverse - second set of buffers, for searching from the goal
+ *
+ * Return: the partner workspace, allocated on first use
+ */
+SearchWorkspace& SearchWorkspace::reverse() {
+	if (!partner)
+		partner = std::make_unique<SearchWorkspace>();
+	return *partner;
+}
 
+/**
+ * findPath - finds a path from start to finish in grid cells
+ * @ws: scratch buffers for this search
+ * @start: flattened start cell
+ * @goal: flattened goal cell
+ */
+std::vector<int> Pathfinder::rawAStar(SearchWorkspace& ws, int start, int goal) const {
+	std::vector<int> path = aStarSearch(ws, ws.open, start, goal);
+	if (path.empty() && ws.cancelled())
+		return {};
+	if (path.empty()) {
+		LOG_WARN("A* failed: open set exhausted, no path found!");
+		return {};
+	}
+	LOG_INFO("A* succeeded: found path to goal! (%llu cells expanded)", (unsigned long long)ws.expanded);
+	return (path);
+}
 
-	int total = nx *  ny * nz; 						// total number of indices in env
-	std::vector<double> gscore(total,				// stores best known g value for cell idx
-		std::numeric_limits<double>::infinity());
-	std::vector<int>    parent(total, -1);			// stores the previous cell's index on the best path to idx
-	std::vector<bool>   closed(total, false);		// marks cells already explored (popped from the open set)
+/**
+ * aStarSearch - the A* loop, over any open list with the IndexedHeap interface
+ * @ws: scratch buffers for this search
+ * @open: open list, reset here
+ * @start: flattened start cell
+ * @goal: flattened goal cell
+ *
+ * Return: flattened cell path, empty if no path exists
+ */
+template <class OpenList>
+std::vector<int> Pathfinder::aStarSearch(SearchWorkspace& ws, OpenList& open, int start, int goal) const {
+	// the search runs on the padded grid: neighbors are flat offsets and the
+	// blocked border stops it at the edges, so there are no bounds checks
+	const uint8_t* occ = env.getPadded().data();
+	const int total = px * py * pz;
+	ws.begin(total);							// gscore, parent, closed per padded cell idx
+	auto blocked = [&ws, occ](int p) { return ws.blocked(occ, p); };
+
+	int pstart = toPad(start);
+	int pgoal = toPad(goal);
+	std::array<int, 3> goalIJK = toIJK(goal);
 
 	// the open set
-	std::priority_queue<Node, std::vector<Node>, NodeCmp> open; // min-heap
-	gscore[start] = 0.0;
-	open.push({start, heuristic(start, goal), 0.0}); // creates Node with distance to goal and an initial current cost to start location as zero
+	open.reset(total);
+	ws.set(pstart, 0.0, -1);
+	open.push(pstart, heuristic(start, goal));	// keyed on distance to goal, start's own cost is zero
 
 	// A* Loop
 	bool reachedGoal = false;
 	while (!open.empty()) {
-		Node cur = open.top();					// copies top value (pop doesn't return a value)
-		open.pop();								// removes the top value from open
-		if (closed[cur.idx]) 					//if value is already checked, skip
+		int cur = open.pop();
+		if (ws.isClosed(cur)) 					// only a lazy open list holds stale duplicates
 			continue;
-		if (cur.idx == goal) {					//endgame!
+		if (cur == pgoal) {						//endgame!
 			reachedGoal = true;
 			break;
 		}
-		closed[cur.idx] = true;
-
-		std::array<int, 3> ijk = toIJK(cur.idx);// convert flattened index to grid space
-		for (auto& nbr: nbrs) {					// iterate through all node's neighbors
-			int ni = ijk[0] + nbr[0];			// index of neighbor
-			int nj = ijk[1] + nbr[1];
-			int nk = ijk[2] + nbr[2];
-
-			if (!env.inBounds(ni, nj, nk))		// skip out-of-bounds locations
+		ws.close(cur);
+		if ((++ws.expanded & 255) == 0 && ws.cancelled())
+			return {};
+
+		double curG = ws.g(cur);
+		std::array<int, 3> ijk = padToIJK(cur);	// grid coords, only needed for the heuristic
+		uint8_t faces = faceBlockedMask(blocked, moves, cur);
+		for (int m = 0; m < 26; m++) {			// iterate through all node's neighbors
+			// skip blocked locations, and diagonal moves that would cut
+			// through obstacle corners
+			if (!paddedStepClear(blocked, moves, cur, faces, m))
 				continue;
 
-			// prevent cutting through obstacle corners on diagonal moves:
-			// if moving along multiple axes, require adjacent faces to be free.
-			int components = (nbr[0] != 0) + (nbr[1] != 0) + (nbr[2] != 0);
-			if (components >= 2) {
-				if (nbr[0] != 0 && nbr[1] != 0) {
-					if (env.isBlocked(ijk[0] + nbr[0], ijk[1], ijk[2]) ||
-						env.isBlocked(ijk[0], ijk[1] + nbr[1], ijk[2]))
-						continue;
-				}
-				if (nbr[0] != 0 && nbr[2] != 0) {
-					if (env.isBlocked(ijk[0] + nbr[0], ijk[1], ijk[2]) ||
-						env.isBlocked(ijk[0], ijk[1], ijk[2] + nbr[2]))
-						continue;
-				}
-				if (nbr[1] != 0 && nbr[2] != 0) {
-					if (env.isBlocked(ijk[0], ijk[1] + nbr[1], ijk[2]) ||
-						env.isBlocked(ijk[0], ijk[1], ijk[2] + nbr[2]))
-						continue;
-				}
+			int nidx = cur + moves.delta[m];	// idx of n (neighbor)
+			double tg = curG + moves.cost[m];	// tentative g-score. 1.0 cost: distance between cells)
+			if (tg < ws.g(nidx)) {				// if lower score, add to open
+				ws.set(nidx, tg, cur);			// set new score and parent for neighbor
+				std::array<int, 3> n = {ijk[0] + GRID_NBRS[m][0], ijk[1] + GRID_NBRS[m][1], ijk[2] + GRID_NBRS[m][2]};
+				open.push(nidx, tg + ijkDistance(n, goalIJK));	// insert, or lower the queued key
 			}
+		}
+	}
+	if (!reachedGoal)
+		return {};
+
+	// reconstruct
+	std::vector<int> rev;
+	for (int at = pgoal; at != -1; at = ws.parentOf(at))	// "at" current index
+		rev.push_back(fromPad(at));					// build reverse path
+	if (rev.back() != start) 						// no path
+		return {};
+	std::reverse(rev.begin(), rev.end());			// reverse from beginning to end
+	return (rev);
+}
+
+/**
+ * bidirectionalAStar - A* from both ends that stops once the two frontiers prove a meeting optimal
+ * @ws: scratch buffers for the start side; ws.reverse() holds the goal side
+ * @start: flattened start cell
+ * @goal: flattened goal cell
+ *
+ * Both sides share the average potential p(n) = (d(n, goal) - d(n, start)) / 2:
+ * the start side keys cells on g + p, the goal side on g - p, and the side with
+ * the smaller open list expands next. Whenever a relaxed cell already has a
+ * g-score from the other side, the joined cost becomes a candidate mu. With
+ * these potentials the two searches agree on edge costs, so the classic
+ * bidirectional Dijkstra rule applies: once the two smallest keys sum to mu
+ * or more, no path through an unexpanded cell can be cheaper
+ * (Ikeda et al.; Goldberg and Harrelson).
+ *
+ * The goal side walks moves backwards, so a step n -> cur must be legal as a
+ * forward move from n. Face and edge moves slide past the same face cells in
+ * both directions; corner moves (GRID_NBRS[18..25]) are checked from n.
+ *
+ * --bench-planner checks its path costs against A*'s. It pops fewer cells but
+ * runs 1.1-1.3x slower than indexed A* on this grid, where the two searches
+ * are about as wide as one, so it is not offered by --planner.
+ *
+ * Return: flattened cell path, empty if no path exists
+ */
+std::vector<int> Pathfinder::bidirectionalAStar(SearchWorkspace& ws, int start, int goal) const {
+	const uint8_t* occ = env.getPadded().data();
+	const int total = px * py * pz;
+	SearchWorkspace& fwd = ws;
+	SearchWorkspace& bwd = ws.reverse();
+	bwd.overlay = fwd.overlay;
+	fwd.begin(total);
+	bwd.begin(total);
+	auto blocked = [&fwd, occ](int p) { return fwd.blocked(occ, p); };
+
+	int pstart = toPad(start);
+	int pgoal = toPad(goal);
+	std::array<int, 3> startIJK = toIJK(start);
+	std::array<int, 3> goalIJK = toIJK(goal);
+
+	// potential of a cell for the start side; the goal side uses its negation
+	auto potential = [&](const std::array<int, 3>& n) {
+		return 0.5 * (ijkDistance(n, goalIJK) - ijkDistance(n, startIJK));
+	};
+
+	fwd.set(pstart, 0.0, -1);
+	fwd.open.push(pstart, potential(startIJK));
+	bwd.set(pgoal, 0.0, -1);
+	bwd.open.push(pgoal, -potential(goalIJK));
+
+	double mu = (pstart == pgoal) ? 0.0 : std::numeric_limits<double>::infinity();	// best joined cost so far
+	int meet = (pstart == pgoal) ? pstart : -1;
 
-			if (env.isBlocked(ni, nj, nk))		// skip blocked locations
+	while (!fwd.open.empty() && !bwd.open.empty()) {
+		if (fwd.open.topKey() + bwd.open.topKey() >= mu)
+			break;
+
+		bool forward = fwd.open.size() <= bwd.open.size();
+		SearchWorkspace& self = forward ? fwd : bwd;
+		SearchWorkspace& other = forward ? bwd : fwd;
+		double sign = forward ? 1.0 : -1.0;
+
+		int cur = self.open.pop();
+		self.close(cur);
+		if ((++self.expanded & 255) == 0 && ws.cancelled())
+			return {};
+
+		double curG = self.g(cur);
+		std::array<int, 3> ijk = padToIJK(cur);
+		uint8_t faces = faceBlockedMask(blocked, moves, cur);
+		for (int m = 0; m < 26; m++) {
+			int nidx = cur + moves.delta[m];
+			if (forward || m < 18) {
+				if (!paddedStepClear(blocked, moves, cur, faces, m))
+					continue;
+			} else {
+				if (blocked(nidx) || !paddedStepClear(blocked, moves, nidx, faceBlockedMask(blocked, moves, nidx), moves.opposite[m]))
+					continue;
+			}
+			if (self.isClosed(nidx))
 				continue;
 
-			int nidx = toIdx(ni, nj, nk);		// idx of n (neighbor)
-			double moveCost = getMoveCost(nbr);
-			double tg = gscore[cur.idx] + moveCost;	// tentative g-score. 1.0 cost: distance between cells)
-			if (tg < gscore[nidx]) {			// if lower score, add to open
-				gscore[nidx] = tg;				// set new score for neighbor
-				parent[nidx] = cur.idx;			// set parent of current node
-				double f = tg + heuristic(nidx, goal); // set A* value 
-				open.push({nidx, f, tg});		// push neighbor's idx, A*, and cost of path so far 
+			double tg = curG + moves.cost[m];
+			if (tg < self.g(nidx)) {
+				self.set(nidx, tg, cur);
+				std::array<int, 3> n = {ijk[0] + GRID_NBRS[m][0], ijk[1] + GRID_NBRS[m][1], ijk[2] + GRID_NBRS[m][2]};
+				self.open.push(nidx, tg + sign * potential(n));
+
+				double joined = tg + other.g(nidx);		// infinite until the other side reaches nidx
+				if (joined < mu) {
+					mu = joined;
+					meet = nidx;
+				}
 			}
 		}
 	}
-	// In rawAStar, after the while loop:
-	if (!reachedGoal) {
-		std::cout << "A* failed: open set exhausted, no path found!" << std::endl;
+	ws.expanded = fwd.expanded + bwd.expanded;
+	if (meet == -1)
 		return {};
+
+	// start ... meet from the start side, then meet ... goal from the goal side
+	std::vector<int> path;
+	for (int at = meet; at != -1; at = fwd.parentOf(at))
+		path.push_back(fromPad(at));
+	std::reverse(path.begin(), path.end());
+	for (int at = bwd.parentOf(meet); at != -1; at = bwd.parentOf(at))
+		path.push_back(fromPad(at));
+	return (path);
+}
+
+/**
+ * benchmarkAStar - runs one A* query with either open list and reports its heap work
+ * @worldStart: start in world space
+ * @worldGoal: goal in world space
+ * @legacy_heap: use the old lazy-deletion priority queue instead of the indexed heap
+ * @out: optional, receives the cell path
+ *
+ * Bypasses the path cache.
+ *
+ * Return: open-list statistics for the search
+ */
+HeapStats Pathfinder::benchmarkAStar(
+	const std::array<double, 3>& worldStart,
+	const std::array<double, 3>& worldGoal,
+	bool legacy_heap,
+	std::vector<int>* out) {
+
+	int start, goal;
+	if (!resolveEndpoints(worldStart, worldGoal, start, goal, workspace.overlay))
+		return {};
+
+	std::vector<int> path;
+	HeapStats stats;
+	if (legacy_heap) {
+		LazyHeap open;
+		path = aStarSearch(workspace, open, start, goal);
+		stats = open.getStats();
+	} else {
+		path = aStarSearch(workspace, workspace.open, start, goal);
+		stats = workspace.open.getStats();
 	}
-	std::cout << "A* succeeded: found path to goal!" << std::endl;
+	if (out)
+		*out = path;
+	return stats;
+}
 
-	// reconstruct
-	std::vector<int> rev;
-	for (int at = goal; at != -1; at = parent[at])	// "at" current index
-		rev.push_back(at);							// build reverse path
-	if (rev.back() != start) 						// no path
+
+/**
+ * benchmarkBidirectional - runs one bidirectional query and reports its heap work
+ * @worldStart: start in world space
+ * @worldGoal: goal in world space
+ * @out: optional, receives the cell path
+ *
+ * Return: open-list statistics summed over both sides
+ */
+HeapStats Pathfinder::benchmarkBidirectional(
+	const std::array<double, 3>& worldStart,
+	const std::array<double, 3>& worldGoal,
+	std::vector<int>* out) {
+
+	int start, goal;
+	if (!resolveEndpoints(worldStart, worldGoal, start, goal, workspace.overlay))
 		return {};
-	std::reverse(rev.begin(), rev.end());			// reverse from beginning to end
 
-	print_idx_path(rev);
-	return (rev);
+	std::vector<int> path = bidirectionalAStar(workspace, start, goal);
+	const HeapStats& f = workspace.open.getStats();
+	const HeapStats& b = workspace.reverse().open.getStats();
+	HeapStats stats;
+	stats.pushes = f.pushes + b.pushes;
+	stats.pops = f.pops + b.pops;
+	stats.decrease_keys = f.decrease_keys + b.decrease_keys;
+	stats.peak_size = f.peak_size + b.peak_size;
+	stats.bytes = f.bytes + b.bytes;
+	if (out)
+		*out = path;
+	return stats;
 }
 
+/**
+ * pathCost - length of a cell path in meters
+ * @cells: flattened cell path
+ *
+ * Return: summed straight-line distance between consecutive cells
+ */
+double Pathfinder::pathCost(const std::vector<int>& cells) const {
+	double cost = 0.0;
+	for (size_t n = 1; n < cells.size(); n++)
+		cost += ijkDistance(toIJK(cells[n - 1]), toIJK(cells[n]));
+	return cost * res;
+}
 
 /**
  * smoothPath - removes redundant waypoints in the A* path
+ * @ws: workspace of the query, for its free-cell overlay
  * @raw: raw A* path
  *
  * Return: smoothed A* path
  */
-std::vector<std::array<double, 3>> Pathfinder::smoothPath(const std::vector<int>& raw){
-	// copy raw path into "pts"
-	std::vector<std::array<double, 3>> pts = flatArrayToWorldArray(raw);
-
+std::vector<std::array<double, 3>> Pathfinder::smoothPath(const SearchWorkspace& ws, const std::vector<int>& raw) const {
 	// Collision-aware line-of-sight simplifier: keep a waypoint only if we cannot safely
 	// connect the last kept point directly to the next waypoint without hitting obstacles.
-	std::vector<std::array<double, 3>> corners;
-	int pts_size = pts.size();
-	if (pts.empty())
-		return corners;
-	corners.push_back(pts.front()); // load first waypoint
-	for (int i = 1; i < pts_size - 1; i++) {
-		const auto& last_kept = corners.back();
-		const auto& next = pts[i + 1];
-
+	std::vector<int> corners;
+	int raw_size = raw.size();
+	if (raw.empty())
+		return {};
+	corners.push_back(raw.front()); // load first waypoint
+	for (int i = 1; i < raw_size - 1; i++) {
 		// If straight segment to the next point is blocked, keep the current waypoint.
-		if (!isLineClear(last_kept, next)) {
-			corners.push_back(pts[i]);
+		if (!cellLineClear(ws, corners.back(), raw[i + 1])) {
+			corners.push_back(raw[i]);
 		}
 	}
-	corners.push_back(pts.back());					// load final waypoint
-	return corners;
+	if (raw_size > 1)
+		corners.push_back(raw.back());				// load final waypoint
+	return flatArrayToWorldArray(corners);
 }
 
 
+/**
+ * lazyThetaStar - any-angle search that only keeps the corners of the path
+ * @worldStart: start in world space
+ * @worldGoal: goal in world space
+ *
+ * Like A*, but a successor inherits its parent's parent and the line of sight
+ * is only verified when the successor is expanded (Nash et al., Lazy Theta*).
+ * If it turns out to be blocked, the parent falls back to the best expanded
+ * grid neighbor.
+ *
+ * Return: flattened cells of the path's vertices, empty if no path exists
+ */
+std::vector<int> Pathfinder::lazyThetaStar(SearchWorkspace& ws, int start, int goal) const {
+	// searched on the padded grid, see aStarSearch
+	const uint8_t* occ = env.getPadded().data();
+	ws.begin(px * py * pz);
+	auto blocked = [&ws, occ](int p) { return ws.blocked(occ, p); };
+
+	int pstart = toPad(start);
+	int pgoal = toPad(goal);
+	std::array<int, 3> goalIJK = toIJK(goal);
+
+	IndexedHeap<4>& open = ws.open;
+	ws.set(pstart, 0.0, pstart);
+	open.push(pstart, heuristic(start, goal));
+
+	bool reachedGoal = false;
+	while (!open.empty()) {
+		int cur = open.pop();
+
+		std::array<int, 3> ijk = padToIJK(cur);
+
+		// lazy line-of-sight check against the inherited parent
+		int p = ws.parentOf(cur);
+		if (p != cur && !cellLineClear(ws, padToIJK(p), ijk)) {
+			double best = std::numeric_limits<double>::infinity();
+			for (int m = 0; m < 26; m++) {
+				int nidx = cur + moves.delta[m];
+				if (!ws.isClosed(nidx))			// border cells are never closed
+					continue;
+				if (!paddedStepClear(blocked, moves, nidx, faceBlockedMask(blocked, moves, nidx), moves.opposite[m]))
+					continue;
+				double g = ws.g(nidx) + moves.cost[m];
+				if (g < best) {
+					best = g;
+					p = nidx;
+				}
+			}
+			ws.set(cur, best, p);
+		}
+
+		if (cur == pgoal) {
+			reachedGoal = true;
+			break;
+		}
+		ws.close(cur);
+		if ((++ws.expanded & 255) == 0 && ws.cancelled())
+			return {};
+
+		int grand = ws.parentOf(cur);
+		std::array<int, 3> grandIJK = padToIJK(grand);
+		double grandG = ws.g(grand);
+		uint8_t faces = faceBlockedMask(blocked, moves, cur);
+		for (int m = 0; m < 26; m++) {
+			if (!paddedStepClear(blocked, moves, cur, faces, m))
+				continue;
+
+			int nidx = cur + moves.delta[m];
+			if (ws.isClosed(nidx))
+				continue;
+
+			// assume line of sight from the grandparent; verified on expansion
+			std::array<int, 3> n = {ijk[0] + GRID_NBRS[m][0], ijk[1] + GRID_NBRS[m][1], ijk[2] + GRID_NBRS[m][2]};
+			double tg = grandG + ijkDistance(grandIJK, n);
+			if (tg < ws.g(nidx)) {
+				ws.set(nidx, tg, grand);
+				open.push(nidx, tg + ijkDistance(n, goalIJK));
+			}
+		}
+	}
+	if (!reachedGoal && ws.cancelled())
+		return {};
+	if (!reachedGoal) {
+		LOG_WARN("Lazy Theta* failed: open set exhausted, no path found!");
+		return {};
+	}
+	LOG_INFO("Lazy Theta* succeeded: found path to goal!");
+
+	std::vector<int> rev;
+	for (int at = pgoal; ; at = ws.parentOf(at)) {
+		rev.push_back(fromPad(at));
+		if (at == pstart)
+			break;
+	}
+	std::reverse(rev.begin(), rev.end());
+	return (rev);
+}
+
 /**
  * plan - create a flight path for the leader
  * @start:  starting coords in world space
@@ -297,9 +594,138 @@ std::vector<std::array<double, 3>> Pathfinder::plan(
 	const std::array<double, 3>& start,
 	const std::array<double, 3>& goal
 ) {
-	std::vector<int> raw = rawAStar(start, goal);
-	return (flatArrayToWorldArray(raw)); // comment out when uncommenting below
-	// std::vector<std::array<double, 3>> smooth = smoothPath(raw);
-	// print_xyz_path(smooth);
-	// return smooth;
+	return plan(start, goal, mode);
+}
+
+/**
+ * plan - create a flight path using a specific planner mode
+ * @start:  starting coords in world space
+ * @goal: 	goal coords in world space
+ * @mode_:	search to run for this query
+ * @cancel: optional flag another thread sets to abandon the search; searches
+ *	poll it every 256 expansions
+ *
+ * Return: returns a full path for the leader, empty if none or cancelled
+ */
+std::vector<std::array<double, 3>> Pathfinder::plan(
+	const std::array<double, 3>& start,
+	const std::array<double, 3>& goal,
+	PlannerMode mode_,
+	const std::atomic<bool>* cancel
+) {
+	workspace.cancel = cancel;
+	std::vector<std::array<double, 3>> path = planWith(workspace, start, goal, mode_);
+	workspace.cancel = nullptr;
+	return path;
+}
+
+/**
+ * planWith - runs one query on the given scratch buffers
+ * @ws: scratch buffers owned by the calling thread
+ * @worldStart: starting coords in world space
+ * @worldGoal: goal coords in world space
+ * @mode_: search to run
+ *
+ * Return: world path, empty if no path exists
+ */
+std::vector<std::array<double, 3>> Pathfinder::planWith(
+	SearchWorkspace& ws,
+	const std::array<double, 3>& worldStart,
+	const std::array<double, 3>& worldGoal,
+	PlannerMode mode_
+) {
+	int start, goal;
+	if (!resolveEndpoints(worldStart, worldGoal, start, goal, ws.overlay))
+		return {};
+
+	// the overlay is derived from the grid alone, so the version still covers it
+	uint64_t version = env.getVersion();
+
+	std::vector<int> raw;
+	if (cache.lookup(start, goal, mode_, version, raw)) {
+		ws.begin(px * py * pz);		// stamp the overlay for smoothing
+	} else {
+		if (mode_ == PlannerMode::BIDIRECTIONAL) {
+			raw = bidirectionalAStar(ws, start, goal);
+			if (raw.empty() && !ws.cancelled())
+				LOG_WARN("Bidirectional A* failed: no path found!");
+			else if (!raw.empty())
+				LOG_INFO("Bidirectional A* succeeded: found path to goal! (%llu cells expanded)", (unsigned long long)ws.expanded);
+		}
+		else if (mode_ == PlannerMode::LAZY_THETA)
+			raw = lazyThetaStar(ws, start, goal);
+		else
+			raw = rawAStar(ws, start, goal);
+
+		// an abandoned search says nothing about reachability, so keep it out of the cache
+		if (ws.cancelled())
+			return {};
+		cache.insert(start, goal, mode_, version, raw);
+	}
+
+	// Lazy Theta* already returns only corners; grid paths get the line-of-sight pass
+	if (mode_ == PlannerMode::LAZY_THETA)
+		return (flatArrayToWorldArray(raw));
+	return smoothPath(ws, raw);
+}
+
+/**
+ * ensurePool - starts the batch workers and their workspaces on first use
+ *
+ * The pool lives as long as the pathfinder, so planBatch can submit to it
+ * after this returns without holding pool_mutex.
+ */
+void Pathfinder::ensurePool() {
+	std::lock_guard<std::mutex> lock(pool_mutex);
+	if (pool)
+		return;
+	pool = std::make_unique<ThreadPool>();
+	worker_spaces.clear();
+	worker_spaces.resize(pool->size());
+}
+
+/**
+ * planBatch - solves many queries in parallel
+ * @queries: start/goal/mode per query
+ *
+ * Every worker searches with its own workspace over the shared grid, which
+ * is only read.
+ *
+ * Return: one future per query, in query order
+ */
+std::vector<std::future<std::vector<std::array<double, 3>>>> Pathfinder::planBatch(
+	const std::vector<PlanQuery>& queries
+) {
+	ensurePool();
+
+	std::vector<std::future<std::vector<std::array<double, 3>>>> results;
+	results.reserve(queries.size());
+	for (const PlanQuery& q : queries) {
+		results.push_back(pool->submit([this, q]() {
+			SearchWorkspace& ws = worker_spaces[ThreadPool::current_worker()];
+			return planWith(ws, q.start, q.goal, q.mode);
+		}));
+	}
+	return results;
+}
+
+/**
+ * planBatch - solves many queries in parallel, reporting through a callback
+ * @queries: start/goal/mode per query
+ * @on_done: called with (query index, path) as each query finishes; runs on a
+ *	worker thread, so it must be safe to call concurrently
+ */
+void Pathfinder::planBatch(
+	const std::vector<PlanQuery>& queries,
+	std::function<void(size_t, std::vector<std::array<double, 3>>)> on_done
+) {
+	ensurePool();
+
+	for (size_t i = 0; i < queries.size(); i++) {
+		PlanQuery q = queries[i];
+		pool->submit([this, q, i, on_done]() {
+			SearchWorkspace& ws = worker_spaces[ThreadPool::current_worker()];
+			on_done(i, planWith(ws, q.start, q.goal, q.mode));
+		});
+	}
 }
@@ -1,74 +1,168 @@
 #pragma once
 #include "environment.h"
+#include "grid_moves.h"
+#include "thread_pool.h"
+#include "path_cache.h"
+#include "indexed_heap.h"
 #include <unordered_map>
 #include <queue>
+#include <memory>
+#include <mutex>
+#include <functional>
+#include <future>
+#include <atomic>
 
-#define ROOT2 1.414
-#define ROOT3 1.732
+// which search plan() runs
+enum class PlannerMode {
+	ASTAR,			// full-grid A*
+	LAZY_THETA,		// any-angle Lazy Theta*, returns only the corner cells
+	BIDIRECTIONAL,	// A* from both ends, meeting in the middle; bench only, slower than ASTAR here
+};
+
+// per-search scratch buffers, reused between searches run on the same thread.
+// Cells are reset lazily by generation stamps instead of clearing whole arrays.
+struct SearchWorkspace {
+	std::vector<double>   gscore;	// best known g value per cell
+	std::vector<int>      parent;	// previous cell on the best path
+	std::vector<uint32_t> touched;	// generation gscore/parent were last written in
+	std::vector<uint32_t> closed;	// generation the cell was expanded in
+	std::vector<uint32_t> freed;	// generation a blocked cell was overlaid as free in
+	std::vector<int>      overlay;	// padded cells this query treats as free, stamped by begin()
+	uint32_t generation = 0;
+	IndexedHeap<4> open;			// open list with decrease-key
+	uint64_t expanded = 0;			// cells expanded by the last search
+	const std::atomic<bool>* cancel = nullptr;	// the search gives up once this turns true
+	std::unique_ptr<SearchWorkspace> partner;	// goal-side buffers for bidirectional search
+
+	void begin(int total);
+	SearchWorkspace& reverse();
+	bool cancelled() const { return cancel && cancel->load(std::memory_order_relaxed); }
+	double g(int idx) const {
+		return (touched[idx] == generation) ? gscore[idx] : std::numeric_limits<double>::infinity();
+	}
+	int parentOf(int idx) const { return (touched[idx] == generation) ? parent[idx] : -1; }
+	void set(int idx, double g_, int parent_) {
+		gscore[idx] = g_;
+		parent[idx] = parent_;
+		touched[idx] = generation;
+	}
+	bool isClosed(int idx) const { return closed[idx] == generation; }
+	// the overlay is only consulted for cells the grid says are blocked
+	bool blocked(const uint8_t* occ, int idx) const { return occ[idx] && freed[idx] != generation; }
+	void close(int idx) { closed[idx] = generation; }
+};
+
+// one query for the batch API
+struct PlanQuery {
+	std::array<double, 3> start;
+	std::array<double, 3> goal;
+	PlannerMode mode;
+};
 
 class Pathfinder {
 private:
 	Environment& env;
 	int nx, ny, nz;
+	int px, py, pz;			// padded grid dimensions
+	PaddedMoves moves;		// neighbor offsets and legality masks on the padded grid
 	double res;
 	double epsilon = 1;	//for simplifying actions
+	PlannerMode mode = PlannerMode::LAZY_THETA;
+	SearchWorkspace workspace;				// used by plan() on the caller's thread
+	PathCache cache;						// recent raw paths, invalidated by occupancy version
 
-public:
-	struct Node {
-		int idx;		// flattened cell index
-		double f;		// the A* key estimating total path cost via this node
-		double g;		// the cost from the start node to the current node
-	};
-	struct NodeCmp {
-		bool operator() (Node const&a, Node const& b) const {
-			return a.f > b.f;
-		}
-	};
+	// batch planning
+	std::unique_ptr<ThreadPool> pool;		// one worker per hardware thread, never replaced once started
+	std::vector<SearchWorkspace> worker_spaces;	// one per pool worker
+	std::mutex pool_mutex;
 
+public:
 	std::vector<std::array<double, 3>> plan(
 		const std::array<double, 3>& worldStart,
 		const std::array<double, 3>& worldGoal
 	);
+	std::vector<std::array<double, 3>> plan(
+		const std::array<double, 3>& worldStart,
+		const std::array<double, 3>& worldGoal,
+		PlannerMode mode_,
+		const std::atomic<bool>* cancel = nullptr
+	);
+
+	// batch planning: queries are solved in parallel over the shared, read-only grid
+	std::vector<std::future<std::vector<std::array<double, 3>>>> planBatch(
+		const std::vector<PlanQuery>& queries
+	);
+	void planBatch(
+		const std::vector<PlanQuery>& queries,
+		std::function<void(size_t, std::vector<std::array<double, 3>>)> on_done
+	);
 
 	// Constructor
-	Pathfinder(Environment& e) : env(e), nx(e.getNx()), ny(e.getNy()), nz(e.getNz()), res(e.getResolution()) {}
+	Pathfinder(Environment& e) : env(e), nx(e.getNx()), ny(e.getNy()), nz(e.getNz()),
+		px(nx + 2), py(ny + 2), pz(nz + 2), moves(makePaddedMoves(nx, ny)), res(e.getResolution()) {}
 
 	// getter
 	double getResolution() { return res; }
+	PlannerMode getMode() const { return mode; }
+	const PathCache& getCache() const { return cache; }
 
 	// setter
 	void setEpsilon(double epsilon_) { epsilon = epsilon_; }
+	void setMode(PlannerMode mode_) { mode = mode_; }
+	void setCacheCapacity(size_t capacity_) { cache.setCapacity(capacity_); }
 
-private:
-	// The 6 neighbor offsets of a cell (might expand to the 26)
-	static constexpr std::array<std::array<int, 3>, 26> nbrs = {{
-		// Face neighbors (cost = 1.0)
-		{{1, 0, 0}}, {{-1, 0, 0}},
-		{{0, 1, 0}}, {{0 , -1, 0}},
-		{{0, 0, 1}}, {{0, 0, -1}},
-
-		// Edge neighbors (cost = sqrt(2) ≈ 1.414)
-		{{1, 1, 0}}, {{1, -1, 0}}, {{-1, 1, 0}}, {{-1, -1, 0}},
-		{{1, 0, 1}}, {{1, 0, -1}}, {{-1, 0, 1}}, {{-1, 0, -1}},
-		{{0, 1, 1}}, {{0, 1, -1}}, {{0, -1, 1}}, {{0, -1, -1}},
+	// open-list comparison for --bench-planner
+	HeapStats benchmarkAStar(const std::array<double, 3>& worldStart, const std::array<double, 3>& worldGoal,
+		bool legacy_heap, std::vector<int>* out = nullptr);
+	HeapStats benchmarkBidirectional(const std::array<double, 3>& worldStart, const std::array<double, 3>& worldGoal,
+		std::vector<int>* out = nullptr);
+	double pathCost(const std::vector<int>& cells) const;
 
-		// Corner neighbors (cost = sqrt(3) ≈ 1.732)
-		{{1, 1, 1}}, {{1, 1, -1}}, {{1, -1, 1}}, {{1, -1, -1}},
-		{{-1, 1, 1}}, {{-1, 1, -1}}, {{-1, -1, 1}}, {{-1, -1, -1}}
-	}};
+private:
 
 	inline int toIdx(int i, int j, int k) const {
 		return (k * ny + j) * nx + i;
 	}
-	inline std::array<int, 3> toIJK(int idx) const;
+	// flattened index back to (i, j, k)
+	inline std::array<int, 3> toIJK(int idx) const {
+		int i = idx % nx;
+		int temp = idx / nx;
+		int j = temp % ny;
+		return {i, j, temp / ny};
+	}
+	std::array<int, 3> padToIJK(int p) const;
+	inline int toPad(int idx) const {
+		std::array<int, 3> ijk = toIJK(idx);
+		return env.padIdx(ijk[0], ijk[1], ijk[2]);
+	}
+	inline int fromPad(int p) const {
+		std::array<int, 3> ijk = padToIJK(p);
+		return toIdx(ijk[0], ijk[1], ijk[2]);
+	}
+	static inline double ijkDistance(const std::array<int, 3>& a, const std::array<int, 3>& b) {
+		double dx = a[0] - b[0];
+		double dy = a[1] - b[1];
+		double dz = a[2] - b[2];
+		return std::sqrt(dx * dx + dy * dy + dz * dz);
+	}
 	double heuristic(int idx_a, int idx_b) const;
+	double cellDistance(int idx_a, int idx_b) const { return heuristic(idx_a, idx_b); }
 	bool isLineClear(const std::array<double, 3>& A, const std::array<double, 3>& B) const;
-	std::vector<int> rawAStar(std::array<double, 3> worldStart, std::array<double, 3> worldGoal);
-	std::vector<std::array<double, 3>> smoothPath(const std::vector<int>& raw);
-
-	void print_idx_path(std::vector<int> path);
-	void print_xyz_path(std::vector<std::array<double, 3>> path);
-	std::vector<std::array<double, 3>> flatArrayToWorldArray(const std::vector<int>& raw);
+	bool cellLineClear(const SearchWorkspace& ws, int idx_a, int idx_b) const;
+	bool cellLineClear(const SearchWorkspace& ws, const std::array<int, 3>& a, const std::array<int, 3>& b) const;
+	bool resolveEndpoints(const std::array<double, 3>& worldStart, const std::array<double, 3>& worldGoal,
+		int& start, int& goal, std::vector<int>& overlay) const;
+	std::vector<std::array<double, 3>> planWith(SearchWorkspace& ws, const std::array<double, 3>& worldStart,
+		const std::array<double, 3>& worldGoal, PlannerMode mode_);
+	std::vector<int> rawAStar(SearchWorkspace& ws, int start, int goal) const;
+	template <class OpenList>
+	std::vector<int> aStarSearch(SearchWorkspace& ws, OpenList& open, int start, int goal) const;
+	std::vector<int> bidirectionalAStar(SearchWorkspace& ws, int start, int goal) const;
+	std::vector<int> lazyThetaStar(SearchWorkspace& ws, int start, int goal) const;
+	std::vector<std::array<double, 3>> smoothPath(const SearchWorkspace& ws, const std::vector<int>& raw) const;
+	void ensurePool();
 
-	double getMoveCost(const std::array<int, 3>& move) const;
+	void print_idx_path(std::vector<int> path) const;
+	void print_xyz_path(std::vector<std::array<double, 3>> path) const;
+	std::vector<std::array<double, 3>> flatArrayToWorldArray(const std::vector<int>& raw) const;
 };
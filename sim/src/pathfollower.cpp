@@ -1,12 +1,39 @@
 #include "pathfollower.h"
+#include <algorithm>
 
 /**
- * setPath - sets the path from the passed waypoints and resets currentIndex
- * @waypoints: smooth path from pathfinder's path()
+ * setTrajectory - sets the trajectory to follow and restarts at its beginning
+ * @trajectory_: smoothed, arc-length sampled path
  */
-void Pathfollower::setPath(const std::vector<std::array<double, 3>>& waypoints) {
-	path = waypoints;
-	currentIndex = 0;
+void Pathfollower::setTrajectory(Trajectory trajectory_) {
+	trajectory = std::move(trajectory_);
+	progress = 0.0;
+	progress_seg = 0;
+	carrot_seg = 0;
+}
+
+/**
+ * getState - progress along the trajectory and the speeds in play
+ *
+ * Return: everything but the trajectory and leader, for a snapshot
+ */
+FollowerState Pathfollower::getState() const {
+	return {progress, progress_seg, carrot_seg, lookahead, tolerance, cruise_speed, commanded_speed};
+}
+
+/**
+ * setState - resumes where a snapshot left off; call after setTrajectory
+ * @state: from getState, against the same trajectory
+ */
+void Pathfollower::setState(const FollowerState& state) {
+	size_t last_seg = trajectory.pointCount() > 1 ? trajectory.pointCount() - 2 : 0;
+	progress = state.progress;
+	progress_seg = std::min<size_t>(state.progress_seg, last_seg);
+	carrot_seg = std::min<size_t>(state.carrot_seg, last_seg);
+	lookahead = state.lookahead;
+	tolerance = state.tolerance;
+	cruise_speed = state.cruise_speed;
+	commanded_speed = state.commanded_speed;
 }
 
 /**
@@ -14,54 +41,29 @@ void Pathfollower::setPath(const std::vector<std::array<double, 3>>& waypoints)
  *
  * Return: steering location lookahead meters along path
  */
-std::array<double, 3> Pathfollower::computeCarrot() const {
-	double remain = lookahead;		// remainder of lookahead
-	int path_size = path.size();
-	std::array<double, 3> carrot;
-
-	// iterate through points until finding lookahead point along path
-	for (int i = currentIndex; i + 1< path_size; i++) {
-		const auto& A = path[i];
-		const auto& B = path[i + 1];
-		double dx = B[0] - A[0];
-		double dy = B[1] - A[1];
-		double dz = B[2] - A[2];
-		double segLen = std::sqrt(dx * dx + dy * dy + dz * dz);	// length of segment between points
-		if (remain < segLen) {
-			double frac = remain / segLen;
-			carrot = {A[0] + frac * dx, A[1] + frac * dy, A[2] + frac * dz};
-			return (carrot);
-		}
-		remain -= segLen;	// remove segLen from remainder as looking at next point
-	}
-	return path.back();		// use final waypoint if lookahead exceeds path remaining
+std::array<double, 3> Pathfollower::computeCarrot() {
+	return trajectory.sample(progress + lookahead, carrot_seg);	// clamps to the end of the path
 }
 
 /**
  * update - update leader position
  */
 void Pathfollower::update_leader_velocity(double dt) {
-	if (path.empty())
+	if (trajectory.empty())
 		return;
 
-	auto pos = leader.get_pos();
-	int path_size = path.size();
+	auto pos = leader->get_pos();
 
-	// advance currentIndex if needed including type-packed wavepoints
-	while (currentIndex < path_size) {
-		auto& wp = path[currentIndex];
-		double dx = wp[0] - pos[0];
-		double dy = wp[1] - pos[1];
-		double dz = wp[2] - pos[2];
+	// advance along the path: closest point between the last projection and the carrot
+	progress = std::max(progress, trajectory.project(pos, progress, progress_seg, lookahead + tolerance));
 
-		if (std::sqrt(dx * dx + dy * dy + dz *dz) < tolerance)
-			currentIndex++;
-		else
-			break;
-	}
-
-	if (currentIndex >= path_size) {
-		leader.set_velocity(0, 0, 0);
+	auto end = trajectory.sample(trajectory.length());
+	double ex = end[0] - pos[0];
+	double ey = end[1] - pos[1];
+	double ez = end[2] - pos[2];
+	if (trajectory.length() - progress < tolerance && std::sqrt(ex * ex + ey * ey + ez * ez) < tolerance) {
+		leader->set_velocity(0, 0, 0);
+		trajectory = Trajectory();
 		return;	// goal reached
 	}
 
@@ -77,14 +79,20 @@ void Pathfollower::update_leader_velocity(double dt) {
 		return;
 
 	// maintain current speed magnitude in directional change
-	auto vel = leader.get_vel();
+	auto vel = leader->get_vel();
 	double speed = std::sqrt(vel[0] * vel[0] + vel[1] * vel[1] + vel[2] * vel[2]);
 	// if the leader is stopped, do not inject climb/turn commands
 	if (speed < 1e-3)
 		return;
 
+	// anything other than our own slow-down sets the cruise speed
+	if (std::fabs(speed - commanded_speed) > 1e-6)
+		cruise_speed = speed;
+	speed = std::min(cruise_speed, trajectory.speedLimit(progress));
+	commanded_speed = speed;
+
 	double vx = speed * dx / dist;
 	double vy = speed * dy / dist;
 	double vz = speed * dz / dist;
-	leader.set_velocity(vx, vy, vz);
+	leader->set_velocity(vx, vy, vz);
 }
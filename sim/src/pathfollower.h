@@ -1,31 +1,54 @@
 #pragma once
 #include "uav.h"
+#include "trajectory.h"
 #include <vector>
 #include <array>
 #include <cmath>
 #include <thread>
+#include <cstdint>
 // #include "uav.h"
 
 class UAV; // forward declaration to avoid circular header dependencies
 
+// where a follower is along its trajectory, for snapshots
+struct FollowerState {
+	double progress;
+	uint64_t progress_seg;
+	uint64_t carrot_seg;
+	double lookahead;
+	double tolerance;
+	double cruise_speed;
+	double commanded_speed;
+};
+
 class Pathfollower {
 private:
-	UAV& leader;
-	std::vector<std::array<double, 3>> path;
-	int currentIndex = 0;
+	UAV* leader;				// rebound by setLeader when the swarm vector is rebuilt
+	Trajectory trajectory;
+	double progress = 0.0;		// arc length of the leader's projection onto the trajectory
+	size_t progress_seg = 0;	// trajectory segment holding progress
+	size_t carrot_seg = 0;		// trajectory segment holding the carrot
 	double lookahead = 10.0;
 	double tolerance;
+	double cruise_speed = 0.0;	// speed requested from outside, restored after slow sections
+	double commanded_speed = -1.0;	// speed this follower last set
 
 public:
-	Pathfollower(UAV& leader_, double resolution) : leader(leader_), tolerance(resolution) {};
+	Pathfollower(UAV& leader_, double resolution) : leader(&leader_), tolerance(resolution) {};
 
 	void update_leader_velocity(double dt);
 
+	//getter
+	const Trajectory& getTrajectory() const	{ return trajectory; }
+	FollowerState getState() const;
+
 	//setter
-	void setPath(const std::vector<std::array<double, 3>>& waypoints);
+	void setTrajectory(Trajectory trajectory_);
+	void setLeader(UAV& leader_)			{ leader = &leader_; }
 	void setLookahead(double lookahead_)	{ lookahead = lookahead_; }
 	void setTolerance(double tolerance_)	{ tolerance = tolerance_; }
+	void setState(const FollowerState& state);
 
 private:
-	std::array<double, 3> computeCarrot() const;
-};
\ No newline at end of file
+	std::array<double, 3> computeCarrot();
+};
@@ -0,0 +1,127 @@
+#include "planner_bench.h"
+#include "pathfinder.h"
+#include "simulator.h"
+#include <chrono>
+#include <random>
+#include <cstdio>
+#include <cmath>
+
+namespace
+{
+	struct BenchTotals
+	{
+		HeapStats heap;			// summed, except peaks which take the max
+		double ms = 0.0;
+		size_t path_cells = 0;
+	};
+
+	void accumulate(BenchTotals &t, const HeapStats &s, double ms, size_t cells)
+	{
+		t.heap.pushes += s.pushes;
+		t.heap.pops += s.pops;
+		t.heap.decrease_keys += s.decrease_keys;
+		t.heap.peak_size = std::max(t.heap.peak_size, s.peak_size);
+		t.heap.bytes = std::max(t.heap.bytes, s.bytes);
+		t.ms += ms;
+		t.path_cells += cells;
+	}
+
+	void print_row(const char *name, const BenchTotals &t)
+	{
+		std::printf("  %-8s pushes %10llu  pops %10llu  decrease-keys %9llu  peak %8zu  peak bytes %10zu  %9.1f ms\n",
+					name,
+					(unsigned long long)t.heap.pushes,
+					(unsigned long long)t.heap.pops,
+					(unsigned long long)t.heap.decrease_keys,
+					t.heap.peak_size,
+					t.heap.bytes,
+					t.ms);
+	}
+
+	using Route = std::pair<std::array<double, 3>, std::array<double, 3>>;
+
+	// plans each route twice, then again from halfway along it, the way repeated RTBs ask
+	double replay_routes(Pathfinder &pathfinder, const std::vector<Route> &routes)
+	{
+		auto t0 = std::chrono::steady_clock::now();
+		for (const Route &r : routes)
+		{
+			auto path = pathfinder.plan(r.first, r.second, PlannerMode::ASTAR);
+			pathfinder.plan(r.first, r.second, PlannerMode::ASTAR);
+			if (path.size() > 2)
+				pathfinder.plan(path[path.size() / 2], r.second, PlannerMode::ASTAR);
+		}
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+	}
+}
+
+int run_planner_bench(int queries, uint32_t seed)
+{
+	const int fields[] = {65, 250};		// the sim's default density, and a dense field
+
+	for (int obstacles : fields)
+	{
+		Environment env(BORDER_X / RESOLUTION, BORDER_Y / RESOLUTION, BORDER_Z / RESOLUTION, RESOLUTION);
+		env.generate_random_obstacles(obstacles, seed);
+		Pathfinder pathfinder(env);
+
+		std::mt19937 rng(seed);
+		std::uniform_real_distribution<double> xy(-BORDER_X / 2.0 + RESOLUTION, BORDER_X / 2.0 - RESOLUTION);
+		std::uniform_real_distribution<double> z(RESOLUTION, 150.0);
+
+		BenchTotals legacy, indexed, bidir;
+		int ran = 0, mismatched = 0, costlier = 0;
+		std::vector<Route> routes;		// the first reachable queries, replayed through the path cache
+		while (ran < queries)
+		{
+			std::array<double, 3> start = {xy(rng), xy(rng), z(rng)};
+			std::array<double, 3> goal = {xy(rng), xy(rng), z(rng)};
+			std::array<int, 3> s = env.toGrid(start);
+			std::array<int, 3> g = env.toGrid(goal);
+			if (env.isBlocked(s[0], s[1], s[2]) || env.isBlocked(g[0], g[1], g[2]))
+				continue;
+
+			std::vector<int> a, b;
+			auto t0 = std::chrono::steady_clock::now();
+			HeapStats ls = pathfinder.benchmarkAStar(start, goal, true, &a);
+			auto t1 = std::chrono::steady_clock::now();
+			HeapStats is = pathfinder.benchmarkAStar(start, goal, false, &b);
+			auto t2 = std::chrono::steady_clock::now();
+			std::vector<int> c;
+			HeapStats bs = pathfinder.benchmarkBidirectional(start, goal, &c);
+			auto t3 = std::chrono::steady_clock::now();
+
+			accumulate(legacy, ls, std::chrono::duration<double, std::milli>(t1 - t0).count(), a.size());
+			accumulate(indexed, is, std::chrono::duration<double, std::milli>(t2 - t1).count(), b.size());
+			accumulate(bidir, bs, std::chrono::duration<double, std::milli>(t3 - t2).count(), c.size());
+			// both searches are optimal on the same grid, so only ties may differ in shape
+			if (!b.empty() && !c.empty() && std::abs(pathfinder.pathCost(c) - pathfinder.pathCost(b)) > 1e-6)
+				costlier++;
+			if (!b.empty() && routes.size() < 10)
+				routes.push_back({start, goal});
+			if (a.empty() != b.empty() || a.empty() != c.empty())
+				mismatched++;
+			ran++;
+		}
+
+		std::printf("%d obstacles, %d queries (seed %u)\n", obstacles, queries, seed);
+		print_row("lazy", legacy);
+		print_row("indexed", indexed);
+		print_row("bidir", bidir);
+
+		// the benchmark searches above bypass the cache, so it starts out empty here
+		const PathCache &cache = pathfinder.getCache();
+		double cached_ms = replay_routes(pathfinder, routes);
+		uint64_t hits = cache.getHits(), suffix_hits = cache.getSuffixHits(), misses = cache.getMisses();
+		pathfinder.setCacheCapacity(0);
+		double uncached_ms = replay_routes(pathfinder, routes);
+		std::printf("  %-8s %zu routes x3: %llu hits, %llu suffix hits, %llu misses  %9.1f ms (%.1f ms uncached)\n",
+					"cache", routes.size(), (unsigned long long)hits, (unsigned long long)suffix_hits,
+					(unsigned long long)misses, cached_ms, uncached_ms);
+		if (mismatched)
+			std::printf("  WARNING: %d queries disagreed on reachability\n", mismatched);
+		if (costlier)
+			std::printf("  WARNING: %d bidirectional paths differ in cost from A*\n", costlier);
+	}
+	return 0;
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include <cstdint>
+
+/**
+ * run_planner_bench - compares A* open lists on seeded obstacle fields
+ * @queries: random start/goal pairs per field
+ * @seed: obstacle and query seed
+ *
+ * Runs every query with A* on the legacy lazy-deletion priority queue, A* on
+ * the indexed 4-ary heap, and bidirectional A*, and prints heap operations,
+ * peak entries, peak bytes and time for each. With the indexed heap, pops
+ * equal the number of cells expanded. Bidirectional paths must cost the same
+ * as A*'s; any that do not are reported. The first ten routes are then
+ * replayed through the path cache, each planned twice and once more from
+ * halfway along, the way repeated RTBs ask, and the cache's hits, suffix
+ * hits and misses are reported against the same replay with the cache off.
+ * Started with `sim --bench-planner [queries] [seed]`.
+ *
+ * Return: process exit code
+ */
+int run_planner_bench(int queries, uint32_t seed);
@@ -0,0 +1,86 @@
+#pragma once
+#include <atomic>
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+#define MANUAL_HOLD_TICKS 20 // ticks without a new setpoint before a manual UAV stops and hovers
+
+// what an external controller last asked of one UAV
+struct Setpoint
+{
+	uint64_t manual;	// 1: fly at vel, skipping autonomous forces; 0: hand back to autonomy
+	double vel[3];
+};
+
+/**
+ * SetpointMailbox - latest setpoint for one UAV, posted without a lock
+ *
+ * The command thread posts while the tick that owns the UAV takes; neither
+ * waits on the other. Like TelemetryTable's slots this is a seqlock: an odd
+ * sequence means a post is in progress, and take() retries if the sequence
+ * moved while it copied. Only the newest setpoint matters, so a post simply
+ * overwrites one the tick hasn't seen yet. One thread posts at a time.
+ */
+class SetpointMailbox
+{
+private:
+	static constexpr size_t WORDS = sizeof(Setpoint) / sizeof(uint64_t);
+	static_assert(sizeof(Setpoint) % sizeof(uint64_t) == 0, "setpoint must pack into whole words");
+
+	std::atomic<uint32_t> seq{0};
+	std::array<std::atomic<uint64_t>, WORDS> words{};
+
+	// tick side only
+	uint32_t taken = 0;			// sequence of the last setpoint taken
+	uint32_t idle_ticks = 0;	// ticks since then
+
+public:
+	void post(const Setpoint &sp);
+	bool take(Setpoint &out);
+	bool idle_for(uint32_t ticks) { return ++idle_ticks > ticks; }
+	void discard() { taken = seq.load(std::memory_order_acquire) & ~1u; } // a post in progress still lands
+};
+
+/**
+ * post - publishes a setpoint (command thread)
+ * @sp: replaces whatever is waiting
+ */
+inline void SetpointMailbox::post(const Setpoint &sp)
+{
+	uint64_t w[WORDS];
+	memcpy(w, &sp, sizeof(sp));
+
+	uint32_t s = seq.load(std::memory_order_relaxed);
+	seq.store(s + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	for (size_t i = 0; i < WORDS; i++)
+		words[i].store(w[i], std::memory_order_relaxed);
+	seq.store(s + 2, std::memory_order_release);
+}
+
+/**
+ * take - copies out a setpoint posted since the last take (tick thread)
+ * @out: filled on success
+ *
+ * Return: false if nothing new was posted, or a post is mid-write; it will
+ *	still be there next tick
+ */
+inline bool SetpointMailbox::take(Setpoint &out)
+{
+	uint32_t before = seq.load(std::memory_order_acquire);
+	if (before == taken || (before & 1))
+		return false;
+
+	uint64_t w[WORDS];
+	for (size_t i = 0; i < WORDS; i++)
+		w[i] = words[i].load(std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_acquire);
+	if (seq.load(std::memory_order_relaxed) != before)
+		return false;
+
+	memcpy(&out, w, sizeof(out));
+	taken = before;
+	idle_ticks = 0;
+	return true;
+}
@@ -1,7 +1,12 @@
 #include "simulator.h"
 #include "uav.h"
+#include "logger.h"
+#include "swarm_tuning.h"
 #include <cmath>
 
+// print_swarm_status writes one line per UAV, well past the default per-site rate
+static constexpr uint32_t STATUS_LINES_PER_SECOND = 100000;
+
 /**
  * generate_test_obstacles - generates obstacles at set locations
  */
@@ -12,16 +17,55 @@ void UAVSimulator::generate_test_obstacles()
 }
 
 /**
- * RTB - Return To Base: returns leader to base
+ * has_leader - whether the UAV in formation slot 0 is simulated here
+ *
+ * Return: false when the leader is owned by another rank
  */
-void UAVSimulator::RTB()
+bool Swarm::has_leader() const
 {
-	pathfinder.plan(swarm[0].get_pos(), {0.0, 0.0, 20.0});
+	for (const auto &uav : uavs)
+	{
+		if (uav.get_slot() == 0)
+			return true;
+	}
+	return false;
+}
+
+/**
+ * leader - the UAV in formation slot 0
+ *
+ * Return: the swarm's leader (first UAV if no slot 0 is present)
+ */
+UAV &Swarm::leader()
+{
+	for (auto &uav : uavs)
+	{
+		if (uav.get_slot() == 0)
+			return uav;
+	}
+	return uavs[0];
+}
+
+/**
+ * RTB - Return To Base: returns a swarm's leader to where the swarm spawned; caller holds swarm_mutex
+ * @s: swarm to bring home
+ */
+void UAVSimulator::RTB(Swarm &s)
+{
+	if (!s.has_leader())
+		return;
+
+	// ensure autopilot is on so RTB path is followed
+	s.leader_autopilot.store(true);
+	UAV &leader = s.leader();
+	request_plan(s, leader.get_pos(), s.home, false);
 
 	// change speed if at zero
-	auto vel = swarm[0].get_vel();
+	auto vel = leader.get_vel();
 	if (sqrt(vel[0]*vel[0] + vel[1]*vel[1] + vel[2]*vel[2]) < 1e-2)
-		swarm[0].set_velocity(1,1,1);  // (better if set to direct course)
+		leader.set_velocity(1,1,1);  // (better if set to direct course)
+
+	LOG_INFO("RTB: swarm %d leader plotting path back to base", s.id);
 }
 
 /**
@@ -29,95 +73,156 @@ void UAVSimulator::RTB()
  */
 void UAVSimulator::print_swarm_status()
 {
-	size_t swarm_size = swarm.size();
+	std::lock_guard<std::mutex> lock(swarm_mutex);
+
+	// a full dump is asked for explicitly, so only the ring size limits it
+	LOG_AT(LOG_LEVEL_INFO, STATUS_LINES_PER_SECOND, "Printing current swarm.");
+	LOG_AT(LOG_LEVEL_INFO, STATUS_LINES_PER_SECOND, "ID: Position X, Y, Z. Velocity: vx, vy, vz");
 
-	std::cout << std::fixed << std::setprecision(2);
-	std::cout << "\nPrinting current swarm.\n"
-			  << std::endl;
-	std::cout << "ID: Position X, Y, Z. Velocity: vx, vy, vz" << std::endl;
+	for (auto &s : swarms)
+	{
+		if (swarms.size() > 1)
+			LOG_AT(LOG_LEVEL_INFO, STATUS_LINES_PER_SECOND, "Swarm %d:", s->id);
+		for (auto &uav : s->uavs)
+		{
+			LOG_AT(LOG_LEVEL_INFO, STATUS_LINES_PER_SECOND, "%d: Position %.2f, %.2f, %.2f. Velocity: %.2f, %.2f, %.2f",
+				   uav.get_id(), uav.get_x(), uav.get_y(), uav.get_z(),
+				   uav.get_velx(), uav.get_vely(), uav.get_velz());
+		}
+	}
 
-	for (size_t i = 0; i < swarm_size; i++)
+	if (partition)
 	{
-		std::cout << swarm[i].get_id() << ": Position " << swarm[i].get_x()
-				  << ", " << swarm[i].get_y() << ", " << swarm[i].get_z()
-				  << ". Velocity: " << swarm[i].get_velx() << ", " << swarm[i].get_vely()
-				  << ", " << swarm[i].get_velz() << std::endl;
+		const SpatialPartition::Stats &stats = partition->get_stats();
+		LOG_INFO("Partition rank %d: ghosts out/in %llu/%llu, handoffs out/in %llu/%llu", partition->get_rank(),
+				 (unsigned long long)stats.ghosts_sent, (unsigned long long)stats.ghosts_received,
+				 (unsigned long long)stats.handoffs_sent, (unsigned long long)stats.handoffs_received);
 	}
 };
 
 /**
- * Constructor for UAVSimulator
+ * spawn_swarm - adds a swarm in formation around its home point
+ * @num_uavs: UAVs in the swarm, leader included
+ * @home: leader's start position, also the rtb target
+ * @goal: mission goal for the leader
  */
-UAVSimulator::UAVSimulator(int num_uavs) : env(BORDER_X / RESOLUTION, BORDER_Y / RESOLUTION, BORDER_Z / RESOLUTION, RESOLUTION),
-										   pathfinder(env)
+void UAVSimulator::spawn_swarm(int num_uavs, const std::array<double, 3> &home, const std::array<double, 3> &goal)
 {
+	auto s = std::make_unique<Swarm>();
+	s->id = swarms.size();
+	s->home = home;
+	s->goalXYZ = goal;
+	s->setpoints.reset(new SetpointMailbox[SWARM_ID_STRIDE]);
+	num_uavs = std::clamp(num_uavs, 1, SWARM_ID_STRIDE);
+	s->slots = num_uavs;
+
 	// create base UAVs at a common starting point and base altitude
-	swarm.reserve(num_uavs); // allocates memory to reduce resizing slowdowns
+	s->uavs.reserve(num_uavs); // allocates memory to reduce resizing slowdowns
 	for (int i = 0; i < num_uavs; i++)
 	{
 		// leader and followers start co-located; formation offsets will spread them out
-		swarm.push_back(UAV(i, 8000 + i, 0.0, 0.0, 20.0, env));
 		// give everyone an initial forward velocity along +Y
-		swarm[i].set_velocity(0.0, 5.0, 0.0); // cruisin on y axis
+		s->uavs.push_back(make_uav(*s, i, home, {0.0, 5.0, 0.0})); // cruisin on y axis
 	}
 
-	// set initial formation (LINE as default) and compute offsets
-	change_formation(FLYING_V);
+	// set initial formation and compute offsets
+	apply_formation(*s, FLYING_V);
 
 	// apply formation offsets around the leader so the swarm starts in formation
-	if (!swarm.empty())
-	{
-		// use UAV with id 0 as leader
-		std::size_t leader_idx = 0;
-		for (std::size_t i = 0; i < swarm.size(); ++i)
-		{
-			if (swarm[i].get_id() == 0)
-			{
-				leader_idx = i;
-				break;
-			}
-		}
+	UAV &leader = s->leader();
 
-		// leader position defines the origin for formation placement
-		double leader_x = swarm[leader_idx].get_x();
-		double leader_y = swarm[leader_idx].get_y();
-		double leader_z = swarm[leader_idx].get_z();
+	// leader position defines the origin for formation placement
+	double leader_x = leader.get_x();
+	double leader_y = leader.get_y();
+	double leader_z = leader.get_z();
 
-		SwarmCoordinator &coords = swarm[leader_idx].get_SwarmCoord();
+	SwarmCoordinator &coords = s->coords;
 
-		// Place UAVs directly using formation offsets in world space.
-		// Initial formation is aligned to global axes, and Z is kept at leader altitude.
-		for (int i = 0; i < num_uavs; i++)
-		{
-			std::array<double, 3> base_offset = coords.get_formation_offset(i);
+	// Place UAVs directly using formation offsets in world space.
+	// Initial formation is aligned to global axes, and Z is kept at leader altitude.
+	for (auto &uav : s->uavs)
+	{
+		std::array<double, 3> base_offset = coords.get_formation_offset(uav.get_slot());
 
-			swarm[i].set_position(
-				leader_x + base_offset[0],
-				leader_y + base_offset[1],
-				leader_z);
-		}
+		uav.set_position(
+			leader_x + base_offset[0],
+			leader_y + base_offset[1],
+			leader_z);
 	}
 
-	std::cout << "Created swarm with " << num_uavs << " UAVs" << std::endl;
-	print_swarm_status();
+	LOG_INFO("Created swarm %d with %d UAVs", s->id, num_uavs);
+	swarms.push_back(std::move(s));
+}
 
-	// Set Up Environment
-	env.generate_random_obstacles(65);
-	// generate_test_obstacles(); 					// for testing
+/**
+ * Constructor for UAVSimulator
+ * @num_uavs: UAVs per swarm
+ * @num_swarms: independent swarms sharing the environment
+ * @seed: obstacle field seed, 0 for a different field every run
+ * @config_: obstacle count, headless operation and tuning
+ */
+UAVSimulator::UAVSimulator(int num_uavs, int num_swarms, uint32_t seed, const SimConfig &config_) : config(config_),
+														   env(BORDER_X / RESOLUTION, BORDER_Y / RESOLUTION, BORDER_Z / RESOLUTION, RESOLUTION),
+														   pathfinder(env)
+{
+	num_swarms = std::max(1, num_swarms);
+	tuning_swarm_size = current_tuning().swarm_size;
+	pathfinder.setMode(config.planner);
 
-	std::array<double, 3> startXYZ = swarm[0].get_pos();
-	// Pick a corner goal 50m above start altitude to ensure vertical clearance
+	// swarms start side by side along X; each heads for its own corner, 50m above start altitude
+	double spacing = 80.0;
 	double corner_offset = RESOLUTION * 0.5; // center of final cell inside bounds
 	double corner_x = (BORDER_X / 2.0) - corner_offset;
 	double corner_y = (BORDER_Y / 2.0) - corner_offset;
-	goalXYZ = {corner_x, corner_y, startXYZ[2] + 50.0};
-	goalRadius = 6.0;
-	// mark goal for visualization (approx 3x UAV size) and store radius
-	env.setGoal(goalXYZ, goalRadius);
-	env.environment_to_rust(RUST_UDP_PORT);
-	std::vector<std::array<double, 3>> path = pathfinder.plan(startXYZ, goalXYZ);
-	pathfollower = std::make_unique<Pathfollower>(swarm[0], env.getResolution());
-	pathfollower->setPath(path);
+	for (int n = 0; n < num_swarms; n++)
+	{
+		std::array<double, 3> home = {(n - (num_swarms - 1) / 2.0) * spacing, 0.0, 20.0};
+		std::array<double, 3> goal = {
+			(n % 2 == 0) ? corner_x : -corner_x,
+			(n % 4 < 2) ? corner_y : -corner_y,
+			home[2] + 50.0};
+		spawn_swarm(num_uavs, home, goal);
+	}
+	if (!config.headless)
+		print_swarm_status();
+
+	// Set Up Environment
+	env.generate_random_obstacles(config.obstacles, seed);
+	// generate_test_obstacles(); 					// for testing
+
+	// mark swarm 0's goal for visualization (approx 3x UAV size) and store radius
+	env.setGoal(swarms[0]->goalXYZ, swarms[0]->goalRadius);
+	if (!config.headless)
+	{
+		// full streams are formatted on the sender's thread, so they take the lock there;
+		// the first goes out from start_sim, once a partition rank has its command port
+		env_sender = std::make_unique<EnvironmentSender>(RUST_UDP_PORT, [this]()
+														 {
+															 std::lock_guard<std::mutex> lock(swarm_mutex);
+															 return env.streamAll(command_port); });
+	}
+
+	// initial paths for every leader, solved together (one after another when headless)
+	std::vector<std::vector<std::array<double, 3>>> paths;
+	if (config.headless)
+	{
+		for (auto &s : swarms)
+			paths.push_back(pathfinder.plan(s->leader().get_pos(), s->goalXYZ));
+	}
+	else
+	{
+		std::vector<PlanQuery> queries;
+		for (auto &s : swarms)
+			queries.push_back({s->leader().get_pos(), s->goalXYZ, pathfinder.getMode()});
+		for (auto &path : pathfinder.planBatch(queries))
+			paths.push_back(path.get());
+	}
+	for (size_t n = 0; n < swarms.size(); n++)
+	{
+		Swarm &s = *swarms[n];
+		s.pathfollower = std::make_unique<Pathfollower>(s.leader(), env.getResolution());
+		s.pathfollower->setTrajectory(Trajectory(paths[n], trajectory_limits, &env));
+	}
 };
 
 /**
@@ -153,190 +258,927 @@ void UAVSimulator::start_sim()
 	if (running)
 		return;
 
-	std::cout<< "UINTMAX = " << UINT_MAX <<std::endl;
-	std::cout<< "INTMAX = " << INT_MAX <<std::endl;
+	LOG_DEBUG("UINTMAX = %u", UINT_MAX);
+	LOG_DEBUG("INTMAX = %d", INT_MAX);
 
 	running = true;
+	start_planner();
+	if (env_sender)
+		env_sender->request_full();
+
+	// one worker per swarm (up to the core count), so a tick costs about one swarm's work
+	if (swarms.size() > 1 && !tick_pool)
+	{
+		int cores = std::max(1u, std::thread::hardware_concurrency());
+		tick_pool = std::make_unique<ThreadPool>(std::min<int>(swarms.size(), cores));
+	}
 
 	// start_turn_timer();
 
-	std::thread([this]()
+	physics_thread = std::thread([this]()
 				{
 		using namespace std::chrono;
 		const auto sleep_duration = milliseconds(int(1000 * UAVDT));    // 20 Hz Updates with .05 UAVDT
-		const int telemetry_port = 6000;
 
 		while (running) {
-			for (auto &uav : swarm) {
-				if (uav.get_id() == 0 && pathfollower && leader_autopilot.load()) // only drive leader when autopilot enabled
-					pathfollower->update_leader_velocity(UAVDT);
-
-				// // Apply obstacle repulsion to the leader so it diverts away from collisions
-				// if (uav.get_id() == 0) {
-				// 	auto obs = uav.calculate_obstacle_forces();
-				// 	double mag = std::sqrt(obs[0] * obs[0] + obs[1] * obs[1] + obs[2] * obs[2]);
-				// 	if (mag > 1e-6) {
-				// 		const double max_delta = 3.0;
-				// 		double scale = std::min(1.0, max_delta / mag);
-				// 		const double gain = 0.5;
-				// 		auto vel = uav.get_vel();
-				// 		uav.set_velocity(
-				// 			vel[0] + gain * obs[0] * scale,
-				// 			vel[1] + gain * obs[1] * scale,
-				// 			vel[2] + gain * obs[2] * scale
-				// 		);
-				// 	}
-				// }
-
-				uav.update_position(UAVDT); // UAVDT found in uav.h
-				uav.uav_to_telemetry_server(telemetry_port);
+			step();
+			std::this_thread::sleep_for(sleep_duration);
+		} });
+}
+
+/**
+ * step - advances every swarm by one physics tick
+ *
+ * The physics thread calls this at UAVDT intervals; a headless simulator is
+ * driven by calling it directly, as fast as the caller likes.
+ */
+void UAVSimulator::step()
+{
+	std::lock_guard<std::mutex> lock(swarm_mutex);
+	SwarmTuning tuning = current_tuning();
+
+	// a swarm_size from the UI's swarm settings resizes every swarm
+	if (tuning.swarm_size != tuning_swarm_size)
+	{
+		tuning_swarm_size = tuning.swarm_size;
+		for (auto &s : swarms)
+			apply_swarm_size(*s, tuning.swarm_size);
+	}
+
+	// swap in freshly planned paths before anyone steers this tick
+	for (auto &s : swarms)
+		apply_planned_path(*s);
+
+	// swarms only read the shared environment, so they step independently
+	if (tick_pool)
+	{
+		std::vector<std::future<void>> ticks;
+		ticks.reserve(swarms.size());
+		for (auto &s : swarms)
+		{
+			Swarm *sp = s.get();
+			ticks.push_back(tick_pool->submit([this, sp, &tuning]()
+											  { tick_swarm(*sp, tuning); }));
+		}
+		for (auto &t : ticks)
+			t.get();
+	}
+	else
+	{
+		for (auto &s : swarms)
+			tick_swarm(*s, tuning);
+	}
+
+	// trade boundary state and border crossers with the neighboring ranks
+	if (partition)
+		exchange_partition();
+
+	if (recorder)
+		record_tick(tuning);
+	tick_count.fetch_add(1, std::memory_order_relaxed);
+}
+
+/**
+ * tick_swarm - advances one swarm by a physics step and sends its telemetry
+ * @s: swarm to step
+ * @tuning: boids weights and limits for this tick
+ *
+ * Touches nothing outside the swarm except read-only environment queries,
+ * so separate swarms may tick on separate threads.
+ */
+void UAVSimulator::tick_swarm(Swarm &s, const SwarmTuning &tuning)
+{
+	const int telemetry_port = 6000;
+
+	for (auto &uav : s.uavs)
+	{
+		// newest setpoint from an external controller, if one came in since last tick
+		SetpointMailbox &box = s.setpoints[uav.get_slot()];
+		Setpoint sp;
+		if (box.take(sp))
+		{
+			bool was_manual = uav.is_manual();
+			uav.set_mode(sp.manual ? UAVControleMode::MANUAL : UAVControleMode::AUTONOMOUS);
+			if (sp.manual)
+				uav.set_velocity(sp.vel[0], sp.vel[1], sp.vel[2]);
+
+			// a leader handed back to its autopilot picks the mission up from where it is
+			else if (was_manual && uav.get_slot() == 0 && s.leader_autopilot.load() && !s.reached_goal)
+			{
+				auto pos = uav.get_pos();
+				double dx = s.goalXYZ[0] - pos[0], dy = s.goalXYZ[1] - pos[1], dz = s.goalXYZ[2] - pos[2];
+				double dist = std::sqrt(dx * dx + dy * dy + dz * dz);
+				const double resume_speed = 5.0; // the follower only steers a moving leader
+				if (dist > 1e-6)
+					uav.set_velocity(resume_speed * dx / dist, resume_speed * dy / dist, resume_speed * dz / dist);
+				request_plan(s, pos, s.goalXYZ, false);
 			}
+		}
+		else if (uav.is_manual() && box.idle_for(MANUAL_HOLD_TICKS))
+			uav.set_velocity(0.0, 0.0, 0.0); // controller went quiet: hover in place
+
+		if (uav.get_slot() == 0 && !uav.is_manual() && s.pathfollower && s.leader_autopilot.load()) // only drive leader when autopilot enabled
+			s.pathfollower->update_leader_velocity(UAVDT);
+
+		// // Apply obstacle repulsion to the leader so it diverts away from collisions
+		// if (uav.get_id() == 0) {
+		// 	auto obs = uav.calculate_obstacle_forces();
+		// 	double mag = std::sqrt(obs[0] * obs[0] + obs[1] * obs[1] + obs[2] * obs[2]);
+		// 	if (mag > 1e-6) {
+		// 		const double max_delta = 3.0;
+		// 		double scale = std::min(1.0, max_delta / mag);
+		// 		const double gain = 0.5;
+		// 		auto vel = uav.get_vel();
+		// 		uav.set_velocity(
+		// 			vel[0] + gain * obs[0] * scale,
+		// 			vel[1] + gain * obs[1] * scale,
+		// 			vel[2] + gain * obs[2] * scale
+		// 		);
+		// 	}
+		// }
+
+		uav.update_position(UAVDT); // UAVDT found in uav.h
+		if (!config.headless)
+			uav.uav_to_telemetry_server(telemetry_port);
+	}
 
-			// Centralized neighbors updater
-			// (to be used until working and then will be decentralized)
-			const int num_uav = swarm.size();
-			for (int i = 0; i < num_uav; i++) {
-				for (int j = 0; j < num_uav; j++) {
-					if (i != j) {
-						swarm[i].update_neighbor_status(
-							swarm[j].get_id(),
-							swarm[j].get_pos(),
-							swarm[j].get_vel()
-						);
-					}
-				}
-				if (i != 0)
-					swarm[i].apply_boids_forces();
+	// Centralized neighbors updater, within the swarm only
+	// (to be used until working and then will be decentralized)
+	const int num_uav = s.uavs.size();
+	for (int i = 0; i < num_uav; i++)
+	{
+		for (int j = 0; j < num_uav; j++)
+		{
+			if (i != j)
+			{
+				s.uavs[i].update_neighbor_status(
+					s.uavs[j].get_id(),
+					s.uavs[j].get_pos(),
+					s.uavs[j].get_vel());
 			}
+		}
+		if (s.uavs[i].get_slot() != 0 && !s.uavs[i].is_manual())
+			s.uavs[i].apply_boids_forces(tuning);
+	}
 
-			// if leader reaches the goal, stop and arrange followers around the beacon
-			if (!reached_goal && !swarm.empty()) {
-				auto leader_pos = swarm[0].get_pos();
-				double dx = leader_pos[0] - goalXYZ[0];
-				double dy = leader_pos[1] - goalXYZ[1];
-				double dz = leader_pos[2] - goalXYZ[2];
-				double dist = std::sqrt(dx * dx + dy * dy + dz * dz);
-				if (dist <= goalRadius) {
-					reached_goal = true;
-					leader_autopilot.store(false);
-					// park leader at its current location (inside beacon) and use it as the sphere center
-					swarm[0].set_position(leader_pos[0], leader_pos[1], leader_pos[2]);
-					swarm[0].set_velocity(0.0, 0.0, 0.0);
-
-					int followers = static_cast<int>(swarm.size()) - 1;
-					if (followers > 0) {
-						double ring_radius = goalRadius * 1.4;
-						for (int idx = 0; idx < followers; ++idx) {
-							double t = (idx + 0.5) / followers;
-							double phi = std::acos(1.0 - 2.0 * t);
-							double theta = M_PI * (1.0 + std::sqrt(5.0)) * idx;
-							double x = ring_radius * std::sin(phi) * std::cos(theta);
-							double y = ring_radius * std::sin(phi) * std::sin(theta);
-							double z = ring_radius * std::cos(phi);
-							int uav_idx = idx + 1;
-							if (uav_idx < num_uav) {
-								swarm[uav_idx].set_position(leader_pos[0] + x, leader_pos[1] + y, leader_pos[2] + z);
-								swarm[uav_idx].set_velocity(0.0, 0.0, 0.0);
-							}
-						}
-					}
+	// if leader reaches the goal, stop and arrange followers around the beacon
+	if (!s.reached_goal && s.has_leader() && !s.leader().is_manual())
+	{
+		UAV &leader = s.leader();
+		auto leader_pos = leader.get_pos();
+		double dx = leader_pos[0] - s.goalXYZ[0];
+		double dy = leader_pos[1] - s.goalXYZ[1];
+		double dz = leader_pos[2] - s.goalXYZ[2];
+		double dist = std::sqrt(dx * dx + dy * dy + dz * dz);
+		if (dist <= s.goalRadius)
+		{
+			s.reached_goal = true;
+			s.leader_autopilot.store(false);
+			// park leader at its current location (inside beacon) and use it as the sphere center
+			leader.set_position(leader_pos[0], leader_pos[1], leader_pos[2]);
+			leader.set_velocity(0.0, 0.0, 0.0);
+
+			int followers = num_uav - 1;
+			if (followers > 0)
+			{
+				double ring_radius = s.goalRadius * 1.4;
+				int idx = 0;
+				for (auto &uav : s.uavs)
+				{
+					if (&uav == &leader || uav.is_manual())
+						continue;
+					double t = (idx + 0.5) / followers;
+					double phi = std::acos(1.0 - 2.0 * t);
+					double theta = M_PI * (1.0 + std::sqrt(5.0)) * idx;
+					double x = ring_radius * std::sin(phi) * std::cos(theta);
+					double y = ring_radius * std::sin(phi) * std::sin(theta);
+					double z = ring_radius * std::cos(phi);
+					uav.set_position(leader_pos[0] + x, leader_pos[1] + y, leader_pos[2] + z);
+					uav.set_velocity(0.0, 0.0, 0.0);
+					idx++;
 				}
 			}
-			std::this_thread::sleep_for(sleep_duration);
-		} })
-		.detach();
+			LOG_INFO("Swarm %d reached its goal", s.id);
+		}
+	}
 }
 
 void UAVSimulator::stop_sim()
 {
 	running = false;
+	if (physics_thread.joinable())
+		physics_thread.join();
+	stop_planner();
 	stop_command_listener();
+	if (recorder)
+		recorder->close();
+	if (snapshot_write.valid())
+		snapshot_write.wait();
 }
 
 /**
- * change_formation - changes formation of swarm
- * @f: formation enum (1: LINE, 2: FLYING_VEE, 3: CIRCLE)
+ * enable_recorder - records every tick, command and tuning change from now on
+ * @path: log file, replaced if it exists
+ *
+ * Return: false if the log couldn't be created
+ */
+bool UAVSimulator::enable_recorder(const std::string &path)
+{
+	auto rec = std::make_unique<FlightRecorder>();
+	if (!rec->open(path, UAVDT))
+		return false;
+	std::lock_guard<std::mutex> lock(swarm_mutex);
+	recorder = std::move(rec);
+	recorded_tuning.reset();
+	return true;
+}
+
+/**
+ * record_tick - appends this tick's UAV states to the flight log; caller holds swarm_mutex
+ * @tuning: tuning in effect this tick
+ *
+ * States are written straight into the mapped log. A tuning change is logged
+ * first, at the tick it was first seen.
+ */
+void UAVSimulator::record_tick(const SwarmTuning &tuning)
+{
+	uint64_t tick = tick_count.load(std::memory_order_relaxed);
+
+	if (!recorded_tuning || !(*recorded_tuning == tuning))
+	{
+		recorder->record_tuning(tick, tuning);
+		recorded_tuning = tuning;
+	}
+
+	uint32_t count = 0;
+	for (auto &s : swarms)
+		count += s->uavs.size();
+
+	FlightTick header{};
+	header.wall_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+						 std::chrono::system_clock::now().time_since_epoch())
+						 .count();
+	header.count = count;
+
+	recorder->append(FLIGHT_TICK, tick, sizeof(header) + count * sizeof(FlightUAV), [&](char *out)
+					 {
+		memcpy(out, &header, sizeof(header));
+		FlightUAV *uavs = reinterpret_cast<FlightUAV *>(out + sizeof(header));
+		for (auto &s : swarms)
+		{
+			for (auto &uav : s->uavs)
+			{
+				uavs->id = uav.get_id();
+				uavs->manual = uav.is_manual();
+				for (int a = 0; a < 3; a++)
+				{
+					uavs->pos[a] = uav.get_pos()[a];
+					uavs->vel[a] = uav.get_vel()[a];
+				}
+				uavs++;
+			}
+		} });
+}
+
+/**
+ * capture_snapshot - copies the state a snapshot needs; caller holds swarm_mutex
+ * @snap: filled with this tick boundary's state
+ *
+ * Only copies: UAV fields go column by column into flat vectors, and the grid
+ * is shared with the previous capture unless it changed since. Packing and
+ * writing are left to write_snapshot on another thread.
+ */
+void UAVSimulator::capture_snapshot(SimSnapshot &snap)
+{
+	snap.tick = tick_count.load(std::memory_order_relaxed);
+	snap.nx = env.getNx();
+	snap.ny = env.getNy();
+	snap.nz = env.getNz();
+	snap.resolution = env.getResolution();
+	snap.tuning = current_tuning();
+
+	if (!snapshot_cells || snapshot_cells_version != env.getVersion())
+	{
+		snapshot_cells = std::make_shared<const std::vector<uint8_t>>(env.getOccupancy());
+		snapshot_cells_version = env.getVersion();
+	}
+	snap.occupancy = snapshot_cells;
+	snap.env_json = env.dumpMessage();
+
+	snap.swarms.resize(swarms.size());
+	for (size_t n = 0; n < swarms.size(); n++)
+	{
+		const Swarm &s = *swarms[n];
+		SwarmSnapshot &out = snap.swarms[n];
+		SnapshotSwarm &meta = out.meta;
+		meta = SnapshotSwarm{};
+		meta.id = s.id;
+		meta.slots = s.slots;
+		meta.form = s.form;
+		meta.flags = (s.leader_autopilot.load() ? (uint32_t)SNAPSHOT_AUTOPILOT : 0u) |
+					 (s.reached_goal ? (uint32_t)SNAPSHOT_REACHED_GOAL : 0u);
+		for (int a = 0; a < 3; a++)
+		{
+			meta.home[a] = s.home[a];
+			meta.goal[a] = s.goalXYZ[a];
+		}
+		meta.goal_radius = s.goalRadius;
+
+		size_t count = s.uavs.size();
+		meta.uav_count = count;
+		out.ids.resize(count);
+		out.modes.resize(count);
+		out.pos.resize(count);
+		out.vel.resize(count);
+		for (size_t i = 0; i < count; i++)
+		{
+			const UAV &uav = s.uavs[i];
+			out.ids[i] = uav.get_id();
+			out.modes[i] = (uint32_t)uav.get_mode();
+			out.pos[i] = uav.get_pos();
+			out.vel[i] = uav.get_vel();
+		}
+
+		out.points.clear();
+		if (s.pathfollower)
+		{
+			const Trajectory &trajectory = s.pathfollower->getTrajectory();
+			meta.flags |= SNAPSHOT_FOLLOWER;
+			meta.follower = s.pathfollower->getState();
+			meta.limits = trajectory.getLimits();
+			out.points = trajectory.getPoints();
+			meta.point_count = out.points.size();
+		}
+	}
+}
+
+/**
+ * save_snapshot - snapshots the simulator at the next tick boundary
+ * @path: file to write; the previous one stays until the new one is complete
+ *
+ * Blocks the tick only while the state is copied. The file is written in the
+ * background; a snapshot still being written finishes before the next starts.
+ */
+void UAVSimulator::save_snapshot(const std::string &path)
+{
+	std::lock_guard<std::mutex> hold(snapshot_mutex);
+	if (snapshot_write.valid())
+		snapshot_write.wait();
+
+	auto snap = std::make_shared<SimSnapshot>();
+	{
+		std::lock_guard<std::mutex> lock(swarm_mutex);
+		capture_snapshot(*snap);
+	}
+	snapshot_write = std::async(std::launch::async, [snap, path]()
+								{ return write_snapshot(*snap, path); });
+}
+
+/**
+ * restore_snapshot - replaces the simulator's state with a saved one
+ * @path: file written by save_snapshot
+ *
+ * Return: false if the file can't be read or doesn't fit this simulator
+ */
+bool UAVSimulator::restore_snapshot(const std::string &path)
+{
+	SimSnapshot snap;
+	if (!read_snapshot(path, snap))
+		return false;
+	if (!restore_snapshot(snap))
+		return false;
+	LOG_INFO("Restored %s: tick %llu, %zu swarms", path.c_str(), (unsigned long long)snap.tick, snap.swarms.size());
+	return true;
+}
+
+/**
+ * restore_snapshot - replaces the simulator's state with a captured one
+ * @snap: snapshot to start from; may seed any number of simulators
+ *
+ * Call before start_sim, and before enable_partition so a partitioned run keeps
+ * only its own slab of the restored swarms. UAVs under external control come
+ * back in manual mode and hover until their controller speaks again; plans in
+ * flight when the snapshot was taken are not carried over.
+ *
+ * Return: false (and nothing changed) if the simulator is running or the grid
+ *	doesn't match
+ */
+bool UAVSimulator::restore_snapshot(const SimSnapshot &snap)
+{
+	if (running)
+	{
+		LOG_WARN("Snapshot: can't restore into a running simulation");
+		return false;
+	}
+	if (snap.nx != env.getNx() || snap.ny != env.getNy() || snap.nz != env.getNz() ||
+		snap.resolution != env.getResolution() || snap.swarms.empty() || !snap.occupancy)
+	{
+		LOG_ERROR("Snapshot: grid %dx%dx%d at %g m doesn't match this simulator's %dx%dx%d at %g m", snap.nx, snap.ny,
+				  snap.nz, snap.resolution, env.getNx(), env.getNy(), env.getNz(), env.getResolution());
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(swarm_mutex);
+	if (!env.restore(*snap.occupancy, snap.env_json))
+	{
+		LOG_ERROR("Snapshot: environment could not be restored");
+		return false;
+	}
+	if (config.tuning)
+		config.tuning = snap.tuning;
+	else
+		set_swarm_tuning(snap.tuning);
+	tuning_swarm_size = snap.tuning.swarm_size;
+
+	swarms.clear();
+	for (const auto &saved : snap.swarms)
+	{
+		const SnapshotSwarm &meta = saved.meta;
+		auto s = std::make_unique<Swarm>();
+		s->id = meta.id;
+		s->slots = meta.slots;
+		s->home = {meta.home[0], meta.home[1], meta.home[2]};
+		s->goalXYZ = {meta.goal[0], meta.goal[1], meta.goal[2]};
+		s->goalRadius = meta.goal_radius;
+		s->reached_goal = meta.flags & SNAPSHOT_REACHED_GOAL;
+		s->leader_autopilot.store(meta.flags & SNAPSHOT_AUTOPILOT);
+		s->setpoints.reset(new SetpointMailbox[SWARM_ID_STRIDE]);
+		formation f = (meta.form == LINE || meta.form == CIRCLE) ? (formation)meta.form : FLYING_V;
+		apply_formation(*s, f);
+
+		s->uavs.reserve(saved.ids.size());
+		for (size_t i = 0; i < saved.ids.size(); i++)
+		{
+			UAV uav = make_uav(*s, saved.ids[i] % SWARM_ID_STRIDE, saved.pos[i], saved.vel[i]);
+			if (saved.modes[i] == (uint32_t)UAVControleMode::MANUAL)
+				uav.set_mode(UAVControleMode::MANUAL);
+			s->uavs.push_back(std::move(uav));
+		}
+
+		if ((meta.flags & SNAPSHOT_FOLLOWER) && s->has_leader())
+		{
+			s->pathfollower = std::make_unique<Pathfollower>(s->leader(), env.getResolution());
+			s->pathfollower->setTrajectory(Trajectory::fromPolyline(saved.points, meta.limits));
+			s->pathfollower->setState(meta.follower);
+		}
+		swarms.push_back(std::move(s));
+	}
+
+	tick_count.store(snap.tick, std::memory_order_relaxed);
+	recorded_tuning.reset();
+	if (env_sender && running)
+		env_sender->request_full();
+	return true;
+}
+
+/**
+ * start_planner - starts the background planner thread
+ */
+void UAVSimulator::start_planner()
+{
+	if (planner_running)
+		return;
+	planner_running = true;
+	planner_thread = std::thread(&UAVSimulator::planner_loop, this);
+}
+
+/**
+ * stop_planner - abandons any search in flight and joins the planner thread
+ */
+void UAVSimulator::stop_planner()
+{
+	{
+		std::lock_guard<std::mutex> lock(plan_mutex);
+		planner_running = false;
+		for (auto &s : swarms)
+			s->plan_cancel = true;
+	}
+	plan_cv.notify_all();
+	if (planner_thread.joinable())
+		planner_thread.join();
+}
+
+/**
+ * request_plan - queues a leader path for the planner thread
+ * @s: swarm whose leader gets the path
+ * @start: start in world space
+ * @goal: goal in world space
+ * @resume_goal: clear reached_goal once the path is applied
+ *
+ * Returns immediately. A request still waiting for the same swarm is replaced
+ * and that swarm's search in flight is cancelled, so only its newest request
+ * produces a path. Other swarms' requests are untouched. The leader keeps
+ * flying its current path until the new one is applied.
+ */
+void UAVSimulator::request_plan(Swarm &s, const std::array<double, 3> &start, const std::array<double, 3> &goal, bool resume_goal)
+{
+	{
+		std::lock_guard<std::mutex> lock(plan_mutex);
+		s.plan_request = PlanRequest{start, goal, resume_goal};
+		s.plan_cancel = true;
+	}
+	plan_cv.notify_one();
+}
+
+/**
+ * planner_loop - plans queued requests one at a time, off the listener and physics threads
+ *
+ * Swarms are served round robin, so one swarm replanning constantly cannot
+ * starve the others.
  */
-void UAVSimulator::change_formation(formation f)
+void UAVSimulator::planner_loop()
 {
-	int uav_nums = swarm.size();
+	while (true)
+	{
+		Swarm *s = nullptr;
+		PlanRequest req;
+		{
+			std::unique_lock<std::mutex> lock(plan_mutex);
+			auto next_pending = [this]() -> Swarm *
+			{
+				for (size_t n = 0; n < swarms.size(); n++)
+				{
+					size_t at = (plan_next + n) % swarms.size();
+					if (swarms[at]->plan_request)
+					{
+						plan_next = at + 1;
+						return swarms[at].get();
+					}
+				}
+				return nullptr;
+			};
+			plan_cv.wait(lock, [&]() { return !planner_running || (s = next_pending()) != nullptr; });
+			if (!planner_running)
+				return;
+			req = *s->plan_request;
+			s->plan_request.reset();
+			s->plan_cancel = false;
+		}
 
-	SwarmCoordinator &coords = swarm[0].get_SwarmCoord();
-	coords.calculate_formation_offsets(uav_nums, f);
+		auto path = pathfinder.plan(req.start, req.goal, pathfinder.getMode(), &s->plan_cancel);
+		if (s->plan_cancel)
+			continue;
+		if (path.empty())
+		{
+			path.push_back(req.start);
+			path.push_back(req.goal);
+		}
+		// round the corners here so the physics thread only swaps it in
+		Trajectory trajectory(path, trajectory_limits, &env);
 
-	// formation offsets stored in each uav
-	for (int i = 0; i < uav_nums; i++)
+		std::lock_guard<std::mutex> lock(plan_mutex);
+		if (s->plan_request || s->plan_cancel)	// superseded while searching
+			continue;
+		s->planned = req;
+		s->planned_trajectory = std::move(trajectory);
+		s->plan_ready = true;
+	}
+}
+
+/**
+ * apply_planned_path - hands a finished path to a swarm leader's Pathfollower
+ * @s: swarm to update
+ *
+ * Called by the physics thread at the top of a tick, so the path never
+ * changes while the follower is steering.
+ */
+void UAVSimulator::apply_planned_path(Swarm &s)
+{
+	if (!s.plan_ready.load())
+		return;
+
+	std::lock_guard<std::mutex> lock(plan_mutex);
+	if (!s.planned)
+		return;
+	if (!s.has_leader()) // leader moved to another rank while this was planned
 	{
-		SwarmCoordinator &uav_coord = swarm[i].get_SwarmCoord();
-		uav_coord = coords;
+		s.planned.reset();
+		s.planned_trajectory = Trajectory();
+		s.plan_ready = false;
+		return;
 	}
 
-	form = f; // (could reorder to have this queue off form changes)
+	if (!s.pathfollower)
+		s.pathfollower = std::make_unique<Pathfollower>(s.leader(), env.getResolution());
+	LOG_INFO("Planner: swarm %d leader path updated (%g m)", s.id, s.planned_trajectory.length());
+	s.pathfollower->setTrajectory(std::move(s.planned_trajectory));
+	if (s.planned->resume_goal)
+		s.reached_goal = false;
+
+	s.planned.reset();
+	s.planned_trajectory = Trajectory();
+	s.plan_ready = false;
+}
+
+/**
+ * change_formation - changes formation of a swarm
+ * @f: formation enum (1: LINE, 2: FLYING_VEE, 3: CIRCLE)
+ * @swarm_id: swarm to reshape
+ */
+void UAVSimulator::change_formation(formation f, int swarm_id)
+{
+	std::lock_guard<std::mutex> lock(swarm_mutex);
+	apply_formation(*swarms[swarm_id], f);
+}
+
+/**
+ * apply_formation - recomputes a swarm's formation table; caller holds swarm_mutex
+ * @s: swarm to reshape
+ * @f: formation enum (1: LINE, 2: FLYING_VEE, 3: CIRCLE)
+ */
+void UAVSimulator::apply_formation(Swarm &s, formation f)
+{
+	// every UAV reads its offset from this one table
+	s.coords.calculate_formation_offsets(s.slots, f);
+
+	s.form = f; // (could reorder to have this queue off form changes)
 
 	if (f == 1)
 	{
-		std::cout << "Formation changed to LINE." << std::endl;
+		LOG_INFO("Formation changed to LINE.");
 	}
 	else if (f == 2)
 	{
-		std::cout << "Formation changed to FLYING VEE." << std::endl;
+		LOG_INFO("Formation changed to FLYING VEE.");
 	}
 	else if (f == 3)
 	{
-		std::cout << "Formation changed to CIRCLE." << std::endl;
+		LOG_INFO("Formation changed to CIRCLE.");
+	}
+}
+
+/**
+ * retain_uavs - keeps the UAVs a predicate accepts, in order
+ * @uavs: UAV list to filter
+ * @keep: called once per UAV, returns false to drop it
+ *
+ * UAV holds an Environment reference and can't be assigned, so survivors are
+ * moved into a fresh vector instead of compacted in place.
+ */
+template <typename Keep>
+static void retain_uavs(std::vector<UAV> &uavs, Keep keep)
+{
+	std::vector<UAV> kept;
+	kept.reserve(uavs.size());
+	for (auto &uav : uavs)
+	{
+		if (keep(uav))
+			kept.push_back(std::move(uav));
 	}
+	uavs = std::move(kept);
+}
+
+/**
+ * resize_swarm - grows or shrinks a swarm while it flies
+ * @new_size: UAVs in the swarm, leader included
+ * @swarm_id: swarm to resize
+ */
+void UAVSimulator::resize_swarm(int new_size, int swarm_id)
+{
+	std::lock_guard<std::mutex> lock(swarm_mutex);
+	apply_swarm_size(*swarms[swarm_id], new_size);
 }
 
-void UAVSimulator::resize_swarm(int new_size)
+/**
+ * apply_swarm_size - adds or retires formation slots at the tail; caller holds swarm_mutex
+ * @s: swarm to resize
+ * @new_size: UAVs in the swarm, leader included
+ *
+ * UAVs that stay keep their state. New UAVs appear at their formation slot
+ * around the leader, matching its velocity, so the formation doesn't have to
+ * pull them in from elsewhere.
+ */
+void UAVSimulator::apply_swarm_size(Swarm &s, int new_size)
 {
-	if (new_size < 1)
-		new_size = 1;
+	new_size = std::clamp(new_size, 1, SWARM_ID_STRIDE);
+	int old_size = s.slots;
+	if (new_size == old_size)
+		return;
+	if (!s.has_leader())
+	{
+		LOG_WARN("Resize of swarm %d ignored: its leader is simulated by another rank", s.id);
+		return;
+	}
 
-	// Preserve leader state if available
-	double leader_x = 0.0;
-	double leader_y = 0.0;
-	double leader_z = 20.0;
-	double leader_vx = 0.0;
-	double leader_vy = 1.0;
-	double leader_vz = 0.0;
+	s.slots = new_size;
+	apply_formation(s, s.form);
 
-	if (!swarm.empty())
+	if (new_size < old_size)
 	{
-		std::size_t leader_idx = 0;
-		for (std::size_t i = 0; i < swarm.size(); ++i)
+		// retire the tail slots and drop them from everyone's neighbor list
+		int first_retired = s.id * SWARM_ID_STRIDE + new_size;
+		retain_uavs(s.uavs, [new_size](const UAV &uav)
+					{ return uav.get_slot() < new_size; });
+		for (auto &uav : s.uavs)
+			uav.remove_neighbors_in(first_retired, s.id * SWARM_ID_STRIDE + old_size);
+	}
+	else
+	{
+		UAV &leader = s.leader();
+		std::array<double, 3> leader_pos = leader.get_pos();
+		std::array<double, 3> leader_vel = leader.get_vel();
+
+		s.uavs.reserve(s.uavs.size() + (new_size - old_size));
+		for (int slot = old_size; slot < new_size; slot++)
 		{
-			if (swarm[i].get_id() == 0)
-			{
-				leader_idx = i;
-				break;
-			}
+			std::array<double, 3> offset = s.coords.rotate_offset_3d(s.coords.get_formation_offset(slot), leader_vel);
+			std::array<double, 3> pos = {leader_pos[0] + offset[0], leader_pos[1] + offset[1], leader_pos[2] + offset[2]};
+			// a setpoint left for an earlier UAV in this slot isn't meant for the new one
+			s.setpoints[slot].discard();
+			s.uavs.push_back(make_uav(s, slot, pos, leader_vel));
 		}
+	}
+
+	// the vector may have moved; keep following the same path with the same leader
+	rebind_leader(s);
+
+	LOG_INFO("Resized swarm %d to %d UAVs", s.id, new_size);
+}
+
+/**
+ * make_uav - builds a UAV for a formation slot of a swarm
+ * @s: swarm it joins
+ * @slot: formation slot, 0 for the leader
+ * @pos: start position
+ * @vel: start velocity
+ *
+ * Return: the UAV, sharing the swarm's formation table
+ */
+UAV UAVSimulator::make_uav(Swarm &s, int slot, const std::array<double, 3> &pos, const std::array<double, 3> &vel)
+{
+	int uav_id = s.id * SWARM_ID_STRIDE + slot;
+	UAV uav(uav_id, 8000 + uav_id, pos[0], pos[1], pos[2], env);
+	uav.set_velocity(vel[0], vel[1], vel[2]);
+	uav.set_SwarmCoord(s.coords);
+	return uav;
+}
+
+/**
+ * enable_partition - restricts this process to one slab of the world
+ * @config: this rank, the rank count and how to reach the other ranks
+ *
+ * Every rank builds the same swarms and obstacle field (same seed), then
+ * keeps only the UAVs that start in its own slab. Call before starting the
+ * command listener; rank r listens for commands on 6001 + r.
+ *
+ * Return: true on success, false if the partition socket could not be set up
+ */
+bool UAVSimulator::enable_partition(const PartitionConfig &config)
+{
+	std::lock_guard<std::mutex> lock(swarm_mutex);
 
-		leader_x = swarm[leader_idx].get_x();
-		leader_y = swarm[leader_idx].get_y();
-		leader_z = swarm[leader_idx].get_z();
-		leader_vx = swarm[leader_idx].get_velx();
-		leader_vy = swarm[leader_idx].get_vely();
-		leader_vz = swarm[leader_idx].get_velz();
+	double west = env.getOrigin()[0];
+	double east = west + env.getNx() * env.getResolution();
+	partition = std::make_unique<SpatialPartition>(config, west, east);
+	if (!partition->open())
+	{
+		partition.reset();
+		return false;
+	}
+
+	int kept = 0;
+	for (auto &sp : swarms)
+	{
+		Swarm &s = *sp;
+		retain_uavs(s.uavs, [&](const UAV &uav)
+					{ return partition->owner_of(uav.get_pos()) == config.rank; });
+		rebind_leader(s);
+		kept += s.uavs.size();
 	}
+	command_port += config.rank;
+
+	LOG_INFO("Partition: rank %d simulates %d UAVs", config.rank, kept);
+	return true;
+}
 
-	// rebuild the swarm around the leader
-	swarm.clear();
-	swarm.reserve(new_size);
+/**
+ * exchange_partition - hands off border crossers and trades halo state with neighbor ranks
+ *
+ * Runs on the physics thread after every swarm has ticked. Ghost states feed
+ * the same neighbor tables the local updater fills, so boids forces see UAVs
+ * across the edge as if they were local.
+ */
+void UAVSimulator::exchange_partition()
+{
+	int rank = partition->get_rank();
+	std::vector<int> halo;
 
-	for (int i = 0; i < new_size; ++i)
+	for (auto &sp : swarms)
 	{
-		int uav_port = 8000 + i;
-		// leader and followers start co-located; formation offsets will spread them out
-		UAV uav(i, uav_port, leader_x, leader_y, leader_z, env);
-		uav.set_velocity(leader_vx, leader_vy, leader_vz);
-		swarm.push_back(uav);
+		Swarm &s = *sp;
+
+		// UAVs that crossed out of our slab move to their new owner
+		retain_uavs(s.uavs, [&](const UAV &uav)
+					{
+			int to = partition->leaving_to(uav.get_pos());
+			if (to == rank)
+				return true;
+			partition->hand_off(to, make_record(s, uav));
+			return false; });
+
+		// UAVs near an edge are mirrored to the rank across it
+		for (const auto &uav : s.uavs)
+		{
+			partition->halo_ranks(uav.get_pos(), halo);
+			for (int r : halo)
+				partition->queue_ghost(r, make_record(s, uav));
+		}
 	}
+	partition->flush();
 
-	// Recompute formation offsets for the current formation so the new swarm starts in formation
-	change_formation(form);
+	partition->poll(
+		[this](const PartitionRecord &rec)
+		{
+			int swarm_id = rec.id / SWARM_ID_STRIDE;
+			if (swarm_id < 0 || swarm_id >= (int)swarms.size())
+				return;
+			std::array<double, 3> pos = {rec.pos[0], rec.pos[1], rec.pos[2]};
+			std::array<double, 3> vel = {rec.vel[0], rec.vel[1], rec.vel[2]};
+			for (auto &uav : swarms[swarm_id]->uavs)
+			{
+				if (uav.get_id() != rec.id)
+					uav.update_neighbor_status(rec.id, pos, vel);
+			}
+		},
+		[this](const PartitionRecord &rec)
+		{ adopt_uav(rec); });
 
-	std::cout << "Resized swarm to " << new_size << " UAVs" << std::endl;
+	for (auto &sp : swarms)
+	{
+		rebind_leader(*sp);
+		// remote neighbors that left the halo stop refreshing and age out
+		for (auto &uav : sp->uavs)
+			uav.remove_stale_neighbors();
+	}
+}
+
+/**
+ * make_record - packs a UAV for a ghost or handoff
+ * @s: the UAV's swarm
+ * @uav: UAV to pack
+ *
+ * Return: wire record; a leader also carries its swarm's mission state
+ */
+PartitionRecord UAVSimulator::make_record(const Swarm &s, const UAV &uav) const
+{
+	PartitionRecord rec{};
+	rec.id = uav.get_id();
+	for (int a = 0; a < 3; a++)
+	{
+		rec.pos[a] = uav.get_pos()[a];
+		rec.vel[a] = uav.get_vel()[a];
+		rec.goal[a] = s.goalXYZ[a];
+	}
+	if (uav.get_slot() == 0)
+	{
+		if (s.leader_autopilot.load())
+			rec.flags |= SpatialPartition::FLAG_AUTOPILOT;
+		if (s.reached_goal)
+			rec.flags |= SpatialPartition::FLAG_REACHED_GOAL;
+	}
+	return rec;
+}
+
+/**
+ * adopt_uav - takes ownership of a UAV handed over by another rank
+ * @rec: the UAV's state when it left
+ *
+ * A leader brings its swarm's goal and autopilot state along and replans from
+ * where it is, since the path it was following stayed with the old owner.
+ */
+void UAVSimulator::adopt_uav(const PartitionRecord &rec)
+{
+	int swarm_id = rec.id / SWARM_ID_STRIDE;
+	if (swarm_id < 0 || swarm_id >= (int)swarms.size())
+		return;
+	Swarm &s = *swarms[swarm_id];
+
+	UAV uav = make_uav(s, rec.id % SWARM_ID_STRIDE, {rec.pos[0], rec.pos[1], rec.pos[2]}, {rec.vel[0], rec.vel[1], rec.vel[2]});
+	s.uavs.push_back(uav);
+
+	if (uav.get_slot() == 0)
+	{
+		s.goalXYZ = {rec.goal[0], rec.goal[1], rec.goal[2]};
+		s.leader_autopilot.store(rec.flags & SpatialPartition::FLAG_AUTOPILOT);
+		s.reached_goal = rec.flags & SpatialPartition::FLAG_REACHED_GOAL;
+		if (s.leader_autopilot.load() && !s.reached_goal)
+			request_plan(s, uav.get_pos(), s.goalXYZ, false);
+		LOG_INFO("Partition: took over swarm %d leader", s.id);
+	}
+}
+
+/**
+ * rebind_leader - points a swarm's Pathfollower at its leader after the UAV list changed
+ * @s: swarm whose UAVs were added, removed or moved
+ */
+void UAVSimulator::rebind_leader(Swarm &s)
+{
+	if (!s.has_leader())
+		s.pathfollower.reset();
+	else if (!s.pathfollower)
+		s.pathfollower = std::make_unique<Pathfollower>(s.leader(), env.getResolution());
+	else
+		s.pathfollower->setLeader(s.leader());
 }
 
 void UAVSimulator::start_command_listener()
@@ -352,11 +1194,26 @@ void UAVSimulator::stop_command_listener()
 		command_listener_thread.join();
 }
 
+/**
+ * command_listener_loop - receives binary command batches and text commands
+ *
+ * Binary datagrams from a sender run only if their sequence number is newer
+ * than the last one taken from that sender, so a late or duplicated datagram
+ * can't undo a newer command. A jump back of COMMAND_SEQ_WINDOW or more, or
+ * a sender quiet for COMMAND_SENDER_TIMEOUT, is a restart and is taken.
+ */
 void UAVSimulator::command_listener_loop()
 {
 	int socketfd = socket(AF_INET6, SOCK_DGRAM, 0);
 	struct sockaddr_in6 addr;
-	char buffer[1024] = {0};
+	char buffer[COMMAND_DATAGRAM_MAX + 1];
+	SimCommand batch[COMMAND_MAX_BATCH];
+	struct SenderState
+	{
+		uint32_t seq;								// newest sequence number run
+		std::chrono::steady_clock::time_point heard;
+	};
+	std::unordered_map<std::string, SenderState> senders;	// exact address and port -> state
 
 	memset(&addr, 0, sizeof(addr));
 	addr.sin6_family = AF_INET6;
@@ -365,220 +1222,263 @@ void UAVSimulator::command_listener_loop()
 
 	if (bind(socketfd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
 	{
-		std::cout << "Failed to bind IPv6 command listener to port " << command_port << std::endl;
+		LOG_ERROR("Failed to bind IPv6 command listener to port %d", command_port);
+		close(socketfd);
 		return;
 	}
 
-	std::cout << "IPv6 command listener started on port " << command_port << std::endl;
+	LOG_INFO("IPv6 command listener started on port %d", command_port);
+
+	// wake up now and then to notice stop_command_listener()
+	struct timeval timeout = {0, 200000};
+	setsockopt(socketfd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
 
 	while (command_listener_running)
 	{
-		ssize_t received = recvfrom(socketfd, buffer, sizeof(buffer) - 1, 0, nullptr, nullptr);
+		struct sockaddr_in6 from;
+		socklen_t from_len = sizeof(from);
+		ssize_t received = recvfrom(socketfd, buffer, sizeof(buffer), 0, (struct sockaddr *)&from, &from_len);
 		if (received <= 0)
 		{
 			continue;
 		}
 
-		// convert bytes received to string for parsing
-		std::string command(buffer, received);
-
-		// temp debugging output
-		std::cout << "Received command: [" << command << "]" << std::endl;
+		if (!is_command_datagram(buffer, received))
+		{
+			// nix any trailing shit
+			while (received > 0 && strchr("\n\r \0", buffer[received - 1]))
+				received--;
+			LOG_INFO("Received command: [%.*s]", (int)received, buffer);
+			SimCommand cmd;
+			if (parse_text_command(buffer, received, cmd))
+				handle_command(cmd);
+			else
+				LOG_WARN("Unknown command: [%.*s]", (int)received, buffer);
+			continue;
+		}
 
-		// nix any trailing shit
-		while (!command.empty() &&
-			   (command.back() == '\n' ||
-				command.back() == '\r' ||
-				command.back() == ' ' ||
-				command.back() == '\0'))
+		uint32_t seq;
+		size_t count;
+		if (!parse_command_datagram(buffer, received, seq, batch, count))
 		{
-			command.pop_back();
+			LOG_WARN("Malformed command datagram (%zd bytes)", received);
+			continue;
 		}
 
-		if (command == "1" || command == "line")
-			change_formation(LINE);
-		else if (command == "2" || command == "vee")
-			change_formation(FLYING_V);
-		else if (command == "3" || command == "circle")
-			change_formation(CIRCLE);
-		else if (command.rfind("move_leader", 0) == 0)
+		// a sender is its exact address and port, so two clients never share a window
+		std::string sender(reinterpret_cast<const char *>(&from.sin6_addr), sizeof(from.sin6_addr));
+		sender.append(reinterpret_cast<const char *>(&from.sin6_port), sizeof(from.sin6_port));
+		auto now = std::chrono::steady_clock::now();
+		auto seen = senders.find(sender);
+		if (seen != senders.end() && now - seen->second.heard < COMMAND_SENDER_TIMEOUT)
+		{
+			// anything far behind is a restarted sender rather than a late datagram
+			uint32_t behind = seen->second.seq - seq;
+			if (behind < COMMAND_SEQ_WINDOW)
+			{
+				command_stale_count.fetch_add(1, std::memory_order_relaxed);
+				continue;
+			}
+		}
+		if (seen == senders.end() && senders.size() >= 256)
 		{
-			std::stringstream ss(command);
-			std::string tag;
-			std::string dir;
-			ss >> tag >> dir;
+			for (auto it = senders.begin(); it != senders.end();)
+				it = (now - it->second.heard >= COMMAND_SENDER_TIMEOUT) ? senders.erase(it) : std::next(it);
+		}
+		senders[sender] = SenderState{seq, now};
 
-			// manual commands disable autopilot until explicitly re-enabled
-			leader_autopilot.store(false);
+		for (size_t i = 0; i < count; i++)
+			handle_command(batch[i]);
+	}
+	close(socketfd);
+}
 
-			if (swarm.empty())
-				continue;
+/**
+ * handle_command - runs one decoded command, whichever form it arrived in
+ * @cmd: command; swarm and UAV ids are checked here
+ */
+void UAVSimulator::handle_command(const SimCommand &cmd)
+{
+	if (recorder)
+		recorder->record_command(tick_count.load(std::memory_order_relaxed), cmd);
+
+	// ops that reach into a swarm's UAVs keep the tick out: resizes and partition
+	// handoffs reallocate s.uavs under swarm_mutex. Formation and resize lock for
+	// themselves; setpoints go through the mailbox.
+	std::unique_lock<std::mutex> lock(swarm_mutex, std::defer_lock);
+	std::vector<std::string> env_changes;	// formatted under the lock, sent after it
+	switch (cmd.op)
+	{
+	case CommandOp::MOVE_LEADER:
+	case CommandOp::ALTITUDE_CHANGE:
+	case CommandOp::RTB:
+	case CommandOp::GOAL:				// goalXYZ and the environment's goal are read by the tick and snapshots
+	case CommandOp::FLIGHT_MODE:
+		lock.lock();
+		break;
+	default:
+		break;
+	}
 
-			// make leader's ID 0 instead of assuming UAV at index 0 is leader
-			auto find_leader_idx = [&]() {
-				size_t leader_idx = 0;
-				for (size_t i = 0; i < swarm.size(); i++) {
-					if (swarm[i].get_id() == 0) {
-						leader_idx = i;
-						break;
-					}
-				}
-				return leader_idx;
-			};
-			size_t leader_idx = find_leader_idx();
+	int swarm_id = (cmd.uav == COMMAND_ANY_UAV) ? cmd.swarm : cmd.uav / SWARM_ID_STRIDE;
+	if (cmd.uav < COMMAND_ANY_UAV || swarm_id < 0 || swarm_id >= (int)swarms.size())
+	{
+		LOG_WARN("Unknown swarm %d in command", swarm_id);
+		return;
+	}
+	Swarm &target = *swarms[swarm_id];
+	int slot = (cmd.uav == COMMAND_ANY_UAV) ? 0 : cmd.uav % SWARM_ID_STRIDE;
 
-			// read current leader velocity
-			double vx = swarm[leader_idx].get_velx();
-			double vy = swarm[leader_idx].get_vely();
-			double vz = swarm[leader_idx].get_velz();
+	switch (cmd.op)
+	{
+	case CommandOp::FORMATION:
+	{
+		int f = (int)cmd.args[0];
+		if (f == LINE || f == FLYING_V || f == CIRCLE)
+			change_formation((formation)f, swarm_id);
+		break;
+	}
 
-			// compute speed and heading
-			double speed = std::sqrt(vx * vx + vy * vy);
-			double heading = std::atan2(vy, vx);
+	case CommandOp::MOVE_LEADER:
+	{
+		// manual commands disable autopilot until explicitly re-enabled
+		target.leader_autopilot.store(false);
 
-			// modify speed and heading based on command
-			const double min_speed = 1e-3;
-			if (speed < min_speed)
-				heading = M_PI_2; // default heading if stationary
+		if (!target.has_leader())
+			break;
 
-			if (dir == "accelerate")
-			{
-				const double delta_speed = 1.0;
-				speed += delta_speed;
-			}
-			else if (dir == "decelerate")
-			{
-				const double delta_speed = 0.5;
-				speed = std::max(0.0, speed - delta_speed);
-			}
-			else if (dir == "left")
-			{
-				const double delta_angle = M_PI / 36; // 5 degrees
-				heading -= delta_angle;
-			}
-			else if (dir == "right")
-			{
-				const double delta_angle = M_PI / 36; // 5 degrees
-				heading += delta_angle;
-			}
+		UAV &leader = target.leader();
 
-			// compute new velocity components
-			vx = speed * std::cos(heading);
-			vy = speed * std::sin(heading);
+		// read current leader velocity
+		double vx = leader.get_velx();
+		double vy = leader.get_vely();
+		double vz = leader.get_velz();
 
-			// update leader velocity
-			swarm[leader_idx].set_velocity(vx, vy, vz);
-		}
+		// compute speed and heading
+		double speed = std::sqrt(vx * vx + vy * vy);
+		double heading = std::atan2(vy, vx);
+
+		// modify speed and heading based on command
+		const double min_speed = 1e-3;
+		if (speed < min_speed)
+			heading = M_PI_2; // default heading if stationary
 
-		// altitude change command
-		else if (command.rfind("altitude_change", 0) == 0)
+		LeaderMove dir = (LeaderMove)(int)cmd.args[0];
+		if (dir == LeaderMove::ACCELERATE)
 		{
-			std::stringstream ss(command);
-			std::string tag;
-			double delta = 0.0;
-			ss >> tag >> delta;
+			const double delta_speed = 1.0;
+			speed += delta_speed;
+		}
+		else if (dir == LeaderMove::DECELERATE)
+		{
+			const double delta_speed = 0.5;
+			speed = std::max(0.0, speed - delta_speed);
+		}
+		else if (dir == LeaderMove::LEFT)
+		{
+			const double delta_angle = M_PI / 36; // 5 degrees
+			heading -= delta_angle;
+		}
+		else if (dir == LeaderMove::RIGHT)
+		{
+			const double delta_angle = M_PI / 36; // 5 degrees
+			heading += delta_angle;
+		}
 
-			if (swarm.empty())
-				continue;
+		// compute new velocity components
+		vx = speed * std::cos(heading);
+		vy = speed * std::sin(heading);
 
-			size_t leader_idx = 0;
-			for (size_t i = 0; i < swarm.size(); i++)
-			{
-				if (swarm[i].get_id() == 0)
-				{
-					leader_idx = i;
-					break;
-				}
-			}
+		// update leader velocity
+		leader.set_velocity(vx, vy, vz);
+		break;
+	}
 
-			// update leader altitude smoothly by setting a gentle vertical velocity for a short duration
-			double z = swarm[leader_idx].get_z();
-			double target_z = z + delta;
-			double vz = (delta > 0 ? 1.0 : -1.0); // 1 m/s climb or descent
-			// clamp to not overshoot
-			double remaining = target_z - z;
-			if ((delta > 0 && vz > remaining) || (delta < 0 && vz < remaining))
-				vz = remaining;
-			swarm[leader_idx].set_velocity(swarm[leader_idx].get_velx(), swarm[leader_idx].get_vely(), vz);
-		}
+	// altitude change command
+	case CommandOp::ALTITUDE_CHANGE:
+	{
+		if (!target.has_leader())
+			break;
+
+		UAV &leader = target.leader();
+		double delta = cmd.args[0];
+
+		// update leader altitude smoothly by setting a gentle vertical velocity for a short duration
+		double z = leader.get_z();
+		double target_z = z + delta;
+		double vz = (delta > 0 ? 1.0 : -1.0); // 1 m/s climb or descent
+		// clamp to not overshoot
+		double remaining = target_z - z;
+		if ((delta > 0 && vz > remaining) || (delta < 0 && vz < remaining))
+			vz = remaining;
+		leader.set_velocity(leader.get_velx(), leader.get_vely(), vz);
+		break;
+	}
 
-		// return-to-base command
-		else if (command == "rtb")
-		{
-			if (swarm.empty())
-				continue;
+	// return-to-base command
+	case CommandOp::RTB:
+		RTB(target);
+		break;
 
-			auto find_leader_idx = [&]() {
-				size_t leader_idx = 0;
-				for (size_t i = 0; i < swarm.size(); i++) {
-					if (swarm[i].get_id() == 0) {
-						leader_idx = i;
-						break;
-					}
-				}
-				return leader_idx;
-			};
-			size_t leader_idx = find_leader_idx();
-
-			// ensure autopilot is on so RTB path is followed
-			leader_autopilot.store(true);
-			std::array<double, 3> start = swarm[leader_idx].get_pos();
-			std::array<double, 3> base = {0.0, 0.0, 20.0};
-			auto path = pathfinder.plan(start, base);
-			if (path.empty()) {
-				path.push_back(start);
-				path.push_back(base);
-			}
-			if (!pathfollower) {
-				pathfollower = std::make_unique<Pathfollower>(swarm[leader_idx], env.getResolution());
-			}
-			pathfollower->setPath(path);
-			std::cout << "RTB: leader plotting path back to base" << std::endl;
-		}
+	// new mission goal for the swarm
+	case CommandOp::GOAL:
+	{
+		if (!target.has_leader())
+			break;
 
-		// toggle leader flight mode: "flight_mode autonomous|controlled"
-		else if (command.rfind("flight_mode", 0) == 0)
+		std::array<double, 3> goal = {cmd.args[0], cmd.args[1], cmd.args[2]};
+		target.goalXYZ = goal;
+		if (swarm_id == 0)
 		{
-			std::stringstream ss(command);
-			std::string tag;
-			std::string mode;
-			ss >> tag >> mode;
-
-			if (mode == "autonomous")
-			{
-				leader_autopilot.store(true);
-				// replan a path to the current goal when switching to autonomous
-				if (!swarm.empty())
-				{
-					auto find_leader_idx = [&]() {
-						size_t leader_idx = 0;
-						for (size_t i = 0; i < swarm.size(); i++) {
-							if (swarm[i].get_id() == 0) {
-								leader_idx = i;
-								break;
-							}
-						}
-						return leader_idx;
-					};
-					size_t leader_idx = find_leader_idx();
-					std::array<double, 3> start = swarm[leader_idx].get_pos();
-					auto path = pathfinder.plan(start, goalXYZ);
-					if (path.empty()) {
-						path.push_back(start);
-						path.push_back(goalXYZ);
-					}
-					if (!pathfollower) {
-						pathfollower = std::make_unique<Pathfollower>(swarm[leader_idx], env.getResolution());
-					}
-					pathfollower->setPath(path);
-					reached_goal = false;
-				}
-			}
-			else if (mode == "controlled")
-				leader_autopilot.store(false);
+			env.setGoal(goal, target.goalRadius);
+			env_changes = env.streamChanges(command_port);
 		}
+		target.leader_autopilot.store(true);
+		request_plan(target, target.leader().get_pos(), goal, true);
+		break;
+	}
 
-		// clear buffer for next recvfrom
-		memset(buffer, 0, sizeof(buffer));
+	// toggle leader flight mode
+	case CommandOp::FLIGHT_MODE:
+		if (cmd.args[0] != 0)
+		{
+			target.leader_autopilot.store(true);
+			// replan a path to the current goal when switching to autonomous
+			if (target.has_leader())
+				request_plan(target, target.leader().get_pos(), target.goalXYZ, true);
+		}
+		else
+			target.leader_autopilot.store(false);
+		break;
+
+	// external control of one UAV; the tick picks the setpoint up from the mailbox
+	case CommandOp::SET_VELOCITY:
+		target.setpoints[slot].post(Setpoint{1, {cmd.args[0], cmd.args[1], cmd.args[2]}});
+		break;
+
+	case CommandOp::RELEASE:
+		target.setpoints[slot].post(Setpoint{0, {0.0, 0.0, 0.0}});
+		break;
+
+	case CommandOp::RESIZE:
+		resize_swarm((int)cmd.args[0], swarm_id);
+		break;
+
+	// a telemetry receiver that missed part of the environment stream asks for all of it;
+	// the sender merges repeated asks and formats the stream under the lock itself
+	case CommandOp::ENVIRONMENT:
+		if (env_sender)
+			env_sender->request_full();
+		break;
+
+	default:
+		LOG_WARN("Unknown command op %d", (int)cmd.op);
+		break;
 	}
+
+	// sent with the tick running again, the send can wait on DNS and the network
+	if (lock.owns_lock())
+		lock.unlock();
+	if (env_sender)
+		env_sender->send(std::move(env_changes));
 }
@@ -12,12 +12,26 @@
 #include <algorithm>
 #include <memory>
 #include <climits>
+#include <condition_variable>
+#include <optional>
+#include <unordered_map>
+#include <string_view>
 #include "environment.h"
 #include "pathfinder.h"
 #include "pathfollower.h"
 #include "formation.h"
+#include "thread_pool.h"
+#include "partition.h"
+#include "command_codec.h"
+#include "setpoint_mailbox.h"
+#include "flight_recorder.h"
+#include "snapshot.h"
+#include "environment_sender.h"
+#include <future>
 
 constexpr int RUST_UDP_PORT = 6000;
+constexpr uint32_t COMMAND_SEQ_WINDOW = 64;	// a datagram this far behind its sender is stale, further means a restart
+constexpr std::chrono::seconds COMMAND_SENDER_TIMEOUT{5};	// a sender quiet this long starts over at any seq
 
 class UAVTelemetryServer;
 class UAV; 
@@ -27,53 +41,146 @@ class UAV;
 #define BORDER_Z 750
 #define RESOLUTION 10
 
+// how a simulator is built; the defaults are the interactive run
+struct SimConfig
+{
+	int obstacles = 65;							// random obstacles in the field
+	bool headless = false;						// no UDP, no threads of its own: plans on the caller's thread, driven by step()
+	std::optional<SwarmTuning> tuning;			// fixed tuning for this simulator instead of the shared one the UI sets
+	PlannerMode planner = PlannerMode::LAZY_THETA;	// search every swarm plans with
+};
+
+// background planning: the newest request per swarm wins, results land at a tick boundary
+struct PlanRequest
+{
+	std::array<double, 3> start;
+	std::array<double, 3> goal;
+	bool resume_goal;							// clear reached_goal when the path is applied
+};
+
+// one independently commanded group: its own leader, formation, path follower and goal.
+// All swarms share the simulator's Environment and Pathfinder.
+struct Swarm
+{
+	int id = 0;
+	std::vector<UAV> uavs;						// UAV ids are id * SWARM_ID_STRIDE + formation slot
+	int slots = 0;								// formation size, counting UAVs owned by other ranks
+	formation form = FLYING_V;
+	SwarmCoordinator coords;					// formation table, shared by the swarm's UAVs
+	std::unique_ptr<SetpointMailbox[]> setpoints;	// one per formation slot, for UAVs under external control
+	std::unique_ptr<Pathfollower> pathfollower;
+	std::atomic<bool> leader_autopilot{true};	// start in autonomous mode
+	std::array<double, 3> home{};				// spawn point, used by rtb
+	std::array<double, 3> goalXYZ{};
+	double goalRadius = 6.0;
+	bool reached_goal = false;
+
+	// planner hand-off, guarded by UAVSimulator::plan_mutex
+	std::optional<PlanRequest> plan_request;	// waiting for the planner thread
+	std::atomic<bool> plan_cancel{false};		// abandons this swarm's search in flight
+	std::optional<PlanRequest> planned;			// finished request, trajectory below
+	Trajectory planned_trajectory;
+	std::atomic<bool> plan_ready{false};		// planned is set, checked each tick
+
+	bool has_leader() const;
+	UAV &leader();
+};
+
 class UAVSimulator {
 private:
-	std::vector<UAV> swarm;
-	std::mutex swarm_mutex;
+	std::vector<std::unique_ptr<Swarm>> swarms;	// pointers stay put, so followers keep their leader
+	std::mutex swarm_mutex;						// held by the tick and by anything adding or removing UAVs
 	std::atomic<bool> running{false};
-	formation form;
 	std::thread physics_thread;
 	std::thread command_listener_thread;
 	std::thread turn_timer_thread;
 	std::atomic<bool> command_listener_running{false};
 	int command_port = 6001;
+	int tuning_swarm_size;						// SwarmTuning::swarm_size last applied, physics thread only
+	std::atomic<uint64_t> command_stale_count{0};	// binary datagrams dropped as late or duplicated
+	SimConfig config;
 	Environment env;
 	Pathfinder pathfinder;
-	std::unique_ptr<Pathfollower> pathfollower;
-	std::atomic<bool> leader_autopilot{true}; // start in autonomous mode
-	std::array<double, 3> goalXYZ{};
-	double goalRadius = 6.0;
-	bool reached_goal = false;
+	std::unique_ptr<ThreadPool> tick_pool;		// steps swarms in parallel when there is more than one
+	std::unique_ptr<SpatialPartition> partition;	// set when this process owns only a slab of the world
+	std::unique_ptr<FlightRecorder> recorder;	// set when the run is being recorded
+	std::optional<SwarmTuning> recorded_tuning;	// last tuning written to the recorder
+	std::atomic<uint64_t> tick_count{0};		// physics ticks completed
+	std::mutex snapshot_mutex;					// one snapshot at a time
+	std::future<bool> snapshot_write;			// last snapshot, possibly still being written
+	std::shared_ptr<const std::vector<uint8_t>> snapshot_cells;	// grid copy reused while its version holds
+	uint64_t snapshot_cells_version = 0;
+
+	std::thread planner_thread;
+	std::atomic<bool> planner_running{false};
+	std::mutex plan_mutex;
+	std::condition_variable plan_cv;
+	size_t plan_next = 0;						// swarm the planner looks at first, for fairness
+	TrajectoryLimits trajectory_limits;
+	std::unique_ptr<EnvironmentSender> env_sender;	// unless headless; declared last so it stops before env goes away
 
 public:
-	UAVSimulator(int num_drones);
+	UAVSimulator(int num_drones, int num_swarms = 1, uint32_t seed = 0, const SimConfig &config_ = SimConfig());
 	~UAVSimulator();
 
 	// getter
-	std::vector<UAV> &get_swarm() { return swarm; }
-	formation get_formation() { return form; }
+	std::vector<UAV> &get_swarm(int swarm_id = 0) { return swarms[swarm_id]->uavs; }
+	int get_swarm_count() const { return swarms.size(); }
+	formation get_formation(int swarm_id = 0) { return swarms[swarm_id]->form; }
+	uint64_t get_command_stale_count() const { return command_stale_count.load(std::memory_order_relaxed); }
+	uint64_t get_tick_count() const { return tick_count.load(std::memory_order_relaxed); }
+	bool get_reached_goal(int swarm_id = 0) const { return swarms[swarm_id]->reached_goal; }
+	std::array<double, 3> get_goal(int swarm_id = 0) const { return swarms[swarm_id]->goalXYZ; }
+	const Environment &get_environment() const { return env; }
 
 	// setters
-	void set_formation(formation f) { form = f; }
+	void set_formation(formation f, int swarm_id = 0) { swarms[swarm_id]->form = f; }
 
 	// methods
 	void start_sim();
 	void stop_sim();
+	void step();
 
 	void print_swarm_status(); /* for testing */
-	void change_formation(formation f);
+	void change_formation(formation f, int swarm_id = 0);
 
 	void start_command_listener();
 	void stop_command_listener();
+	void handle_command(const SimCommand &cmd);
 
-	void resize_swarm(int new_size);
+	void resize_swarm(int new_size, int swarm_id = 0);
+
+	bool enable_partition(const PartitionConfig &config);
+	bool enable_recorder(const std::string &path);
+
+	void save_snapshot(const std::string &path);
+	bool restore_snapshot(const std::string &path);
+	bool restore_snapshot(const SimSnapshot &snap);
 
 private:
 	void command_listener_loop();
 
-	void RTB();
+	void spawn_swarm(int num_drones, const std::array<double, 3> &home, const std::array<double, 3> &goal);
+	void apply_formation(Swarm &s, formation f);
+	void apply_swarm_size(Swarm &s, int new_size);
+	UAV make_uav(Swarm &s, int slot, const std::array<double, 3> &pos, const std::array<double, 3> &vel);
+	void tick_swarm(Swarm &s, const SwarmTuning &tuning);
+	SwarmTuning current_tuning() const { return config.tuning ? *config.tuning : get_swarm_tuning(); }
+	void exchange_partition();
+	void record_tick(const SwarmTuning &tuning);
+	void capture_snapshot(SimSnapshot &snap);
+	PartitionRecord make_record(const Swarm &s, const UAV &uav) const;
+	void adopt_uav(const PartitionRecord &rec);
+	void rebind_leader(Swarm &s);
+
+	void request_plan(Swarm &s, const std::array<double, 3> &start, const std::array<double, 3> &goal, bool resume_goal);
+	void start_planner();
+	void stop_planner();
+	void planner_loop();
+	void apply_planned_path(Swarm &s);
+
+	void RTB(Swarm &s);
 
 	void start_turn_timer(); 		// for testing
 	void generate_test_obstacles(); // for testing
-};
+};
\ No newline at end of file
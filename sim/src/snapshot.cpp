@@ -0,0 +1,248 @@
+#include "snapshot.h"
+#include "uav.h"
+#include "logger.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+namespace
+{
+	size_t padded(size_t bytes) { return (bytes + 7) & ~(size_t)7; }
+
+	// appends sections to a buffer sized up front
+	struct Writer
+	{
+		char *p;
+
+		void put(const void *src, size_t bytes)
+		{
+			memcpy(p, src, bytes);
+			p += padded(bytes);
+		}
+
+		template <typename T>
+		void put(const std::vector<T> &v) { put(v.data(), v.size() * sizeof(T)); }
+	};
+
+	// reads sections back, refusing to run past the end
+	struct Reader
+	{
+		const char *p;
+		const char *end;
+
+		size_t left() const { return end - p; }
+
+		// checked before padding, so a huge size can't wrap to a small one
+		bool fits(size_t bytes) const { return bytes <= left() && padded(bytes) <= left(); }
+
+		bool get(void *dst, size_t bytes)
+		{
+			if (!fits(bytes))
+				return false;
+			memcpy(dst, p, bytes);
+			p += padded(bytes);
+			return true;
+		}
+
+		// a corrupt count fails here instead of allocating whatever it claims
+		template <typename T>
+		bool get(std::vector<T> &v, size_t count)
+		{
+			if (count > left() / sizeof(T))
+				return false;
+			v.resize(count);
+			return get(v.data(), count * sizeof(T));
+		}
+	};
+
+	size_t packed_bytes(size_t cells) { return (cells + 7) / 8; }
+}
+
+/**
+ * write_snapshot - packs a captured snapshot and writes it to disk
+ * @snap: capture from the simulator
+ * @path: file to write; replaced only once the new one is complete
+ *
+ * Runs off the tick thread; a crash part way leaves the previous file intact.
+ *
+ * Return: false if the file couldn't be written
+ */
+bool write_snapshot(const SimSnapshot &snap, const std::string &path)
+{
+	const std::vector<uint8_t> &cells = *snap.occupancy;
+
+	size_t total = padded(sizeof(SnapshotHeader)) + padded(packed_bytes(cells.size())) + padded(snap.env_json.size());
+	for (const auto &s : snap.swarms)
+	{
+		size_t n = s.ids.size();
+		total += padded(sizeof(SnapshotSwarm)) + padded(n * sizeof(int32_t)) + padded(n * sizeof(uint32_t)) +
+				 2 * n * sizeof(std::array<double, 3>) + s.points.size() * sizeof(std::array<double, 3>);
+	}
+
+	std::vector<char> buf(total, 0);
+	Writer w{buf.data()};
+
+	SnapshotHeader header{};
+	memcpy(header.magic, SNAPSHOT_MAGIC, 4);
+	header.version = SNAPSHOT_VERSION;
+	header.tick = snap.tick;
+	header.nx = snap.nx;
+	header.ny = snap.ny;
+	header.nz = snap.nz;
+	header.swarm_count = snap.swarms.size();
+	header.resolution = snap.resolution;
+	header.env_json_bytes = snap.env_json.size();
+	header.tuning = snap.tuning;
+	w.put(&header, sizeof(header));
+
+	// one bit per cell; a blocked cell is any nonzero byte
+	unsigned char *bits = reinterpret_cast<unsigned char *>(w.p);
+	for (size_t c = 0; c < cells.size(); c++)
+		if (cells[c])
+			bits[c >> 3] |= 1u << (c & 7);
+	w.p += padded(packed_bytes(cells.size()));
+
+	w.put(snap.env_json.data(), snap.env_json.size());
+
+	for (const auto &s : snap.swarms)
+	{
+		w.put(&s.meta, sizeof(s.meta));
+		w.put(s.ids);
+		w.put(s.modes);
+		w.put(s.pos);
+		w.put(s.vel);
+		w.put(s.points);
+	}
+
+	std::string tmp = path + ".tmp";
+	int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
+	{
+		LOG_ERROR("Snapshot: can't create %s: %s", tmp.c_str(), strerror(errno));
+		return false;
+	}
+	const char *p = buf.data();
+	size_t left = buf.size();
+	while (left > 0)
+	{
+		ssize_t n = ::write(fd, p, left);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+		{
+			LOG_ERROR("Snapshot: writing %s failed: %s", tmp.c_str(), strerror(errno));
+			::close(fd);
+			unlink(tmp.c_str());
+			return false;
+		}
+		p += n;
+		left -= n;
+	}
+	bool ok = fdatasync(fd) == 0;
+	ok = ::close(fd) == 0 && ok;
+	if (!ok || rename(tmp.c_str(), path.c_str()) != 0)
+	{
+		LOG_ERROR("Snapshot: can't replace %s: %s", path.c_str(), strerror(errno));
+		unlink(tmp.c_str());
+		return false;
+	}
+
+	LOG_INFO("Snapshot of tick %llu written to %s (%zu bytes)", (unsigned long long)snap.tick, path.c_str(), buf.size());
+	return true;
+}
+
+/**
+ * read_snapshot - loads a snapshot file
+ * @path: file written by write_snapshot
+ * @snap: filled on success
+ *
+ * Return: false if the file is missing, truncated or not a snapshot
+ */
+bool read_snapshot(const std::string &path, SimSnapshot &snap)
+{
+	int fd = ::open(path.c_str(), O_RDONLY);
+	struct stat st;
+	if (fd < 0 || fstat(fd, &st) != 0 || st.st_size == 0)
+	{
+		LOG_ERROR("Snapshot: can't read %s", path.c_str());
+		if (fd >= 0)
+			::close(fd);
+		return false;
+	}
+	size_t length = st.st_size;
+	void *mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (mapped == MAP_FAILED)
+	{
+		LOG_ERROR("Snapshot: can't map %s: %s", path.c_str(), strerror(errno));
+		return false;
+	}
+	madvise(mapped, length, MADV_SEQUENTIAL);
+
+	const char *data = static_cast<const char *>(mapped);
+	Reader r{data, data + length};
+	bool ok = true;
+
+	SnapshotHeader header;
+	if (!r.get(&header, sizeof(header)) || memcmp(header.magic, SNAPSHOT_MAGIC, 4) != 0 ||
+		header.version != SNAPSHOT_VERSION || header.nx <= 0 || header.ny <= 0 || header.nz <= 0)
+		ok = false;
+
+	if (ok)
+	{
+		snap.tick = header.tick;
+		snap.nx = header.nx;
+		snap.ny = header.ny;
+		snap.nz = header.nz;
+		snap.resolution = header.resolution;
+		snap.tuning = header.tuning;
+
+		// nx * ny can't overflow from two ints; bound it before multiplying in nz
+		size_t plane = (size_t)header.nx * header.ny;
+		size_t cell_count = plane * header.nz;
+		if (plane > r.left() * 8 / header.nz || !r.fits(packed_bytes(cell_count)))
+			ok = false;
+		else
+		{
+			auto cells = std::make_shared<std::vector<uint8_t>>(cell_count);
+			const unsigned char *bits = reinterpret_cast<const unsigned char *>(r.p);
+			for (size_t c = 0; c < cell_count; c++)
+				(*cells)[c] = (bits[c >> 3] >> (c & 7)) & 1;
+			r.p += padded(packed_bytes(cell_count));
+			snap.occupancy = std::move(cells);
+		}
+	}
+
+	if (ok && !r.fits(header.env_json_bytes))
+		ok = false;
+	if (ok)
+	{
+		snap.env_json.assign(r.p, header.env_json_bytes);
+		r.p += padded(header.env_json_bytes);
+	}
+
+	snap.swarms.clear();
+	for (uint32_t n = 0; ok && n < header.swarm_count; n++)
+	{
+		SwarmSnapshot s;
+		ok = r.get(&s.meta, sizeof(s.meta)) && s.meta.id == (int32_t)n &&
+			 s.meta.uav_count <= SWARM_ID_STRIDE && s.meta.slots >= 1 && s.meta.slots <= SWARM_ID_STRIDE &&
+			 r.get(s.ids, s.meta.uav_count) && r.get(s.modes, s.meta.uav_count) &&
+			 r.get(s.pos, s.meta.uav_count) && r.get(s.vel, s.meta.uav_count) &&
+			 r.get(s.points, s.meta.point_count);
+
+		// every UAV has to belong to this swarm and one of its slots
+		for (size_t i = 0; ok && i < s.ids.size(); i++)
+			ok = s.ids[i] >= 0 && s.ids[i] / SWARM_ID_STRIDE == s.meta.id && s.ids[i] % SWARM_ID_STRIDE < s.meta.slots;
+		if (ok)
+			snap.swarms.push_back(std::move(s));
+	}
+
+	munmap(mapped, length);
+	if (!ok)
+		LOG_ERROR("Snapshot: %s is not a snapshot or is truncated", path.c_str());
+	return ok;
+}
@@ -0,0 +1,96 @@
+#pragma once
+#include "swarm_tuning.h"
+#include "trajectory.h"
+#include "pathfollower.h"
+#include <cstdint>
+#include <array>
+#include <memory>
+#include <string>
+#include <vector>
+#include <type_traits>
+
+/**
+ * Simulator snapshots
+ *
+ * Everything needed to pick a run up where it left off: every swarm's UAVs,
+ * formation, goal and path-following progress, the occupancy grid and the
+ * obstacle list, the swarm tuning and the tick count. Restoring one warm-starts
+ * a run; restoring the same one into several simulators forks what-if runs.
+ *
+ * Taking a snapshot costs the tick only a copy of that state into a
+ * SimSnapshot, one column per UAV field. Packing and writing the file happen
+ * on another thread. The occupancy grid is most of it and rarely changes, so
+ * successive snapshots share one copy until the grid's version moves.
+ *
+ * The file is a SnapshotHeader, the occupancy grid packed one bit per cell,
+ * the environment message JSON, then per swarm a SnapshotSwarm followed by
+ * its UAV columns (ids, modes, positions, velocities) and trajectory points.
+ * Sections are padded to 8 bytes. Everything is in host byte order, like the
+ * flight log.
+ */
+
+#define SNAPSHOT_MAGIC "SWSN"
+#define SNAPSHOT_VERSION 1
+
+enum SnapshotSwarmFlags : uint32_t
+{
+	SNAPSHOT_AUTOPILOT = 1,
+	SNAPSHOT_REACHED_GOAL = 2,
+	SNAPSHOT_FOLLOWER = 4,		// a Pathfollower state and trajectory follow
+};
+
+struct SnapshotHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint64_t tick;				// ticks completed when the snapshot was taken
+	int32_t nx, ny, nz;
+	uint32_t swarm_count;
+	double resolution;
+	uint64_t env_json_bytes;
+	SwarmTuning tuning;
+};
+
+struct SnapshotSwarm
+{
+	int32_t id;
+	int32_t slots;
+	int32_t form;
+	uint32_t flags;				// SnapshotSwarmFlags
+	double home[3];
+	double goal[3];
+	double goal_radius;
+	uint32_t uav_count;
+	uint32_t point_count;		// trajectory vertices
+	FollowerState follower;
+	TrajectoryLimits limits;
+};
+
+static_assert(std::is_trivially_copyable<SnapshotHeader>::value, "header is written as raw bytes");
+static_assert(std::is_trivially_copyable<SnapshotSwarm>::value, "swarm records are written as raw bytes");
+
+// one swarm, column by column
+struct SwarmSnapshot
+{
+	SnapshotSwarm meta{};
+	std::vector<int32_t> ids;
+	std::vector<uint32_t> modes;				// UAVControleMode
+	std::vector<std::array<double, 3>> pos;
+	std::vector<std::array<double, 3>> vel;
+	std::vector<std::array<double, 3>> points;	// follower trajectory
+};
+
+// a captured simulator, in memory
+struct SimSnapshot
+{
+	uint64_t tick = 0;
+	int nx = 0, ny = 0, nz = 0;
+	double resolution = 0.0;
+	SwarmTuning tuning{};
+	std::shared_ptr<const std::vector<uint8_t>> occupancy;	// shared between snapshots of the same grid version
+	std::string env_json;
+	std::vector<SwarmSnapshot> swarms;
+};
+
+bool write_snapshot(const SimSnapshot &snap, const std::string &path);
+bool read_snapshot(const std::string &path, SimSnapshot &snap);
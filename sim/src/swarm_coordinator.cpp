@@ -1,5 +1,6 @@
 #include "formation.h"
 #include "swarm_coordinator.h"
+#include "logger.h"
 
 void SwarmCoordinator::calculate_formation_offsets(int num_uavs, formation f)
 {
@@ -144,7 +145,7 @@ std::array<double, 3> SwarmCoordinator::get_formation_offset(int uav_id)
 {
 	if (uav_id >= formation_offsets.size())
 	{
-		std::cout << "Invalid UAV ID " << uav_id << ". size of formation_offsets: " << formation_offsets.size() << std::endl;
+		LOG_WARN("Invalid UAV ID %d. size of formation_offsets: %zu", uav_id, formation_offsets.size());
 		return {0, 0, 0};
 	}
 	return (formation_offsets[uav_id]);
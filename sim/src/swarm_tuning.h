@@ -8,6 +8,8 @@ struct SwarmTuning
 	double max_speed;
 	double target_altitude;
 	int swarm_size;
+
+	bool operator==(const SwarmTuning &) const = default;
 };
 
 SwarmTuning get_swarm_tuning();
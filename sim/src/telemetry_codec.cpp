@@ -0,0 +1,294 @@
+#include "telemetry_codec.h"
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <string_view>
+
+namespace
+{
+	// forward-only cursor over one datagram
+	struct Cursor
+	{
+		const char *p;
+		const char *end;
+
+		void skip_ws()
+		{
+			while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+				p++;
+		}
+
+		bool eat(char c)
+		{
+			skip_ws();
+			if (p < end && *p == c)
+			{
+				p++;
+				return true;
+			}
+			return false;
+		}
+
+		// raw string contents between the quotes, escapes left in place
+		bool string(std::string_view &out, bool &escaped)
+		{
+			if (!eat('"'))
+				return false;
+			const char *start = p;
+			escaped = false;
+			while (p < end && *p != '"')
+			{
+				if (*p == '\\')
+				{
+					escaped = true;
+					p++;
+				}
+				p++;
+			}
+			if (p >= end)
+				return false;
+			out = std::string_view(start, p - start);
+			p++;
+			return true;
+		}
+
+		bool number(double &out)
+		{
+			skip_ws();
+			// from_chars doesn't take a leading '+', which JSON doesn't allow either
+			auto [next, err] = std::from_chars(p, end, out);
+			if (err != std::errc())
+				return false;
+			p = next;
+			return true;
+		}
+
+		bool literal(const char *word)
+		{
+			size_t n = strlen(word);
+			if ((size_t)(end - p) < n || memcmp(p, word, n) != 0)
+				return false;
+			p += n;
+			return true;
+		}
+
+		// skips any value, nested or not
+		bool skip_value(int depth = 0)
+		{
+			skip_ws();
+			if (p >= end || depth > 32)
+				return false;
+			if (*p == '"')
+			{
+				std::string_view ignored;
+				bool escaped;
+				return string(ignored, escaped);
+			}
+			if (*p == '{' || *p == '[')
+			{
+				char close = (*p == '{') ? '}' : ']';
+				bool object = (*p == '{');
+				p++;
+				if (eat(close))
+					return true;
+				do
+				{
+					if (object)
+					{
+						std::string_view key;
+						bool escaped;
+						if (!string(key, escaped) || !eat(':'))
+							return false;
+					}
+					if (!skip_value(depth + 1))
+						return false;
+				} while (eat(','));
+				return eat(close);
+			}
+			if (literal("true") || literal("false") || literal("null"))
+				return true;
+			double ignored;
+			return number(ignored);
+		}
+
+		// {"<names[0]>": n, ...} into out[], other keys skipped
+		bool vector3(const char *const names[3], double out[3])
+		{
+			if (!eat('{'))
+				return false;
+			if (eat('}'))
+				return true;
+			do
+			{
+				std::string_view key;
+				bool escaped;
+				if (!string(key, escaped) || !eat(':'))
+					return false;
+				int axis = -1;
+				for (int a = 0; a < 3; a++)
+				{
+					if (key == names[a])
+						axis = a;
+				}
+				if (axis >= 0 ? !number(out[axis]) : !skip_value())
+					return false;
+			} while (eat(','));
+			return eat('}');
+		}
+	};
+
+	const char *const POSITION_KEYS[3] = {"x", "y", "z"};
+	const char *const VELOCITY_KEYS[3] = {"vx", "vy", "vz"};
+}
+
+/**
+ * parse_telemetry_frame - reads one UAV telemetry frame without building a DOM
+ * @json: datagram contents (need not be NUL terminated)
+ * @len: datagram length
+ * @out: filled on success; fields missing from the frame are zero
+ *
+ * Timestamps longer than the record holds, or containing escapes, are dropped
+ * rather than truncated. Anything carrying a "type" key is a control message,
+ * not a frame.
+ *
+ * Return: true for a well-formed frame with an integer id, false otherwise
+ */
+bool parse_telemetry_frame(const char *json, size_t len, TelemetryRecord &out)
+{
+	Cursor c{json, json + len};
+	bool have_id = false;
+
+	memset(&out, 0, sizeof(out));
+	if (!c.eat('{'))
+		return false;
+	if (c.eat('}'))
+		return false;
+	do
+	{
+		std::string_view key;
+		bool escaped;
+		if (!c.string(key, escaped) || !c.eat(':'))
+			return false;
+
+		if (key == "id")
+		{
+			c.skip_ws();
+			auto [next, err] = std::from_chars(c.p, c.end, out.id);
+			if (err != std::errc() || (next < c.end && (*next == '.' || *next == 'e' || *next == 'E')))
+				return false;
+			c.p = next;
+			have_id = true;
+		}
+		else if (key == "position")
+		{
+			if (!c.vector3(POSITION_KEYS, out.pos))
+				return false;
+		}
+		else if (key == "velocity")
+		{
+			if (!c.vector3(VELOCITY_KEYS, out.vel))
+				return false;
+		}
+		else if (key == "timestamp")
+		{
+			std::string_view stamp;
+			if (!c.string(stamp, escaped))
+				return false;
+			if (!escaped && stamp.size() <= sizeof(out.timestamp))
+			{
+				memcpy(out.timestamp, stamp.data(), stamp.size());
+				out.timestamp_len = stamp.size();
+			}
+		}
+		else if (key == "type")
+			return false;
+		else if (!c.skip_value())
+			return false;
+	} while (c.eat(','));
+
+	if (!c.eat('}'))
+		return false;
+	c.skip_ws();
+	while (c.p < c.end && *c.p == '\0') // datagrams padded with NULs
+		c.p++;
+	return have_id && c.p == c.end;
+}
+
+namespace
+{
+	// appends to a fixed buffer; once full, every later append is a no-op
+	struct Writer
+	{
+		char *p;
+		char *end;
+		bool ok = true;
+
+		void text(const char *s, size_t n)
+		{
+			if (!ok || (size_t)(end - p) < n)
+			{
+				ok = false;
+				return;
+			}
+			memcpy(p, s, n);
+			p += n;
+		}
+		void text(const char *s) { text(s, strlen(s)); }
+
+		void integer(int64_t v)
+		{
+			char tmp[24];
+			auto [next, err] = std::to_chars(tmp, tmp + sizeof(tmp), v);
+			text(tmp, next - tmp);
+		}
+
+		// shortest round-trip form, with ".0" on whole numbers and null for
+		// non-finite values, matching nlohmann::json::dump()
+		void real(double v)
+		{
+			if (!std::isfinite(v))
+			{
+				text("null");
+				return;
+			}
+			char tmp[32];
+			auto [next, err] = std::to_chars(tmp, tmp + sizeof(tmp), v);
+			text(tmp, next - tmp);
+			if (!memchr(tmp, '.', next - tmp) && !memchr(tmp, 'e', next - tmp))
+				text(".0");
+		}
+	};
+}
+
+/**
+ * format_telemetry_frame - writes a record as a JSON telemetry frame
+ * @rec: record to write
+ * @buf: output buffer
+ * @cap: buffer size
+ *
+ * Return: bytes written, or 0 if the frame didn't fit
+ */
+size_t format_telemetry_frame(const TelemetryRecord &rec, char *buf, size_t cap)
+{
+	Writer w{buf, buf + cap};
+
+	w.text("{\"id\":");
+	w.integer(rec.id);
+	w.text(",\"position\":{\"x\":");
+	w.real(rec.pos[0]);
+	w.text(",\"y\":");
+	w.real(rec.pos[1]);
+	w.text(",\"z\":");
+	w.real(rec.pos[2]);
+	w.text("},\"timestamp\":\"");
+	w.text(rec.timestamp, rec.timestamp_len);
+	w.text("\",\"velocity\":{\"vx\":");
+	w.real(rec.vel[0]);
+	w.text(",\"vy\":");
+	w.real(rec.vel[1]);
+	w.text(",\"vz\":");
+	w.real(rec.vel[2]);
+	w.text("}}");
+
+	return w.ok ? (size_t)(w.p - buf) : 0;
+}
@@ -0,0 +1,16 @@
+#pragma once
+#include "telemetry_table.h"
+#include <cstddef>
+
+/**
+ * Telemetry frames without a JSON DOM
+ *
+ * A frame looks like
+ *   {"id":3,"position":{"x":..,"y":..,"z":..},"timestamp":"..","velocity":{"vx":..,"vy":..,"vz":..}}
+ * in any key order. The parser reads it straight into a TelemetryRecord and
+ * skips keys it doesn't know; the formatter writes it back in the order
+ * nlohmann::json::dump() would.
+ */
+
+bool parse_telemetry_frame(const char *json, size_t len, TelemetryRecord &out);
+size_t format_telemetry_frame(const TelemetryRecord &rec, char *buf, size_t cap);
@@ -1,5 +1,11 @@
 #include "telemetry_server.h"
 #include "swarm_tuning.h"
+#include "telemetry_codec.h"
+#include "logger.h"
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif
 
 UAVTelemetryServer::~UAVTelemetryServer()
 {
@@ -16,9 +22,17 @@ UAVTelemetryServer::~UAVTelemetryServer()
  */
 int UAVTelemetryServer::start_server()
 {
+#ifdef __linux__
+	wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (wake_fd < 0)
+	{
+		LOG_ERROR("Failed to create shutdown eventfd in UAVTelemetryServer: %s", strerror(errno));
+		return (0);
+	}
+#endif
 	running = true;
-	std::cout << "Starting listening server on port " << listen_port << "." << std::endl;
-	std::cout << "Starting sender server on port " << target_port << "." << std::endl;
+	LOG_INFO("Starting listening server on port %d.", listen_port);
+	LOG_INFO("Starting sender server on port %d.", target_port);
 	server_thread = std::thread(&UAVTelemetryServer::listen_loop, this);
 	sender_thread = std::thread(&UAVTelemetryServer::sender_loop, this);
 
@@ -31,10 +45,21 @@ int UAVTelemetryServer::start_server()
 void UAVTelemetryServer::stop_server()
 {
 	running = false;
+	if (wake_fd > -1)
+	{
+		uint64_t one = 1;
+		if (write(wake_fd, &one, sizeof(one)) < 0)
+			LOG_WARN("Failed to wake listen loop in stop_server: %s", strerror(errno));
+	}
 	if (server_thread.joinable())
 		server_thread.join();
 	if (sender_thread.joinable())
 		sender_thread.join();
+	if (wake_fd > -1)
+	{
+		close(wake_fd);
+		wake_fd = -1;
+	}
 	if (socketfd > 0)
 	{
 		close(socketfd);
@@ -42,37 +67,188 @@ void UAVTelemetryServer::stop_server()
 	}
 }
 
+/**
+ * set_receive_buffer - sizes the kernel receive queue for the telemetry socket
+ * @bytes: requested size
+ *
+ * Return: size the kernel actually granted (Linux doubles the request and caps
+ * it at net.core.rmem_max), or -1 on failure
+ */
+int UAVTelemetryServer::set_receive_buffer(int bytes)
+{
+	if (bytes <= 0 || setsockopt(socketfd, SOL_SOCKET, SO_RCVBUF, &bytes, sizeof(bytes)) < 0)
+		return (-1);
+
+	int granted = 0;
+	socklen_t size = sizeof(granted);
+	if (getsockopt(socketfd, SOL_SOCKET, SO_RCVBUF, &granted, &size) < 0)
+		return (-1);
+	return (granted);
+}
+
+/**
+ * get_counters - snapshot of the ingest counters
+ *
+ * Return: counts since the server was created
+ */
+TelemetryCounters UAVTelemetryServer::get_counters() const
+{
+	return {
+		received_count.load(std::memory_order_relaxed),
+		dropped_count.load(std::memory_order_relaxed),
+		parse_error_count.load(std::memory_order_relaxed),
+		latest.get_dropped()};
+}
+
+#ifdef __linux__
+/**
+ * listen_loop - reads telemetry in recvmmsg batches whenever epoll reports data
+ *
+ * Sleeps in epoll_wait until the socket is readable or stop_server() signals
+ * the eventfd, then drains the socket RECV_BATCH datagrams per system call.
+ * SO_RXQ_OVFL tags each datagram with the kernel's running drop count.
+ */
 void UAVTelemetryServer::listen_loop()
 {
-	char buffer[BUFFER_SIZE] = {0};
-	struct sockaddr_in client_addr;
-	socklen_t client_size = sizeof(client_addr);
+	static_assert(RECV_BATCH <= 1024, "recvmmsg batch is capped by UIO_MAXIOV");
+	constexpr size_t CONTROL_SIZE = CMSG_SPACE(sizeof(uint32_t));
+
+	std::vector<char> buffers(RECV_BATCH * BUFFER_SIZE);
+	std::vector<char> controls(RECV_BATCH * CONTROL_SIZE);
+	struct mmsghdr msgs[RECV_BATCH];
+	struct iovec iovs[RECV_BATCH];
+	struct sockaddr_in addrs[RECV_BATCH];
 
-	memset(&client_addr, 0, client_size);
+	int overflow = 1;
+	if (setsockopt(socketfd, SOL_SOCKET, SO_RXQ_OVFL, &overflow, sizeof(overflow)) < 0)
+		LOG_WARN("SO_RXQ_OVFL unavailable; kernel drops will not be counted");
+
+	int epfd = epoll_create1(EPOLL_CLOEXEC);
+	if (epfd < 0)
+	{
+		LOG_ERROR("epoll_create1 failed in listen_loop: %s", strerror(errno));
+		return;
+	}
+	struct epoll_event ev;
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN;
+	ev.data.fd = socketfd;
+	int added = epoll_ctl(epfd, EPOLL_CTL_ADD, socketfd, &ev);
+	ev.data.fd = wake_fd;
+	if (added < 0 || epoll_ctl(epfd, EPOLL_CTL_ADD, wake_fd, &ev) < 0)
+	{
+		LOG_ERROR("epoll_ctl failed in listen_loop: %s", strerror(errno));
+		close(epfd);
+		return;
+	}
 
 	while (running)
 	{
-		memset(buffer, 0, BUFFER_SIZE);
+		struct epoll_event events[2];
+		int ready = epoll_wait(epfd, events, 2, -1);
+		if (ready < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			LOG_ERROR("epoll_wait failed in listen_loop: %s", strerror(errno));
+			break;
+		}
+
+		bool readable = false;
+		for (int e = 0; e < ready; e++)
+			readable |= (events[e].data.fd == socketfd);
+		if (!running || !readable)
+			continue;
+
+		// drain everything queued; a short batch means the queue is empty
+		int got = RECV_BATCH;
+		while (got == RECV_BATCH)
+		{
+			for (int i = 0; i < RECV_BATCH; i++)
+			{
+				iovs[i].iov_base = &buffers[i * BUFFER_SIZE];
+				iovs[i].iov_len = BUFFER_SIZE;
+				msgs[i].msg_hdr.msg_name = &addrs[i];
+				msgs[i].msg_hdr.msg_namelen = sizeof(addrs[i]);
+				msgs[i].msg_hdr.msg_iov = &iovs[i];
+				msgs[i].msg_hdr.msg_iovlen = 1;
+				msgs[i].msg_hdr.msg_control = &controls[i * CONTROL_SIZE];
+				msgs[i].msg_hdr.msg_controllen = CONTROL_SIZE;
+				msgs[i].msg_hdr.msg_flags = 0;
+			}
+
+			got = recvmmsg(socketfd, msgs, RECV_BATCH, MSG_DONTWAIT, nullptr);
+			if (got <= 0)
+				break;
+			received_count.fetch_add(got, std::memory_order_relaxed);
+
+			for (int i = 0; i < got; i++)
+			{
+				for (struct cmsghdr *cm = CMSG_FIRSTHDR(&msgs[i].msg_hdr); cm; cm = CMSG_NXTHDR(&msgs[i].msg_hdr, cm))
+				{
+					if (cm->cmsg_level == SOL_SOCKET && cm->cmsg_type == SO_RXQ_OVFL)
+					{
+						uint32_t drops;
+						memcpy(&drops, CMSG_DATA(cm), sizeof(drops));
+						dropped_count.store(drops, std::memory_order_relaxed);
+					}
+				}
+
+				if (msgs[i].msg_hdr.msg_flags & MSG_TRUNC)
+				{
+					parse_error_count.fetch_add(1, std::memory_order_relaxed);
+					continue;
+				}
+				update_json_pkg(&buffers[i * BUFFER_SIZE], msgs[i].msg_len, addrs[i]);
+			}
+		}
+	}
+
+	close(epfd);
+}
+#else
+/**
+ * listen_loop - reads telemetry one datagram at a time; the socket timeout lets it notice shutdown
+ */
+void UAVTelemetryServer::listen_loop()
+{
+	char buffer[BUFFER_SIZE];
+	struct sockaddr_in client_addr;
+
+	while (running)
+	{
+		socklen_t client_size = sizeof(client_addr);
 		ssize_t bytes_recvd = recvfrom(socketfd, buffer, BUFFER_SIZE, 0, (struct sockaddr *)&client_addr, &client_size);
 		if (bytes_recvd > 0)
-			update_json_pkg(buffer, client_addr);
+		{
+			received_count.fetch_add(1, std::memory_order_relaxed);
+			update_json_pkg(buffer, bytes_recvd, client_addr);
+		}
 	}
 }
+#endif
 
 /**
  * sender_loop - updates the Rust server every x ms
+ *
+ * Also logs the ingest counters every COUNTER_REPORT_MS.
  */
 void UAVTelemetryServer::sender_loop()
 {
 	int update_rate = 100; // 10 Hz, adjustable currently
+	auto next_report = std::chrono::steady_clock::now() + std::chrono::milliseconds(COUNTER_REPORT_MS);
 
 	while (running)
 	{
-		std::string json_pkg_as_string;
+		if (std::chrono::steady_clock::now() >= next_report)
+		{
+			TelemetryCounters c = get_counters();
+			LOG_INFO("Telemetry: %llu received, %llu dropped by the kernel, %llu parse errors, %llu refused with the table full",
+					 (unsigned long long)c.received, (unsigned long long)c.dropped,
+					 (unsigned long long)c.parse_errors, (unsigned long long)c.table_full);
+			next_report += std::chrono::milliseconds(COUNTER_REPORT_MS);
+		}
 
-		json_pkg_as_string = convert_json_pkg_to_string_of_array();
-		// std::cout << "JSON SENT TO RUST: " << json_pkg_as_string << std::endl;
-		// json_to_rust(json_pkg_as_string);
 		send_individual_frames_to_rust();
 
 		std::this_thread::sleep_for(std::chrono::milliseconds(update_rate));
@@ -81,47 +257,84 @@ void UAVTelemetryServer::sender_loop()
 
 /**
  * send_individual_frames - sends individual UAV Packets
+ *
+ * Frames are formatted straight from the latest-state table; the sender
+ * thread is the table's only reader.
  */
 void UAVTelemetryServer::send_individual_frames_to_rust()
 {
-	std::lock_guard<std::mutex> lock(telemetry_mutex);
-
-	for (const auto &[id, data] : json_pkg)
-	{
-		std::string individual_json = data.dump();
-		std::cout << "Individual Json to Rust: " << individual_json << std::endl;
-		json_to_rust(individual_json);
-	}
+	char frame[512];
+
+	latest.for_each([&](const TelemetryRecord &rec)
+					{
+		size_t len = format_telemetry_frame(rec, frame, sizeof(frame));
+		if (len == 0)
+			return;
+		LOG_DEBUG("Individual Json to Rust: %.*s", (int)len, frame);
+		bytes_to_rust(frame, len); });
 }
 
 /**
- * convert_json_pkg_to_string_of_array - converts json_pkg to a string from an array format
+ * convert_json_pkg_to_string_of_array - converts the latest frames to a JSON array string
  */
 std::string UAVTelemetryServer::convert_json_pkg_to_string_of_array()
 {
-	std::lock_guard<std::mutex> lock(telemetry_mutex);
-
-	nlohmann::json array = nlohmann::json::array();
-
-	for (const auto &[id, data] : json_pkg)
-		array.push_back(data);
+	char frame[512];
+	std::string array = "[";
+
+	latest.for_each([&](const TelemetryRecord &rec)
+					{
+		size_t len = format_telemetry_frame(rec, frame, sizeof(frame));
+		if (len == 0)
+			return;
+		if (array.size() > 1)
+			array += ',';
+		array.append(frame, len); });
+	array += ']';
+
+	return (array);
+}
 
-	return (array.dump());
+/**
+ * get_latest - copies out the latest record for every UAV seen so far
+ *
+ * Return: one record per UAV id
+ */
+std::vector<TelemetryRecord> UAVTelemetryServer::get_latest() const
+{
+	std::vector<TelemetryRecord> records;
+	latest.for_each([&](const TelemetryRecord &rec)
+					{ records.push_back(rec); });
+	return (records);
 }
+
 /**
- * update_json_pkg - constantly listens for incoming json from uavs
+ * update_json_pkg - stores an incoming UAV frame or applies a control message
+ * @json_str: datagram contents
+ * @len: datagram length
+ * @client: sender
+ *
+ * UAV frames are parsed straight into the latest-state table. Only messages
+ * the fast parser turns down (control messages, odd encodings) go through
+ * nlohmann::json. Called from the listen thread only: the table allows a
+ * single writer.
  */
-void UAVTelemetryServer::update_json_pkg(const char *json_str, const struct sockaddr_in &client)
+void UAVTelemetryServer::update_json_pkg(const char *json_str, size_t len, const struct sockaddr_in &client)
 {
 	nlohmann::json telemetry;
-	std::string id;
-	int id_int;
+	TelemetryRecord rec;
 
 	// std::cout << "JSON fm Telemetry Server: " << json_str <<std::endl;
 
+	if (parse_telemetry_frame(json_str, len, rec))
+	{
+		latest.store(rec);
+		return;
+	}
+
 	try
 	{
-		telemetry = nlohmann::json::parse(json_str);
+		telemetry = nlohmann::json::parse(json_str, json_str + len);
 
 		/* Handle control messages from Rust / bridge (e.g., swarm_settings) */
 		if (telemetry.contains("type") && telemetry["type"].is_string())
@@ -161,32 +374,34 @@ void UAVTelemetryServer::update_json_pkg(const char *json_str, const struct sock
 
 				set_swarm_tuning(tuning);
 
-				std::cout << "UAVTelemetryServer: updated SwarmTuning from swarm_settings: "
-						  << "cohesion=" << tuning.cohesion
-						  << " separation=" << tuning.separation
-						  << " alignment=" << tuning.alignment
-						  << " max_speed=" << tuning.max_speed
-						  << " target_altitude=" << tuning.target_altitude
-						  << std::endl;
+				LOG_INFO("UAVTelemetryServer: updated SwarmTuning from swarm_settings: "
+						 "cohesion=%g separation=%g alignment=%g max_speed=%g target_altitude=%g",
+						 tuning.cohesion, tuning.separation, tuning.alignment, tuning.max_speed, tuning.target_altitude);
 
 				/* Control message handled; no need to treat as telemetry */
 				return;
 			}
 		}
 
-		/* Default path: UAV telemetry frames with an id field */
-		if (telemetry.contains("id"))
+		/* Frames the fast parser turned down, e.g. a non-integer id */
+		if (telemetry.contains("id") && telemetry["id"].is_number())
 		{
-			id_int = telemetry["id"];
-			id = std::to_string(id_int);
-
-			std::lock_guard<std::mutex> lock(telemetry_mutex);
-			json_pkg[id] = telemetry;
+			memset(&rec, 0, sizeof(rec));
+			rec.id = telemetry["id"].get<int64_t>();
+			const char *axes[3] = {"x", "y", "z"};
+			const char *vaxes[3] = {"vx", "vy", "vz"};
+			for (int a = 0; a < 3; a++)
+			{
+				rec.pos[a] = telemetry.value("/position"_json_pointer / axes[a], 0.0);
+				rec.vel[a] = telemetry.value("/velocity"_json_pointer / vaxes[a], 0.0);
+			}
+			latest.store(rec);
 		}
 	}
 	catch (const std::exception &e)
 	{
-		std::cout << "Invalid JSON received in update_json_pkg in UAVTelemetryServer: " << e.what() << std::endl;
+		parse_error_count.fetch_add(1, std::memory_order_relaxed);
+		LOG_WARN("Invalid JSON received in update_json_pkg in UAVTelemetryServer: %s", e.what());
 	}
 }
 
@@ -195,25 +410,36 @@ void UAVTelemetryServer::update_json_pkg(const char *json_str, const struct sock
  * Return: 1 if successful, 0 if not
  */
 int UAVTelemetryServer::json_to_rust(std::string json)
+{
+	return (bytes_to_rust(json.data(), json.length()));
+}
+
+/**
+ * bytes_to_rust - sends an already serialized JSON message to the rust server
+ * @data: message bytes
+ * @len: message length
+ * Return: 1 if successful, 0 if not
+ */
+int UAVTelemetryServer::bytes_to_rust(const char *data, size_t len)
 {
 	int socketfd;
 	ssize_t sendto_return = 0, json_size;
 	struct sockaddr_in addr;
 
-	if (json.length() < 3)
+	if (len < 3)
 		return (0); // empty packet
 
-	std::cout << "DEBUG: json_to_rust called with string length: " << json.length() << std::endl;
-	std::cout << "DEBUG: JSON content: '" << json << "'" << std::endl;
+	LOG_DEBUG("json_to_rust called with string length: %zu", len);
+	LOG_DEBUG("JSON content: '%.*s'", (int)len, data);
 
 	socketfd = socket(AF_INET, SOCK_DGRAM, 0);
 	if (socketfd < 0)
 	{
-		std::cout << "DEBUG: failed to create UDP socket in json_to_rust" << std::endl;
+		LOG_WARN("failed to create UDP socket in json_to_rust");
 		return 0;
 	}
 
-	json_size = json.length();
+	json_size = len;
 
 	const char *host_env = std::getenv("SKYWEAVE_UDP_HOST");
 	const char *host = host_env ? host_env : "127.0.0.1";
@@ -232,7 +458,7 @@ int UAVTelemetryServer::json_to_rust(std::string json)
 	int gai_err = getaddrinfo(host, nullptr, &hints, &res);
 	if (gai_err != 0 || res == nullptr)
 	{
-		std::cout << "DEBUG: getaddrinfo failed for host " << host << ": " << gai_strerror(gai_err) << std::endl;
+		LOG_WARN("getaddrinfo failed for host %s: %s", host, gai_strerror(gai_err));
 		close(socketfd);
 		return 0;
 	}
@@ -242,17 +468,17 @@ int UAVTelemetryServer::json_to_rust(std::string json)
 	freeaddrinfo(res);
 
 	// send to Rust UDP listener
-	sendto_return = sendto(socketfd, json.c_str(), json_size, 0, (struct sockaddr *)&addr, sizeof(addr));
-	std::cout << "DEBUG: sendto returned " << sendto_return << " bytes" << std::endl;
+	sendto_return = sendto(socketfd, data, json_size, 0, (struct sockaddr *)&addr, sizeof(addr));
+	LOG_DEBUG("sendto returned %zd bytes", sendto_return);
 	if (sendto_return == -1)
 	{
-		std::cout << "DEBUG: sendto in json_to_rust returned -1" << std::endl;
+		LOG_WARN("sendto in json_to_rust returned -1: %s", strerror(errno));
 		close(socketfd);
 		return 0;
 	}
 	if (sendto_return != json_size)
 	{
-		std::cout << "DEBUG: sendto in json_to_rust sent size mismatch" << std::endl;
+		LOG_WARN("sendto in json_to_rust sent size mismatch");
 		close(socketfd);
 		return 0;
 	}
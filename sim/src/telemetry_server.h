@@ -1,5 +1,6 @@
 #pragma once
 #include "simulator.h"
+#include "telemetry_table.h"
 #include <nlohmann/json.hpp>
 #include <sys/socket.h>
 #include <netinet/in.h>
@@ -14,24 +15,40 @@
 #include <unordered_map>
 #include <sys/types.h>
 #include <sys/time.h>
+#include <atomic>
 
 #define BUFFER_SIZE 2048
+#define TELEMETRY_CAPACITY 4096 // distinct UAV ids the server tracks
+#define RECV_BATCH 64			 // datagrams read per recvmmsg call
+#define COUNTER_REPORT_MS 10000 // how often the sender loop logs the ingest counters
+
+// ingest counters, for spotting an overloaded server
+struct TelemetryCounters
+{
+	uint64_t received;		// datagrams read from the socket
+	uint64_t dropped;		// datagrams the kernel discarded with the receive buffer full (Linux only)
+	uint64_t parse_errors;	// truncated datagrams and ones that were neither a frame nor a control message
+	uint64_t table_full;	// frames refused because TELEMETRY_CAPACITY ids were already tracked
+};
 
 class UAVTelemetryServer {
 private:
 	int listen_port; // current portx
 	int target_port; // of Rust server if needed
 	int socketfd;    // file descriptor for open socket
-	bool running;
-	std::unordered_map<std::string, nlohmann::json> json_pkg;
+	int wake_fd;     // eventfd that wakes the listen loop for shutdown (Linux only)
+	std::atomic<bool> running;
+	TelemetryTable latest{TELEMETRY_CAPACITY};	// written by the listen thread, read by the sender thread
 	std::thread server_thread;
 	std::thread sender_thread;
-	std::mutex telemetry_mutex;
+	std::atomic<uint64_t> received_count{0};
+	std::atomic<uint64_t> dropped_count{0};
+	std::atomic<uint64_t> parse_error_count{0};
 
 public:
 	// constructor
 	UAVTelemetryServer(int lp = -1, int tp = 6000) :
-	listen_port(lp), target_port(tp), socketfd(-1), running(false) {
+	listen_port(lp), target_port(tp), socketfd(-1), wake_fd(-1), running(false) {
 
 		struct sockaddr_in addr;
 		socklen_t addr_size = sizeof(addr);
@@ -61,7 +78,11 @@ public:
 			listen_port = ntohs(addr.sin_port);
 		}
 
-		// timeout protection to ensure telem_server can close
+		// the kernel queue absorbs bursts while the listen thread is busy
+		if (const char *rcvbuf = std::getenv("SKYWEAVE_TELEMETRY_RCVBUF"))
+			set_receive_buffer(std::atoi(rcvbuf));
+
+		// timeout protection to ensure telem_server can close (only the non-Linux loop relies on it)
 		struct timeval timeout;
 		timeout.tv_sec = 0;
 		timeout.tv_usec = 100000; // 100ms timeout
@@ -78,18 +99,21 @@ public:
 	int get_port() { return listen_port; }
 	int get_target_port() { return target_port; }
 	int get_socketfd() { return socketfd; }
-	std::unordered_map<std::string, nlohmann::json> get_json_pkg() {return json_pkg; }
+	std::vector<TelemetryRecord> get_latest() const;
+	TelemetryCounters get_counters() const;
 
 	// setter
 	void set_port(int p) { listen_port = p; }
 	void set_target_port(int p) { target_port = p; }
+	int set_receive_buffer(int bytes);
 	// void set_socketfd(int fd) { socketfd = fd; } // not sure if desired
-	void update_json_pkg(const char *json_str, const struct sockaddr_in& client);
+	void update_json_pkg(const char *json_str, size_t len, const struct sockaddr_in& client);
 
 	// communications
 	int start_server();
 	void stop_server();
 	int json_to_rust(std::string json);
+	int bytes_to_rust(const char *data, size_t len);
 	int json_from_rust();
 
 private:
@@ -0,0 +1,165 @@
+#pragma once
+#include <atomic>
+#include <array>
+#include <memory>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// latest state of one UAV as the telemetry server stores and forwards it
+struct TelemetryRecord
+{
+	int64_t id;
+	double pos[3];
+	double vel[3];
+	uint64_t timestamp_len;
+	char timestamp[32]; // raw JSON string contents, not NUL terminated
+};
+
+/**
+ * TelemetryTable - fixed-capacity latest-state table keyed by UAV id
+ *
+ * One writer thread stores records while one reader thread walks the table;
+ * neither takes a lock. Each slot is a seqlock: the writer makes the sequence
+ * odd, copies the record in, then makes it even again, and the reader retries
+ * if the sequence moved under it. Slots are claimed by open addressing and
+ * never released, so a key, once published, stays in its slot.
+ */
+class TelemetryTable
+{
+private:
+	static constexpr int64_t EMPTY = INT64_MIN;
+	static constexpr size_t WORDS = sizeof(TelemetryRecord) / sizeof(uint64_t);
+	static_assert(sizeof(TelemetryRecord) % sizeof(uint64_t) == 0, "record must pack into whole words");
+	static_assert(std::is_trivially_copyable<TelemetryRecord>::value, "record is copied word by word");
+
+	struct Slot
+	{
+		std::atomic<int64_t> key{EMPTY};
+		std::atomic<uint32_t> seq{0};
+		std::array<std::atomic<uint64_t>, WORDS> words{};
+	};
+
+	std::unique_ptr<Slot[]> slots;
+	size_t mask;
+	size_t used = 0;				// writer only
+	std::atomic<uint64_t> dropped{0};	// stores refused because the table was full
+
+public:
+	// constructor: capacity is rounded up to a power of two
+	explicit TelemetryTable(size_t capacity)
+	{
+		size_t cap = 1;
+		while (cap < capacity)
+			cap <<= 1;
+		slots.reset(new Slot[cap]);
+		mask = cap - 1;
+	}
+
+	// getters
+	size_t capacity() const { return mask + 1; }
+	uint64_t get_dropped() const { return dropped.load(std::memory_order_relaxed); }
+
+	// methods
+	bool store(const TelemetryRecord &rec);
+	bool load(size_t slot, TelemetryRecord &out) const;
+	template <typename Visitor>
+	void for_each(Visitor visit) const;
+
+private:
+	size_t home(int64_t id) const { return ((uint64_t)id * 0x9E3779B97F4A7C15ull >> 17) & mask; }
+};
+
+/**
+ * store - replaces the record for rec.id, claiming a slot on first sight (writer thread only)
+ * @rec: latest state
+ *
+ * Return: false if the id is new and the table is full
+ */
+inline bool TelemetryTable::store(const TelemetryRecord &rec)
+{
+	size_t at = home(rec.id);
+	bool fresh = false;
+	for (size_t probe = 0;; probe++, at = (at + 1) & mask)
+	{
+		int64_t key = slots[at].key.load(std::memory_order_relaxed);
+		if (key == rec.id)
+			break;
+		if (key == EMPTY)
+		{
+			// keep one slot free so probing for a missing id always terminates
+			if (used + 1 >= capacity())
+			{
+				dropped.fetch_add(1, std::memory_order_relaxed);
+				return false;
+			}
+			fresh = true;
+			break;
+		}
+	}
+
+	Slot &slot = slots[at];
+	uint64_t words[WORDS];
+	memcpy(words, &rec, sizeof(rec));
+
+	uint32_t seq = slot.seq.load(std::memory_order_relaxed);
+	slot.seq.store(seq + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	for (size_t w = 0; w < WORDS; w++)
+		slot.words[w].store(words[w], std::memory_order_relaxed);
+	slot.seq.store(seq + 2, std::memory_order_release);
+
+	// publish the key only once the slot holds a whole record
+	if (fresh)
+	{
+		used++;
+		slot.key.store(rec.id, std::memory_order_release);
+	}
+	return true;
+}
+
+/**
+ * load - copies one slot's record (reader thread)
+ * @slot: slot index below capacity()
+ * @out: filled on success
+ *
+ * Return: false if the slot is empty or kept changing while being read
+ */
+inline bool TelemetryTable::load(size_t slot, TelemetryRecord &out) const
+{
+	const Slot &s = slots[slot];
+	if (s.key.load(std::memory_order_acquire) == EMPTY)
+		return false;
+
+	uint64_t words[WORDS];
+	for (int attempt = 0; attempt < 64; attempt++)
+	{
+		uint32_t before = s.seq.load(std::memory_order_acquire);
+		if (before & 1)
+			continue; // write in progress
+		for (size_t w = 0; w < WORDS; w++)
+			words[w] = s.words[w].load(std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (s.seq.load(std::memory_order_relaxed) == before)
+		{
+			memcpy(&out, words, sizeof(out));
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * for_each - visits a consistent copy of every stored record (reader thread)
+ * @visit: called with const TelemetryRecord &
+ */
+template <typename Visitor>
+void TelemetryTable::for_each(Visitor visit) const
+{
+	TelemetryRecord rec;
+	for (size_t at = 0; at <= mask; at++)
+	{
+		if (load(at, rec))
+			visit(rec);
+	}
+}
@@ -0,0 +1,66 @@
+#include "thread_pool.h"
+
+static thread_local int tl_worker_index = -1;
+
+/**
+ * ThreadPool - starts the workers
+ * @num_threads: number of workers, 0 for one per hardware thread
+ */
+ThreadPool::ThreadPool(int num_threads)
+{
+	if (num_threads <= 0)
+		num_threads = std::max(1u, std::thread::hardware_concurrency());
+
+	workers.reserve(num_threads);
+	for (int i = 0; i < num_threads; i++)
+		workers.emplace_back(&ThreadPool::worker_loop, this, i);
+}
+
+/**
+ * ~ThreadPool - finishes queued tasks and joins the workers
+ */
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(queue_mutex);
+		stopping = true;
+	}
+	queue_cv.notify_all();
+	for (auto &worker : workers)
+		if (worker.joinable())
+			worker.join();
+}
+
+/**
+ * current_worker - index of the pool worker running the caller
+ *
+ * Return: worker index, or -1 when called outside a pool worker
+ */
+int ThreadPool::current_worker()
+{
+	return tl_worker_index;
+}
+
+/**
+ * worker_loop - pops and runs tasks until the pool stops and the queue drains
+ * @index: this worker's index
+ */
+void ThreadPool::worker_loop(int index)
+{
+	tl_worker_index = index;
+
+	while (true)
+	{
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(queue_mutex);
+			queue_cv.wait(lock, [this]()
+						  { return stopping || !tasks.empty(); });
+			if (stopping && tasks.empty())
+				return;
+			task = std::move(tasks.front());
+			tasks.pop_front();
+		}
+		task();
+	}
+}
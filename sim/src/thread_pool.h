@@ -0,0 +1,67 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+
+/**
+ * ThreadPool - fixed set of worker threads draining a shared task queue
+ *
+ * Tasks run on whichever worker frees up first. A task can ask which worker
+ * it is running on (current_worker) to index per-worker scratch state, so
+ * nothing allocated per worker has to be shared or locked.
+ */
+class ThreadPool {
+private:
+	std::vector<std::thread> workers;
+	std::deque<std::function<void()>> tasks;
+	std::mutex queue_mutex;
+	std::condition_variable queue_cv;
+	bool stopping = false;
+
+public:
+	// constructor
+	explicit ThreadPool(int num_threads = 0);
+
+	// destructor
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool &) = delete;
+	ThreadPool &operator=(const ThreadPool &) = delete;
+
+	// getters
+	int size() const { return workers.size(); }
+	static int current_worker();
+
+	// methods
+	template <typename F>
+	auto submit(F &&task) -> std::future<decltype(task())>;
+
+private:
+	void worker_loop(int index);
+};
+
+/**
+ * submit - queues a task for the workers
+ * @task: callable taking no arguments
+ *
+ * Return: future holding the task's result (or exception)
+ */
+template <typename F>
+auto ThreadPool::submit(F &&task) -> std::future<decltype(task())>
+{
+	using R = decltype(task());
+	auto packaged = std::make_shared<std::packaged_task<R()>>(std::forward<F>(task));
+	std::future<R> result = packaged->get_future();
+	{
+		std::lock_guard<std::mutex> lock(queue_mutex);
+		tasks.emplace_back([packaged]()
+						   { (*packaged)(); });
+	}
+	queue_cv.notify_one();
+	return result;
+}
@@ -0,0 +1,316 @@
+#include "trajectory.h"
+#include <algorithm>
+#include <limits>
+
+namespace {
+	const int BLEND_SAMPLES = 16;		// points per corner blend, also used for its collision check
+	const int BLEND_SHRINKS = 4;		// halvings tried before a corner is left sharp
+
+	inline std::array<double, 3> sub(const std::array<double, 3>& a, const std::array<double, 3>& b) {
+		return {a[0] - b[0], a[1] - b[1], a[2] - b[2]};
+	}
+	inline double norm(const std::array<double, 3>& a) {
+		return std::sqrt(a[0] * a[0] + a[1] * a[1] + a[2] * a[2]);
+	}
+	inline std::array<double, 3> lerp(const std::array<double, 3>& a, const std::array<double, 3>& b, double t) {
+		return {a[0] + t * (b[0] - a[0]), a[1] + t * (b[1] - a[1]), a[2] + t * (b[2] - a[2])};
+	}
+	inline std::array<double, 3> bezier(const std::array<double, 3>& p0, const std::array<double, 3>& p1,
+		const std::array<double, 3>& p2, double t) {
+		double u = 1.0 - t;
+		return {u * u * p0[0] + 2 * u * t * p1[0] + t * t * p2[0],
+				u * u * p0[1] + 2 * u * t * p1[1] + t * t * p2[1],
+				u * u * p0[2] + 2 * u * t * p1[2] + t * t * p2[2]};
+	}
+}
+
+/**
+ * Trajectory - smooths and tabulates a planned path
+ * @waypoints: planner corners in world space
+ * @limits_: curvature, climb and sampling limits
+ * @env: grid to collision-check corner blends against; corners stay sharp if null
+ */
+Trajectory::Trajectory(const std::vector<std::array<double, 3>>& waypoints, const TrajectoryLimits& limits_,
+	const Environment* env) : limits(limits_) {
+
+	// drop repeated points so every segment has a direction
+	std::vector<std::array<double, 3>> pts;
+	for (const auto& p : waypoints)
+		if (pts.empty() || norm(sub(p, pts.back())) > 1e-6)
+			pts.push_back(p);
+	if (pts.empty())
+		return;
+
+	points = blendCorners(pts, env);
+	computeArc();
+	computeSpeedCaps();
+}
+
+/**
+ * fromPolyline - rebuilds a trajectory from the vertices of an already blended one
+ * @points_: vertices, as returned by getPoints
+ * @limits_: limits the trajectory was built with
+ *
+ * Corners are not blended again, so a saved trajectory comes back vertex for vertex.
+ *
+ * Return: the trajectory
+ */
+Trajectory Trajectory::fromPolyline(std::vector<std::array<double, 3>> points_, const TrajectoryLimits& limits_) {
+	Trajectory t;
+	t.limits = limits_;
+	t.points = std::move(points_);
+	t.computeArc();
+	t.computeSpeedCaps();
+	return t;
+}
+
+/**
+ * blendCorners - replaces interior corners with curvature-limited Bezier blends
+ * @pts: corner points, no repeats
+ * @env: grid for the collision check, may be null
+ *
+ * A symmetric quadratic blend with legs d over a turn of angle theta peaks at
+ * curvature sin(theta/2) / (d cos^2(theta/2)), so d is sized from that and
+ * then clipped to half of each neighboring segment.
+ *
+ * Return: dense polyline through the blends
+ */
+std::vector<std::array<double, 3>> Trajectory::blendCorners(const std::vector<std::array<double, 3>>& pts,
+	const Environment* env) const {
+
+	std::vector<std::array<double, 3>> dense;
+	dense.push_back(pts.front());
+
+	for (size_t i = 1; i + 1 < pts.size(); i++) {
+		std::array<double, 3> in = sub(pts[i], pts[i - 1]);
+		std::array<double, 3> out = sub(pts[i + 1], pts[i]);
+		double lin = norm(in), lout = norm(out);
+		double cosTurn = (in[0] * out[0] + in[1] * out[1] + in[2] * out[2]) / (lin * lout);
+		double turn = std::acos(std::clamp(cosTurn, -1.0, 1.0));
+
+		double d = 0.0;
+		if (env && turn > 1e-3) {
+			double half = 0.5 * turn;
+			double c = std::cos(half);
+			double needed = (c > 1e-6) ? std::sin(half) / (limits.max_curvature * c * c)
+									   : std::numeric_limits<double>::infinity();
+			d = std::min({needed, 0.5 * lin, 0.5 * lout});
+		}
+
+		// shrink the blend until it clears the obstacles, or give up and keep the corner
+		std::array<double, 3> a, b;
+		bool clear = false;
+		for (int tries = 0; d > 1e-3 && tries <= BLEND_SHRINKS && !clear; tries++, d *= 0.5) {
+			a = lerp(pts[i], pts[i - 1], d / lin);
+			b = lerp(pts[i], pts[i + 1], d / lout);
+			clear = true;
+			std::array<double, 3> prev = a;
+			for (int k = 1; k <= BLEND_SAMPLES && clear; k++) {
+				std::array<double, 3> p = bezier(a, pts[i], b, double(k) / BLEND_SAMPLES);
+				clear = env->segmentClear(prev, p);
+				prev = p;
+			}
+		}
+
+		if (!clear) {
+			dense.push_back(pts[i]);
+			continue;
+		}
+		dense.push_back(a);
+		for (int k = 1; k <= BLEND_SAMPLES; k++)
+			dense.push_back(bezier(a, pts[i], b, double(k) / BLEND_SAMPLES));
+	}
+
+	dense.push_back(pts.back());
+	return dense;
+}
+
+/**
+ * computeArc - cumulative arc length at every vertex
+ */
+void Trajectory::computeArc() {
+	arc.assign(points.size(), 0.0);
+	for (size_t k = 1; k < points.size(); k++)
+		arc[k] = arc[k - 1] + norm(sub(points[k], points[k - 1]));
+}
+
+/**
+ * computeSpeedCaps - speed limit per vertex from turn rate and climb slope
+ */
+void Trajectory::computeSpeedCaps() {
+	size_t n = points.size();
+	speed_cap.assign(n, std::numeric_limits<double>::infinity());
+
+	for (size_t k = 0; k < n; k++) {
+		// climb: vertical speed = speed * dz/ds, steepest neighboring segment
+		for (size_t j : {k, k + 1}) {
+			if (j == 0 || j >= n)
+				continue;
+			std::array<double, 3> d = sub(points[j], points[j - 1]);
+			double ds = arc[j] - arc[j - 1];
+			if (ds > 1e-9 && std::fabs(d[2]) > 1e-9)
+				speed_cap[k] = std::min(speed_cap[k], limits.max_climb_rate * ds / std::fabs(d[2]));
+		}
+
+		// turn: heading change over the shorter neighboring segment; a corner
+		// left sharp is taken as turned within corner_span
+		if (k > 0 && k + 1 < n) {
+			std::array<double, 3> u = sub(points[k], points[k - 1]);
+			std::array<double, 3> v = sub(points[k + 1], points[k]);
+			double lu = arc[k] - arc[k - 1], lv = arc[k + 1] - arc[k];
+			if (lu > 1e-9 && lv > 1e-9) {
+				double c = (u[0] * v[0] + u[1] * v[1] + u[2] * v[2]) / (lu * lv);
+				double span = std::min({lu, lv, limits.corner_span});
+				double kappa = std::acos(std::clamp(c, -1.0, 1.0)) / span;
+				if (kappa > 1e-6)
+					speed_cap[k] = std::min(speed_cap[k], std::sqrt(limits.max_lateral_accel / kappa));
+			}
+		}
+	}
+}
+
+/**
+ * segmentAt - index of the segment containing an arc length, by binary search
+ * @s: meters along the trajectory
+ *
+ * Return: k such that arc[k] <= s < arc[k + 1], clamped to the last segment
+ */
+size_t Trajectory::segmentAt(double s) const {
+	if (points.size() < 2)
+		return 0;
+	size_t k = std::upper_bound(arc.begin(), arc.end(), s) - arc.begin();
+	return std::min(k == 0 ? 0 : k - 1, points.size() - 2);
+}
+
+/**
+ * advance - moves a segment cursor forward to the segment containing s
+ * @s: meters along the trajectory
+ * @cursor: in/out segment index
+ *
+ * Steps forward one segment at a time, which is O(1) for the small moves
+ * between ticks; a backwards s falls back to a binary search.
+ */
+void Trajectory::advance(double s, size_t& cursor) const {
+	if (points.size() < 2) {
+		cursor = 0;
+		return;
+	}
+	if (cursor + 1 >= points.size() || s < arc[cursor]) {
+		cursor = segmentAt(s);
+		return;
+	}
+	while (cursor + 2 < points.size() && s >= arc[cursor + 1])
+		cursor++;
+}
+
+/**
+ * onSegment - point at arc length s on segment k
+ */
+std::array<double, 3> Trajectory::onSegment(size_t k, double s) const {
+	double span = arc[k + 1] - arc[k];
+	double t = (span > 1e-12) ? std::clamp((s - arc[k]) / span, 0.0, 1.0) : 0.0;
+	return lerp(points[k], points[k + 1], t);
+}
+
+/**
+ * sample - point at a given arc length
+ * @s: meters along the trajectory, clamped to [0, length]
+ *
+ * Return: interpolated position
+ */
+std::array<double, 3> Trajectory::sample(double s) const {
+	if (points.size() == 1)
+		return points.front();
+	return onSegment(segmentAt(s), s);
+}
+
+/**
+ * sample - point at a given arc length, reusing a forward-moving cursor
+ * @s: meters along the trajectory, clamped to [0, length]
+ * @cursor: in/out segment index from the previous call
+ *
+ * Return: interpolated position
+ */
+std::array<double, 3> Trajectory::sample(double s, size_t& cursor) const {
+	if (points.size() == 1)
+		return points.front();
+	advance(s, cursor);
+	return onSegment(cursor, s);
+}
+
+/**
+ * tangent - unit direction of travel at a given arc length
+ * @s: meters along the trajectory
+ *
+ * Return: unit vector, zero for a single-point trajectory
+ */
+std::array<double, 3> Trajectory::tangent(double s) const {
+	if (points.size() < 2)
+		return {0.0, 0.0, 0.0};
+	size_t k = segmentAt(s);
+	std::array<double, 3> d = sub(points[k + 1], points[k]);
+	double l = arc[k + 1] - arc[k];
+	return {d[0] / l, d[1] / l, d[2] / l};
+}
+
+/**
+ * speedLimit - allowed speed at a given arc length
+ * @s: meters along the trajectory
+ *
+ * A vertex's cap applies within corner_span of it on either side.
+ *
+ * Return: m/s, infinity where nothing limits it
+ */
+double Trajectory::speedLimit(double s) const {
+	if (points.size() < 2)
+		return std::numeric_limits<double>::infinity();
+	size_t k = segmentAt(s);
+	double cap = std::numeric_limits<double>::infinity();
+	if (s - arc[k] <= limits.corner_span)
+		cap = std::min(cap, speed_cap[k]);
+	if (arc[k + 1] - s <= limits.corner_span)
+		cap = std::min(cap, speed_cap[k + 1]);
+	return cap;
+}
+
+/**
+ * project - arc length of the closest point to p, searched forward from a cursor
+ * @p: point to project, usually the UAV position
+ * @from: arc length of the previous projection
+ * @cursor: in/out segment the previous projection fell on
+ * @window: meters past @from to search
+ *
+ * Projects exactly onto each segment in the window and keeps the closest.
+ * Searching forward only means a path that doubles back on itself cannot
+ * capture the UAV early.
+ *
+ * Return: arc length of the projection
+ */
+double Trajectory::project(const std::array<double, 3>& p, double from, size_t& cursor, double window) const {
+	if (points.size() < 2) {
+		cursor = 0;
+		return 0.0;
+	}
+	advance(from, cursor);
+
+	double limit = from + window;
+	double bestS = arc[cursor];
+	double bestD = std::numeric_limits<double>::infinity();
+	size_t bestK = cursor;
+	for (size_t k = cursor; k + 1 < points.size() && arc[k] <= limit; k++) {
+		std::array<double, 3> ab = sub(points[k + 1], points[k]);
+		std::array<double, 3> ap = sub(p, points[k]);
+		double len2 = ab[0] * ab[0] + ab[1] * ab[1] + ab[2] * ab[2];
+		double t = (len2 > 1e-12) ? std::clamp((ap[0] * ab[0] + ap[1] * ab[1] + ap[2] * ab[2]) / len2, 0.0, 1.0) : 0.0;
+		std::array<double, 3> q = lerp(points[k], points[k + 1], t);
+		std::array<double, 3> d = sub(q, p);
+		double dd = d[0] * d[0] + d[1] * d[1] + d[2] * d[2];
+		if (dd < bestD) {
+			bestD = dd;
+			bestS = arc[k] + t * (arc[k + 1] - arc[k]);
+			bestK = k;
+		}
+	}
+	cursor = bestK;
+	return bestS;
+}
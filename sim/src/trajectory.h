@@ -0,0 +1,69 @@
+#pragma once
+#include "environment.h"
+#include <vector>
+#include <array>
+#include <cmath>
+#include <cstddef>
+
+/**
+ * Trajectory Concepts
+ *
+ * Planner output is a polyline whose corners a UAV cannot actually fly. A
+ * Trajectory rounds every interior corner with a quadratic Bezier blend whose
+ * legs are long enough to keep curvature under max_curvature (when the
+ * neighboring segments leave room), shrinking the blend until its chords
+ * clear the occupancy grid.
+ *
+ * The result is stored as a polyline with the cumulative arc length of every
+ * vertex, so a point at distance s along the path is a binary search away,
+ * or an O(1) cursor advance when s only moves forward, as it does tick to
+ * tick. Straight legs stay a single segment however long they are.
+ *
+ * Each vertex also carries a speed limit: tight turns are capped by
+ * max_lateral_accel and steep climbs by max_climb_rate.
+ */
+
+struct TrajectoryLimits {
+	double max_curvature = 1.0 / 8.0;	// 1 / tightest turn radius (m)
+	double max_climb_rate = 3.0;		// m/s, up or down
+	double max_lateral_accel = 4.0;		// m/s^2 through turns
+	double corner_span = 1.0;			// m over which a sharp corner is assumed to be turned
+};
+
+class Trajectory {
+private:
+	TrajectoryLimits limits;
+	std::vector<std::array<double, 3>> points;	// polyline vertices
+	std::vector<double> arc;					// arc[k]: meters from points[0] to points[k]
+	std::vector<double> speed_cap;				// m/s allowed around points[k]
+
+public:
+	Trajectory() = default;
+	Trajectory(const std::vector<std::array<double, 3>>& waypoints, const TrajectoryLimits& limits_ = TrajectoryLimits(),
+		const Environment* env = nullptr);
+	static Trajectory fromPolyline(std::vector<std::array<double, 3>> points_, const TrajectoryLimits& limits_);
+
+	bool empty() const { return points.empty(); }
+	double length() const { return arc.empty() ? 0.0 : arc.back(); }
+	size_t pointCount() const { return points.size(); }
+	const std::array<double, 3>& pointAt(size_t k) const { return points[k]; }
+	const std::vector<std::array<double, 3>>& getPoints() const { return points; }
+	const TrajectoryLimits& getLimits() const { return limits; }
+
+	// cursor: index of the segment holding s; only ever moved forward by the calls below
+	size_t segmentAt(double s) const;
+	void advance(double s, size_t& cursor) const;
+
+	std::array<double, 3> sample(double s) const;
+	std::array<double, 3> sample(double s, size_t& cursor) const;
+	std::array<double, 3> tangent(double s) const;
+	double speedLimit(double s) const;
+	double project(const std::array<double, 3>& p, double from, size_t& cursor, double window) const;
+
+private:
+	std::vector<std::array<double, 3>> blendCorners(const std::vector<std::array<double, 3>>& pts,
+		const Environment* env) const;
+	void computeArc();
+	void computeSpeedCaps();
+	std::array<double, 3> onSegment(size_t k, double s) const;
+};
@@ -1,35 +1,42 @@
 #include "uav.h"
 #include "swarm_coordinator.h"
 #include "swarm_tuning.h"
+#include "logger.h"
 
 void UAV::update_position(double dt)
 {
 	// attempt axis-wise movement and stop when hitting blocked cells or bounds
 	std::array<double, 3> next = pos;
 
-	auto canOccupy = [this](const std::array<double, 3> &p)
+	// sweep each axis move through the grid so fast movers can't skip thin obstacles;
+	// cells the grid flags are settled against the exact shapes. Inside UAV_CLEARANCE
+	// of a surface a UAV may only move further out, so one caught there can escape
+	auto canMove = [this](const std::array<double, 3> &from, const std::array<double, 3> &to)
 	{
-		auto g = env.toGrid(p);
-		return env.inBounds(g[0], g[1], g[2]) && !env.isBlocked(g[0], g[1], g[2]);
+		const ObstacleStore &shapes = env.getObstacles();
+		if (!shapes.overlaps(to, UAV_CLEARANCE))
+			return env.segmentClear(from, to);
+		std::array<int, 3> end = env.toGrid(to);
+		return env.inBounds(end[0], end[1], end[2]) && shapes.distance(to) > shapes.distance(from);
 	};
 
 	// X move
 	std::array<double, 3> cand = {pos[0] + vel[0] * dt, pos[1], pos[2]};
-	if (canOccupy(cand))
+	if (canMove(next, cand))
 		next[0] = cand[0];
 	else
 		vel[0] = 0.0;
 
 	// Y move
 	cand = {next[0], pos[1] + vel[1] * dt, pos[2]};
-	if (canOccupy(cand))
+	if (canMove(next, cand))
 		next[1] = cand[1];
 	else
 		vel[1] = 0.0;
 
 	// Z move
 	cand = {next[0], next[1], pos[2] + vel[2] * dt};
-	if (canOccupy(cand))
+	if (canMove(next, cand))
 		next[2] = cand[2];
 	else
 		vel[2] = 0.0;
@@ -77,6 +84,22 @@ void UAV::remove_stale_neighbors()
 		neighbors_status.end());
 }
 
+/**
+ * remove_neighbors_in - forgets neighbors whose ids fall in a range
+ * @first_id: first id to drop
+ * @end_id: one past the last id to drop
+ */
+void UAV::remove_neighbors_in(int first_id, int end_id)
+{
+	neighbors_status.erase(
+		std::remove_if(neighbors_status.begin(), neighbors_status.end(),
+					   [first_id, end_id](const NeighborInfo &neighbor)
+					   {
+						   return neighbor.id >= first_id && neighbor.id < end_id;
+					   }),
+		neighbors_status.end());
+}
+
 std::vector<UAV::NeighborInfo> UAV::get_fresh_neighbors()
 {
 	std::chrono::milliseconds max_age = std::chrono::milliseconds(500);
@@ -109,7 +132,7 @@ void UAV::uav_telemetry_broadcast()
 		{"timestamp", timestamp}};
 	json_str = j.dump();
 
-	std::cout << "JSON to UAVs: " << json_str << "\n";
+	LOG_DEBUG("JSON to UAVs: %s", json_str.c_str());
 
 	// open a stream to a port
 	// send through stream
@@ -160,7 +183,7 @@ void UAV::uav_to_telemetry_server(int port = 6000)
 	int gai_err = getaddrinfo(host, nullptr, &hints, &res);
 	if (gai_err != 0 || res == nullptr)
 	{
-		std::cout << "DEBUG: getaddrinfo failed for host " << host << ": " << gai_strerror(gai_err) << std::endl;
+		LOG_WARN("getaddrinfo failed for host %s: %s", host, gai_strerror(gai_err));
 		close(socketfd);
 		return;
 	}
@@ -173,18 +196,59 @@ void UAV::uav_to_telemetry_server(int port = 6000)
 	sendto_return = sendto(socketfd, json_str.c_str(), json_size, 0, (struct sockaddr *)&addr, sizeof(addr));
 	if (sendto_return == -1)
 	{
-		std::cout << "DEBUG: sendto in uav_to_telemetry_server returned -1" << std::endl;
+		LOG_WARN("sendto in uav_to_telemetry_server returned -1");
 		close(socketfd);
 	}
 	if (sendto_return != json_size)
 	{
-		std::cout << "DEBUG: sendto in uav_to_telemetry_server sent size mismatch" << std::endl;
+		LOG_WARN("sendto in uav_to_telemetry_server sent size mismatch");
 		close(socketfd);
 	}
 
 	close(socketfd);
 }
 
+/**
+ * get_formation_target - where this UAV's formation slot is
+ * @leader_pos: leader position
+ * @leader_vel: leader velocity, the formation's heading (+Y when stationary)
+ *
+ * Return: slot position in world space, at the leader's altitude
+ */
+std::array<double, 3> UAV::get_formation_target(const std::array<double, 3> &leader_pos, std::array<double, 3> leader_vel) const
+{
+	// Normalize leader velocity to get a clean heading vector for rotation
+	double speed = std::sqrt(
+		leader_vel[0] * leader_vel[0] +
+		leader_vel[1] * leader_vel[1] +
+		leader_vel[2] * leader_vel[2]);
+
+	if (speed < 1e-6)
+	{
+		// If the leader is effectively stationary, assume a default heading along +Y
+		leader_vel = {0.0, 1.0, 0.0};
+	}
+	else
+	{
+		leader_vel[0] /= speed;
+		leader_vel[1] /= speed;
+		leader_vel[2] /= speed;
+	}
+
+	// Local formation offset for this UAV (defined by the formation type: LINE, VEE, CIRCLE)
+	std::array<double, 3> formation_offset = SwarmCoord->get_formation_offset(get_slot());
+
+	// Use SwarmCoordinator's 3D rotation helper to map local offsets into world space
+	std::array<double, 3> rotated_offset = SwarmCoord->rotate_offset_3d(formation_offset, leader_vel);
+
+	// Target location within formation in relation to leader's location.
+	// Keep Z at the leader's altitude so formations stay planar.
+	return {
+		leader_pos[0] + rotated_offset[0],
+		leader_pos[1] + rotated_offset[1],
+		leader_pos[2]};
+}
+
 /**
  * calculate_formation_force - calculates cohesion net force towards center of uav mass
  * Return: cohesion force
@@ -198,14 +262,14 @@ std::array<double, 3> UAV::calculate_formation_force()
 		return {0.0, 0.0, 0.0};
 	}
 
-	// Find the leader (id == 0) from neighbor info; fall back to the first neighbor if needed
+	// Find this swarm's leader (slot 0) from neighbor info; fall back to the first neighbor if needed
 	std::array<double, 3> leader_pos = neighbors[0].last_known_pos;
 	std::array<double, 3> leader_vel = neighbors[0].last_known_vel;
 	bool leader_found = false;
 
 	for (const auto &n : neighbors)
 	{
-		if (n.id == 0)
+		if (n.id == get_leader_id())
 		{
 			leader_pos = n.last_known_pos;
 			leader_vel = n.last_known_vel;
@@ -216,39 +280,10 @@ std::array<double, 3> UAV::calculate_formation_force()
 
 	if (!leader_found)
 	{
-		std::cout << "WARN: leader (id 0) not found in neighbors in calculate_formation_force()" << std::endl;
+		LOG_WARN("leader (id %d) not found in neighbors in calculate_formation_force()", get_leader_id());
 	}
 
-	// Normalize leader velocity to get a clean heading vector for rotation
-	double speed = std::sqrt(
-		leader_vel[0] * leader_vel[0] +
-		leader_vel[1] * leader_vel[1] +
-		leader_vel[2] * leader_vel[2]);
-
-	if (speed < 1e-6)
-	{
-		// If the leader is effectively stationary, assume a default heading along +Y
-		leader_vel = {0.0, 1.0, 0.0};
-	}
-	else
-	{
-		leader_vel[0] /= speed;
-		leader_vel[1] /= speed;
-		leader_vel[2] /= speed;
-	}
-
-	// Local formation offset for this UAV (defined by the formation type: LINE, VEE, CIRCLE)
-	std::array<double, 3> formation_offset = SwarmCoord.get_formation_offset(get_id());
-
-	// Use SwarmCoordinator's 3D rotation helper to map local offsets into world space
-	std::array<double, 3> rotated_offset = SwarmCoord.rotate_offset_3d(formation_offset, leader_vel);
-
-	// Target location within formation in relation to leader's location.
-	// Keep Z at the leader's altitude so formations stay planar.
-	std::array<double, 3> formation_target = {
-		leader_pos[0] + rotated_offset[0],
-		leader_pos[1] + rotated_offset[1],
-		leader_pos[2]};
+	std::array<double, 3> formation_target = get_formation_target(leader_pos, leader_vel);
 
 	// position error
 	std::array<double, 3> formation_error = {
@@ -298,7 +333,7 @@ std::array<double, 3> UAV::calculate_separation_forces()
 	double epsilon = .001; // constant to reduce chance of division by zero
 	std::vector<NeighborInfo> neighbors = get_neighbors_status();
 	int num_neighbors = neighbors.size();
-	double min_separation = SwarmCoord.get_separation();
+	double min_separation = SwarmCoord->get_separation();
 
 	for (int i = 0; i < num_neighbors; i++)
 	{
@@ -417,15 +452,15 @@ std::array<double, 3> UAV::calculate_obstacle_forces()
 
 /**
  * apply_boids_forces - applies boids forces to the heading and velocity of the uav
+ * @tuning: weights and limits in effect this tick
  */
-void UAV::apply_boids_forces()
+void UAV::apply_boids_forces(const SwarmTuning &tuning)
 {
 	double internal_formation_weight = 4.0;	 // prioritize holding formation slots
 	double internal_separation_weight = 1.0; // reduce separation dominance
 	double internal_alignment_weight = 0.5;	 // alignment is mostly redundant and may be fully phased out in the future
 	double internal_obstacle_weight = 1.0;	 // Obstacle Avoidance
 
-	SwarmTuning tuning = get_swarm_tuning();
 	double cohesion_weight = tuning.cohesion;
 	double separation_weight = tuning.separation;
 	double alignment_weight = tuning.alignment;
@@ -1,6 +1,7 @@
 #pragma once
 #include "swarm_coordinator.h"
 #include "environment.h"
+#include "swarm_tuning.h"
 #include <array>
 #include <vector>
 #include <string>
@@ -21,10 +22,12 @@
 #include <algorithm>
 
 #define UAVDT .05 // UAV time step
+#define SWARM_ID_STRIDE 1000 // UAV id = swarm * stride + formation slot; slot 0 leads
+#define UAV_CLEARANCE 1.0 // m kept between a UAV and an obstacle's surface
 
 // class SwarmCoordinator; forward declaration to avoid circular header dependencies
 
-// for the stretch goal of allowing a user to manually control an individual UAV
+// MANUAL UAVs fly at a setpoint posted from outside; the tick skips their autonomous forces
 enum class UAVControleMode {
 	AUTONOMOUS,
 	MANUAL,
@@ -49,7 +52,7 @@ private:
 	};
 	std::vector<NeighborInfo> neighbors_status;
 
-	SwarmCoordinator SwarmCoord;
+	SwarmCoordinator *SwarmCoord = nullptr;	// the swarm's formation table, shared by all its UAVs
 	Environment& env;
 
 public:
@@ -68,11 +71,18 @@ public:
 	void set_vely(double y) { vel[1] = y; }
 	void set_velz(double z) { vel[2] = z; }
 	void set_neighbor_address(std::vector<std::string> addresses) {neighbors_address = addresses; }
+	void set_mode(UAVControleMode m) { mode = m; }
+	void set_SwarmCoord(SwarmCoordinator &coords) { SwarmCoord = &coords; }
 
 	// Getters
 	int get_id() const { return id; }
 	int get_port() const { return port; }
-	SwarmCoordinator& get_SwarmCoord() { return SwarmCoord; }
+	int get_swarm_id() const { return id / SWARM_ID_STRIDE; }
+	int get_slot() const { return id % SWARM_ID_STRIDE; }
+	int get_leader_id() const { return id - get_slot(); }
+	UAVControleMode get_mode() const { return mode; }
+	bool is_manual() const { return mode == UAVControleMode::MANUAL; }
+	SwarmCoordinator& get_SwarmCoord() { return *SwarmCoord; }
 
 	std::array<double, 3> get_pos() const { return pos; }
 	double get_x() const { return pos[0]; }
@@ -93,14 +103,16 @@ public:
 	void remove_neighbor_address(const std::string& address);
 	void update_neighbor_status(int neighbor_id, const std::array<double, 3>& pos, const std::array<double, 3>& vel);
 	void remove_stale_neighbors();
+	void remove_neighbors_in(int first_id, int end_id);
 	std::vector<NeighborInfo> get_fresh_neighbors();
 
 	// Cohesion
+	std::array<double, 3> get_formation_target(const std::array<double, 3> &leader_pos, std::array<double, 3> leader_vel) const;
 	std::array<double, 3> calculate_formation_force();
 	std::array<double, 3> calculate_separation_forces();
 	std::array<double, 3> calculate_alignment_forces();
 	std::array<double, 3> calculate_obstacle_forces();
-	void apply_boids_forces();
+	void apply_boids_forces(const SwarmTuning &tuning);
 
 	// JSON
 	void uav_telemetry_broadcast();
@@ -2,7 +2,15 @@ import dgram from "dgram";
 import WebSocket from "ws";
 
 const UDP_PORT = 6000; // Sim sends UDP locally into the bridge
-const WS_URL = "wss://server-green-silence-3042.fly.dev/ws";
+const WS_URL = process.env.SKYWEAVE_WS_URL ?? "wss://server-green-silence-3042.fly.dev/ws";
+
+// Streamed environment, see sim/src/environment_codec.h for the layout
+const ENV_MAGIC = "SWEV";
+const ENV_VERSION = 2;
+const ENV_HEADER_SIZE = 28;
+const ENV_RECORD_SIZE = 32;
+const ENV_FULL = 1;
+const ENV_STREAM_TIMEOUT_MS = 1000; // a stream still missing chunks after this lost one
 
 const udp = dgram.createSocket("udp4");
 let ws;
@@ -12,6 +20,10 @@ function connectWs() {
 
 	ws.on("open", () => {
 		console.log("WS connected to", WS_URL);
+		// the server may have restarted, so it gets the obstacles we already have
+		if (world.revision !== null) {
+			ws.send(JSON.stringify(environmentWrapper()));
+		}
 	});
 
 	ws.on("close", () => {
@@ -49,9 +61,140 @@ function connectWs() {
 	});
 }
 
+// ----- Environment stream reassembly -----
+// The sim sends obstacles as chunked binary streams: full ones replace the
+// map, deltas only apply on top of the revision they were made against.
+const world = { revision: null, obstacles: new Map(), goal: null };
+let pending = null; // stream whose chunks are still arriving
+
+function decodeEnvRecord(buf, off) {
+	const shape = buf.readUInt8(off);
+	const id = buf.readUInt32LE(off + 4);
+	const p = [];
+	for (let a = 0; a < 6; a++) {
+		p.push(buf.readFloatLE(off + 8 + 4 * a));
+	}
+
+	switch (shape) {
+		case 1:
+			return { id, obstacle: { type: "box", x: p[0], y: p[1], z: p[2], width: p[3], depth: p[4], height: p[5] } };
+		case 2:
+			return { id, obstacle: { type: "sphere", x: p[0], y: p[1], z: p[2], radius: p[3] } };
+		case 3:
+			return { id, obstacle: { type: "cylinder", x: p[0], y: p[1], z: p[2], radius: p[3], height: p[4] } };
+		case 4:
+			return { id, goal: { x: p[0], y: p[1], z: p[2], radius: p[3] } };
+		default:
+			return null; // newer shape, skipped
+	}
+}
+
+// Asks the sim (or partition rank) that sent a stream for a full resend, on its command port
+function requestFullEnvironment(address, port, reason) {
+	console.warn(`Environment ${reason}, asking the sim for a full resend`);
+	udp.send(Buffer.from("environment", "utf8"), port, address, (err) => {
+		if (err) {
+			console.error("Error requesting environment from sim:", err.message);
+		}
+	});
+}
+
+function environmentWrapper() {
+	const ids = [...world.obstacles.keys()].sort((a, b) => a - b);
+	return {
+		type: "environment",
+		obstacles: ids.map((id) => world.obstacles.get(id)),
+		goal: world.goal,
+	};
+}
+
+// Takes one chunk; returns true once it completes a stream that changed the map
+function handleEnvChunk(buf, rinfo) {
+	if (buf.length < ENV_HEADER_SIZE || buf.readUInt8(4) !== ENV_VERSION) {
+		console.error("Dropping environment chunk with a bad header");
+		return false;
+	}
+	const flags = buf.readUInt8(5);
+	const chunk = buf.readUInt16LE(6);
+	const chunks = buf.readUInt16LE(8);
+	const count = buf.readUInt16LE(10);
+	const revision = buf.readUInt32LE(12);
+	const base = buf.readUInt32LE(16);
+	const total = buf.readUInt32LE(20);
+	const replyPort = buf.readUInt16LE(24);
+	if (chunk >= chunks || buf.length !== ENV_HEADER_SIZE + count * ENV_RECORD_SIZE) {
+		console.error("Dropping malformed environment chunk");
+		return false;
+	}
+
+	if (!pending || pending.revision !== revision || pending.flags !== flags) {
+		if (pending) {
+			clearTimeout(pending.timer);
+			requestFullEnvironment(pending.address, pending.replyPort, `stream ${pending.revision} lost chunks`);
+		}
+		pending = { revision, flags, base, total, chunks, received: 0, parts: new Array(chunks), address: rinfo.address, replyPort };
+		pending.timer = setTimeout(() => {
+			pending = null;
+			requestFullEnvironment(rinfo.address, replyPort, `stream ${revision} timed out`);
+		}, ENV_STREAM_TIMEOUT_MS);
+	}
+	if (pending.parts[chunk]) {
+		return false;
+	}
+	const records = [];
+	for (let i = 0; i < count; i++) {
+		const rec = decodeEnvRecord(buf, ENV_HEADER_SIZE + i * ENV_RECORD_SIZE);
+		if (rec) {
+			records.push(rec);
+		}
+	}
+	pending.parts[chunk] = records;
+	if (++pending.received < pending.chunks) {
+		return false;
+	}
+
+	const stream = pending;
+	clearTimeout(stream.timer);
+	pending = null;
+
+	const full = (stream.flags & ENV_FULL) !== 0;
+	if (!full && world.revision !== stream.base) {
+		requestFullEnvironment(rinfo.address, replyPort, `delta on ${stream.base} but we are at ${world.revision}`);
+		return false;
+	}
+	if (full) {
+		world.obstacles.clear();
+		world.goal = null;
+	}
+	for (const part of stream.parts) {
+		for (const rec of part) {
+			if (rec.goal) {
+				world.goal = rec.goal;
+			} else {
+				world.obstacles.set(rec.id, rec.obstacle);
+			}
+		}
+	}
+	world.revision = stream.revision;
+	if (world.obstacles.size !== stream.total) {
+		requestFullEnvironment(rinfo.address, replyPort, `has ${world.obstacles.size} of ${stream.total} obstacles`);
+	}
+	return true;
+}
+
 connectWs();
 
 udp.on("message", (msg, rinfo) => {
+	if (msg.length >= 4 && msg.toString("latin1", 0, 4) === ENV_MAGIC) {
+		// reassembled even while WS is down, so the map is current on reconnect
+		if (handleEnvChunk(msg, rinfo) && ws && ws.readyState === WebSocket.OPEN) {
+			const wrapper = environmentWrapper();
+			console.log(`Forwarding ENV revision ${world.revision} to WS: ${wrapper.obstacles.length} obstacles`);
+			ws.send(JSON.stringify(wrapper));
+		}
+		return;
+	}
+
 	const text = msg.toString("utf8");
 	console.log("UDP from sim:", rinfo.address + ":" + rinfo.port, text);
 
@@ -71,7 +214,7 @@ udp.on("message", (msg, rinfo) => {
 	// ----- NEW LOGIC: Detect environment vs telemetry -----
 	let wrapper;
 
-	// Environment packets include: { "type": "environment", "obstacles": [...] }
+	// Older sims send the environment as JSON: { "type": "environment", "obstacles": [...] }
 	if (parsed.type === "environment") {
 		wrapper = {
 			type: "environment",